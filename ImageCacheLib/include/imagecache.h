@@ -12,6 +12,7 @@
 #include <QObject>   // Base class for Qt objects, enables signals/slots
 #include <QImage>    // Class for image data
 #include <QHash>     // Hash table for efficient key-value storage
+#include <QList>     // For listing the cached IDs
 
 /**
  * @brief Standard macro for export/import of symbols for the ImageCacheLib.
@@ -70,12 +71,32 @@ public:
      */
     bool contains(int id) const;
 
+    /**
+     * @brief Returns the IDs of all cached images, in no particular order.
+     * @return The cached IDs.
+     */
+    QList<int> ids() const;
+
     /**
      * @brief Removes an image from the cache by its ID.
      * @param id The ID of the image to remove.
      */
     void removeImage(int id);
 
+    /**
+     * @brief Re-keys every cached image whose ID lies in [firstId, lastId] by `delta`.
+     *
+     * Used when the image index is edited in place (a file inserted or removed
+     * in the middle of the list) so that previews already in memory follow
+     * their file to its new ID instead of being thrown away. Entries outside
+     * the range are left untouched.
+     *
+     * @param firstId The first ID of the range to move (inclusive).
+     * @param lastId The last ID of the range to move (inclusive).
+     * @param delta The offset added to each ID in the range.
+     */
+    void shiftImages(int firstId, int lastId, int delta);
+
     /**
      * @brief Clears all images from the cache.
      */
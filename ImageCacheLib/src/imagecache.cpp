@@ -65,6 +65,14 @@ bool ImageCache::contains(int id) const {
     return m_imageCache.contains(id);
 }
 
+/**
+ * @brief Returns the IDs of all cached images, in no particular order.
+ * @return The cached IDs.
+ */
+QList<int> ImageCache::ids() const {
+    return m_imageCache.keys();
+}
+
 /**
  * @brief Removes an image from the cache by its ID.
  *
@@ -81,6 +89,37 @@ void ImageCache::removeImage(int id) {
     }
 }
 
+/**
+ * @brief Re-keys every cached image whose ID lies in [firstId, lastId] by `delta`.
+ *
+ * The affected entries are taken out of the hash first and re-inserted
+ * afterwards, so overlapping source and destination ranges are handled
+ * correctly whichever direction the shift goes.
+ *
+ * @param firstId The first ID of the range to move (inclusive).
+ * @param lastId The last ID of the range to move (inclusive).
+ * @param delta The offset added to each ID in the range.
+ */
+void ImageCache::shiftImages(int firstId, int lastId, int delta) {
+    if (delta == 0 || firstId > lastId) {
+        return;
+    }
+
+    QHash<int, QImage> moved;
+    for (auto it = m_imageCache.begin(); it != m_imageCache.end();) {
+        if (it.key() >= firstId && it.key() <= lastId) {
+            moved.insert(it.key() + delta, it.value());
+            it = m_imageCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = moved.cbegin(); it != moved.cend(); ++it) {
+        m_imageCache.insert(it.key(), it.value());
+    }
+    qDebug() << "Shifted" << moved.size() << "cached images in range" << firstId << "-" << lastId << "by" << delta;
+}
+
 /**
  * @brief Clears all images from the cache.
  *
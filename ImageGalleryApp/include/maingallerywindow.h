@@ -19,6 +19,10 @@
 // These classes are external components integrated into the MainGalleryWindow.
 class ImageLoader;   ///< Forward declaration for ImageLoader class.
 class UINavigator;   ///< Forward declaration for UINavigator class.
+class TileLoader;    ///< Forward declaration for TileLoader class.
+class ZoomPanView;   ///< Forward declaration for ZoomPanView class.
+class AnimationPlayer; ///< Forward declaration for AnimationPlayer class.
+class QResizeEvent;  ///< Forward declaration for QResizeEvent class.
 
 
 /**
@@ -77,6 +81,18 @@ private slots:
      */
     void onImageLoaded(int id, const QImage& image);
 
+    /**
+     * @brief Slot to receive draft images from ImageLoader.
+     *
+     * This slot is connected to the ImageLoader::imageDraftLoaded signal.
+     * The draft is shown (with a fast scale) until the refined image arrives
+     * through onImageLoaded() and is swapped in.
+     *
+     * @param id The ID of the image.
+     * @param draft The low-quality draft.
+     */
+    void onImageDraftLoaded(int id, const QImage& draft);
+
     /**
      * @brief Slot to handle image loading errors.
      *
@@ -99,6 +115,56 @@ private slots:
      */
     void onImageIdChanged(int newId);
 
+    /**
+     * @brief Slot to react to the user pausing on an image.
+     *
+     * This slot is connected to the UINavigator::navigationSettled signal.
+     * After a burst of fast navigation it switches the loader back to
+     * high-quality scaling and reloads the image the user settled on.
+     *
+     * @param id The current image ID.
+     */
+    void onNavigationSettled(int id);
+
+    /**
+     * @brief Slot to react to a new file appearing in the image directory.
+     *
+     * If the insertion shifted the current image, its new ID becomes the
+     * current one: the same file stays on screen without being reloaded.
+     *
+     * @param id The ID assigned to the new file.
+     */
+    void onImageInserted(int id);
+
+    /**
+     * @brief Slot to react to a file disappearing from the image directory.
+     *
+     * Follows the current image to its new ID if the removal shifted it, and
+     * shows the next file if the current one was removed.
+     *
+     * @param id The ID the removed file used to have.
+     */
+    void onImageRemoved(int id);
+
+    /**
+     * @brief Slot to react to an image file being modified on disk.
+     *
+     * Reloads the current image if it is the one that changed.
+     *
+     * @param id The ID of the modified file.
+     */
+    void onImageModified(int id);
+
+    /**
+     * @brief Slot to react to a change of the total number of images.
+     *
+     * Propagates the new bound to the UINavigator and refreshes the ID label
+     * and navigation buttons.
+     *
+     * @param count The new total number of images.
+     */
+    void onImageCountChanged(int count);
+
     /**
      * @brief Slot for the "Previous" button click.
      *
@@ -115,15 +181,127 @@ private slots:
      */
     void on_nextButton_clicked();
 
+    /**
+     * @brief Slot for the zoom shortcut (Z).
+     *
+     * Switches between the fitted preview and the zoom/pan view of the current image.
+     */
+    void toggleZoomMode();
+
+    /**
+     * @brief Slot to receive the frames of the animation of the current image.
+     *
+     * This slot is connected to the AnimationPlayer::frameReady signal.
+     *
+     * @param frame The frame due on screen.
+     */
+    void onAnimationFrame(const QImage& frame);
+
+    /**
+     * @brief Slot to receive the raster of the current SVG image.
+     *
+     * This slot is connected to the SvgRasterizer::rendered signal.
+     *
+     * @param path The SVG file.
+     * @param image The raster, at the size of the display area in device pixels.
+     */
+    void onSvgRendered(const QString& path, const QImage& image);
+
+protected:
+    /**
+     * @brief Re-rasterizes the current SVG image at the new size of the display area.
+     *
+     * @param event The resize event.
+     */
+    void resizeEvent(QResizeEvent* event) override;
+
 private:
+    /**
+     * @brief Enters or leaves zoom mode.
+     *
+     * In zoom mode the image label is replaced by a ZoomPanView, which decodes
+     * the visible tiles of the current image at the zoom the user picks.
+     * Placeholders have no file to zoom into, so zoom mode is not entered for them.
+     *
+     * @param enabled True to enter zoom mode.
+     */
+    void setZoomMode(bool enabled);
+
     /**
      * @brief Updates the image displayed in the UI.
      *
      * Scales the provided image to fit the display area and sets it on the image label.
      *
      * @param image The QImage to be displayed.
+     * @param mode The scaling quality; drafts use Qt::FastTransformation.
+     */
+    void updateImageDisplay(const QImage& image, Qt::TransformationMode mode = Qt::SmoothTransformation);
+
+    /**
+     * @brief Shows the most recent image received for the current ID.
+     *
+     * Runs once per event loop pass in which images arrived, so the label is
+     * rescaled and repainted once per frame of results rather than once per image.
+     */
+    void applyPendingImage();
+
+    /**
+     * @brief Shows the image with the given ID.
+     *
+     * Placeholders are painted right away with the loader's PlaceholderRenderer;
+     * real images are requested from the loader and shown when they arrive.
+     *
+     * @param id The ID of the image to show.
+     */
+    void showImage(int id);
+
+    /**
+     * @brief Tells whether the image with the given ID is an SVG document.
+     *
+     * Goes by the probed format, whatever the file is called. Until the header
+     * is probed the image takes the loader's pipeline, which sniffs it.
+     *
+     * @param id The image ID.
+     * @return True if `id` is a real image probed as SVG.
      */
-    void updateImageDisplay(const QImage& image);
+    bool isSvgImage(int id) const;
+
+    /**
+     * @brief Asks for a raster of an SVG image at the size of the display area.
+     *
+     * @param id The image ID.
+     */
+    void requestSvgRaster(int id);
+
+    /**
+     * @brief Follows the file on screen to the ID the index moved it to, without reloading it.
+     *
+     * @param newId The new ID of the current file.
+     */
+    void followCurrentImage(int newId);
+
+    /**
+     * @brief Starts playing the image with the given ID if its format may be animated.
+     *
+     * Stops the animation of the previous image in any case.
+     *
+     * @param id The ID of the image.
+     */
+    void startAnimation(int id);
+
+    /**
+     * @brief Paints the placeholder for an ID at the size of the display area.
+     *
+     * @param id The placeholder ID.
+     */
+    void showPlaceholder(int id);
+
+    /**
+     * @brief Returns the size available for the image inside the frame.
+     *
+     * @return The frame size minus padding, or a fallback before the first layout.
+     */
+    QSize displayTargetSize() const;
 
     /**
      * @brief Updates the enabled/disabled state of navigation buttons.
@@ -157,8 +335,19 @@ private:
     QScopedPointer<Ui::MainGalleryWindow> ui; ///< Manages the UI elements generated from the .ui file.
     ImageLoader* m_imageLoader;               ///< Pointer to the ImageLoader instance.
     UINavigator* m_uiNavigator;               ///< Pointer to the UINavigator instance.
+    TileLoader* m_tileLoader;                 ///< Decodes tiles for zoom mode; child of this window.
+    ZoomPanView* m_zoomView;                  ///< The zoom mode view, inside the image frame; hidden outside zoom mode.
+    AnimationPlayer* m_animation;             ///< Plays animated GIF and WebP files; child of this window.
 
     int m_maxImageId; ///< Stores the maximum image ID available in the gallery.
+
+    QImage m_pendingImage;      ///< Latest image for the current ID, not shown yet.
+    int m_pendingImageId;       ///< ID of `m_pendingImage`.
+    bool m_pendingIsDraft;      ///< True if `m_pendingImage` is only a draft.
+    bool m_displayUpdateQueued; ///< True while a call to applyPendingImage() is queued.
+    QImage m_displayedImage;    ///< The image last shown for the current ID, reused as the zoom backdrop.
+    int m_animatedId;           ///< ID whose animation was started last, or -1.
+    bool m_animationShown;      ///< True once a frame of `m_animatedId` is on screen; its preview is then not shown.
 };
 
 #endif // IMAGEGALLERYAPP_MAINGALLERYWINDOW_H
@@ -0,0 +1,190 @@
+/**
+ * @file zoompanview.h
+ * @brief Declaration of the ZoomPanView class, which shows one image at any zoom from tiles.
+ *
+ * This file defines the ZoomPanView widget, used by MainGalleryWindow for its
+ * zoom mode. The image is drawn from the tiles of a TileLoader at the pyramid
+ * level matching the current zoom; tiles not decoded yet are covered by
+ * coarser levels and, underneath, by the image's preview.
+ */
+#ifndef IMAGEGALLERYAPP_ZOOMPANVIEW_H
+#define IMAGEGALLERYAPP_ZOOMPANVIEW_H
+
+#include <QWidget>  // Base class for the view
+#include <QImage>   // For the preview backdrop
+#include <QPointF>  // For the view centre
+#include <QRectF>   // For the visible region
+
+#include "tileloader.h" // For TileLoader and TileKey, used in the slot signature
+
+/**
+ * @brief A zoomable, pannable view of one image, decoded tile by tile.
+ *
+ * The wheel zooms around the cursor, dragging pans, the + and - keys zoom
+ * around the centre and 0 returns to the fitted view. Double-click or Escape
+ * emits `closeRequested`.
+ *
+ * Only the tiles intersecting the viewport are requested, from the viewport
+ * centre outwards, each time the view changes.
+ */
+class ZoomPanView : public QWidget {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs the view.
+     *
+     * @param tiles The tile loader providing the image; not owned.
+     * @param parent Pointer to the parent widget.
+     */
+    explicit ZoomPanView(TileLoader* tiles, QWidget* parent = nullptr);
+
+    /**
+     * @brief Shows an image, fitted to the view.
+     *
+     * @param id The image ID.
+     * @param preview A downscaled version of the image drawn under the tiles; may be null.
+     */
+    void setImage(int id, const QImage& preview = QImage());
+
+    /**
+     * @brief Replaces the preview drawn under the tiles.
+     *
+     * @param preview A downscaled version of the current image; may be null.
+     */
+    void setPreview(const QImage& preview);
+
+    /**
+     * @brief Follows the image shown to a new ID, keeping the zoom and the position.
+     *
+     * For when the gallery renumbers the same file after a file before it
+     * was inserted or removed.
+     *
+     * @param id The new ID of the image shown.
+     */
+    void renumberImage(int id);
+
+    /**
+     * @brief Returns the ID of the image shown.
+     * @return The image ID, or -1 if none.
+     */
+    int imageId() const;
+
+signals:
+    /**
+     * @brief Emitted when the user asks to leave the view (double-click or Escape).
+     */
+    void closeRequested();
+
+protected:
+    /**
+     * @brief Draws the preview, then the cached tiles from coarse to fine.
+     * @param event The paint event.
+     */
+    void paintEvent(QPaintEvent* event) override;
+
+    /**
+     * @brief Keeps the image fitted, or its centre in place, when the view is resized.
+     * @param event The resize event.
+     */
+    void resizeEvent(QResizeEvent* event) override;
+
+    /**
+     * @brief Zooms around the cursor.
+     * @param event The wheel event.
+     */
+    void wheelEvent(QWheelEvent* event) override;
+
+    /**
+     * @brief Starts a drag.
+     * @param event The mouse event.
+     */
+    void mousePressEvent(QMouseEvent* event) override;
+
+    /**
+     * @brief Pans while dragging.
+     * @param event The mouse event.
+     */
+    void mouseMoveEvent(QMouseEvent* event) override;
+
+    /**
+     * @brief Ends a drag.
+     * @param event The mouse event.
+     */
+    void mouseReleaseEvent(QMouseEvent* event) override;
+
+    /**
+     * @brief Emits `closeRequested`.
+     * @param event The mouse event.
+     */
+    void mouseDoubleClickEvent(QMouseEvent* event) override;
+
+    /**
+     * @brief Handles the zoom keys and Escape.
+     * @param event The key event.
+     */
+    void keyPressEvent(QKeyEvent* event) override;
+
+private slots:
+    /**
+     * @brief Repaints when a tile of the current image arrives.
+     * @param key The tile.
+     */
+    void onTileLoaded(const TileKey& key);
+
+    /**
+     * @brief Fits the current image once its size is known, if it was not when it was set.
+     * @param id The image whose header has been probed.
+     */
+    void onImageSizeKnown(int id);
+
+private:
+    /**
+     * @brief Returns the zoom at which the whole image fits the view.
+     * @return Widget pixels per full-resolution pixel.
+     */
+    qreal fitScale() const;
+
+    /**
+     * @brief Sets the zoom, keeping the image point under `anchor` in place.
+     *
+     * @param scale The new zoom; clamped between the fitted zoom and the maximum.
+     * @param anchor The fixed point, in widget coordinates.
+     */
+    void zoomTo(qreal scale, const QPointF& anchor);
+
+    /**
+     * @brief Keeps the image inside the view: centred if smaller, edge to edge if larger.
+     */
+    void clampCentre();
+
+    /**
+     * @brief Returns the part of the image visible in the view.
+     * @return The region, in full-resolution pixels.
+     */
+    QRectF visibleImageRect() const;
+
+    /**
+     * @brief Returns the pyramid level matching the current zoom.
+     * @return The level.
+     */
+    int currentLevel() const;
+
+    /**
+     * @brief Asks the tile loader for the tiles of the visible region.
+     */
+    void requestVisibleTiles();
+
+    TileLoader* m_tiles;   ///< Provides the tiles; not owned.
+    int m_id;              ///< The image shown, or -1.
+    QSize m_imageSize;     ///< Full-resolution, oriented size of the image.
+    int m_levelCount;      ///< Number of pyramid levels of the image.
+    QImage m_preview;      ///< Drawn under the tiles until they arrive.
+    qreal m_scale;         ///< Widget pixels per full-resolution pixel.
+    bool m_fitted;         ///< True while the zoom follows the view size.
+    QPointF m_centre;      ///< Image point at the centre of the view, in full-resolution pixels.
+    bool m_dragging;       ///< True while the left button is held.
+    QPointF m_lastDragPos; ///< Cursor position at the previous move of a drag.
+};
+
+#endif // IMAGEGALLERYAPP_ZOOMPANVIEW_H
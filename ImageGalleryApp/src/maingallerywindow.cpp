@@ -11,6 +11,11 @@
 #include "ui_maingallerywindow.h" // Generato da uic da maingallerywindow.ui
 
 #include "imageloader.h"          // Include completo per ImageLoader (ora senza namespace)
+#include "placeholderrenderer.h"  // Per disegnare i segnaposto senza passare dal loader
+#include "tileloader.h"           // Per la decodifica a tile della modalit zoom
+#include "zoompanview.h"          // Vista della modalit zoom
+#include "animationplayer.h"      // Per riprodurre GIF e WebP animati
+#include "svgrasterizer.h"        // Per rasterizzare gli SVG alla dimensione del riquadro
 #include "uinavigator.h"          // Include completo per UINavigator (ora senza namespace)
 
 #include <QDebug>                 // Per debugging
@@ -18,6 +23,10 @@
 #include <QMessageBox>            // Per messaggi di errore
 #include <QScreen>                // Per ottenere la risoluzione dello schermo per lo scaling
 #include <QDir>                   // Per controllare l'esistenza della directory delle immagini
+#include <QShortcut>              // Per il tasto della modalit zoom
+#include <QFileInfo>              // Per riconoscere i formati animati dall'estensione
+#include <QResizeEvent>           // Per ri-rasterizzare gli SVG quando la finestra cambia dimensione
+#include <QSignalBlocker>         // Per seguire il file corrente senza ricaricarlo
 
 // Per disegnare icone triangolari personalizzate (in alternativa, usa file SVG)
 #include <QPainter>
@@ -25,6 +34,13 @@
 #include <QIcon>
 #include <QPainterPath>
 
+namespace {
+/**
+ * @brief Number of upcoming images whose encoded bytes are prefetched after each navigation step.
+ */
+constexpr int READAHEAD_COUNT = 8;
+}
+
 /**
  * @brief Constructor for MainGalleryWindow.
  *
@@ -42,7 +58,15 @@ MainGalleryWindow::MainGalleryWindow(ImageLoader* loader,
     ui(new Ui::MainGalleryWindow()), // Inizializza l'UI dal file .ui (il namespace Ui  di Qt)
     m_imageLoader(loader),
     m_uiNavigator(navigator),
-    m_maxImageId(0) // Sar aggiornato dal navigatore
+    m_tileLoader(nullptr),
+    m_zoomView(nullptr),
+    m_animation(nullptr),
+    m_maxImageId(0), // Sar aggiornato dal navigatore
+    m_pendingImageId(-1),
+    m_pendingIsDraft(false),
+    m_displayUpdateQueued(false),
+    m_animatedId(-1),
+    m_animationShown(false)
 {
     ui->setupUi(this); // Configura gli elementi UI definiti nel file .ui
 
@@ -63,18 +87,43 @@ MainGalleryWindow::MainGalleryWindow(ImageLoader* loader,
      */
     connect(m_imageLoader, &ImageLoader::imageLoaded,
             this, &MainGalleryWindow::onImageLoaded);
+    connect(m_imageLoader, &ImageLoader::imageDraftLoaded,
+            this, &MainGalleryWindow::onImageDraftLoaded);
     /**
      * @brief Connects the loadingError signal from ImageLoader to onLoadingError slot.
      */
     connect(m_imageLoader, &ImageLoader::loadingError,
             this, &MainGalleryWindow::onLoadingError);
 
+    /**
+     * @brief Connects the live index update signals from ImageLoader.
+     */
+    connect(m_imageLoader, &ImageLoader::imageInserted,
+            this, &MainGalleryWindow::onImageInserted);
+    connect(m_imageLoader, &ImageLoader::imageRemoved,
+            this, &MainGalleryWindow::onImageRemoved);
+    connect(m_imageLoader, &ImageLoader::imageModified,
+            this, &MainGalleryWindow::onImageModified);
+    connect(m_imageLoader, &ImageLoader::imageCountChanged,
+            this, &MainGalleryWindow::onImageCountChanged);
+
     // Segnali di UINavigator
     /**
      * @brief Connects the imageIdChanged signal from UINavigator to onImageIdChanged slot.
      */
     connect(m_uiNavigator, &UINavigator::imageIdChanged,
             this, &MainGalleryWindow::onImageIdChanged);
+    connect(m_uiNavigator, &UINavigator::navigationSettled,
+            this, &MainGalleryWindow::onNavigationSettled);
+
+    /**
+     * @brief Sets up the player of animated images before the first image is shown.
+     */
+    m_animation = new AnimationPlayer(this);
+    connect(m_animation, &AnimationPlayer::frameReady,
+            this, &MainGalleryWindow::onAnimationFrame);
+    connect(m_imageLoader->svgRasterizer(), &SvgRasterizer::rendered,
+            this, &MainGalleryWindow::onSvgRendered);
 
     // Configurazione iniziale
     /**
@@ -93,12 +142,24 @@ MainGalleryWindow::MainGalleryWindow(ImageLoader* loader,
     /**
      * @brief Initiates asynchronous loading of the first image based on the current image ID from UINavigator.
      */
-    m_imageLoader->loadImageAsync(m_uiNavigator->currentImageId()); // Carica la prima immagine
+    showImage(m_uiNavigator->currentImageId()); // Carica la prima immagine
+    m_imageLoader->prefetchEncoded(m_uiNavigator->upcomingIds(READAHEAD_COUNT));
 
     /**
      * @brief Sets up custom icons for the navigation buttons.
      */
     setupUiIcons(); // Imposta le icone per i pulsanti
+
+    /**
+     * @brief Sets up zoom mode: a tiled view sharing the image frame with the label, toggled with Z.
+     */
+    m_tileLoader = new TileLoader(m_imageLoader, this);
+    m_zoomView = new ZoomPanView(m_tileLoader, ui->imageFrame);
+    m_zoomView->hide();
+    ui->verticalLayout_2->addWidget(m_zoomView);
+    connect(m_zoomView, &ZoomPanView::closeRequested, this, [this]() { setZoomMode(false); });
+    QShortcut* zoomShortcut = new QShortcut(QKeySequence(Qt::Key_Z), this);
+    connect(zoomShortcut, &QShortcut::activated, this, &MainGalleryWindow::toggleZoomMode);
 }
 
 /**
@@ -119,8 +180,9 @@ MainGalleryWindow::~MainGalleryWindow() {
  * Scales the provided image to fit the display area and sets it on the image label.
  *
  * @param image The QImage to be displayed.
+ * @param mode The scaling quality; drafts use Qt::FastTransformation.
  */
-void MainGalleryWindow::updateImageDisplay(const QImage& image) {
+void MainGalleryWindow::updateImageDisplay(const QImage& image, Qt::TransformationMode mode) {
     if (image.isNull()) {
         ui->imageLabel->setText("Immagine non disponibile.");
         ui->imageLabel->setPixmap(QPixmap()); // Cancella qualsiasi immagine precedente
@@ -128,11 +190,22 @@ void MainGalleryWindow::updateImageDisplay(const QImage& image) {
     }
 
     // Scala l'immagine per adattarsi al frame, mantenendo le proporzioni
+    m_displayedImage = image;
+    if (m_zoomView && m_zoomView->isVisible() && m_zoomView->imageId() == m_uiNavigator->currentImageId()) {
+        m_zoomView->setPreview(image); // Sfondo per i tile non ancora decodificati
+    }
     QPixmap pixmap = QPixmap::fromImage(image);
-    // Ottieni la dimensione corrente dello schermo per assicurarti che lo scaling sia appropriato per la visualizzazione
-    QScreen *screen = QGuiApplication::primaryScreen();
-    QSize screenSize = screen->size();
+    ui->imageLabel->setPixmap(pixmap.scaled(displayTargetSize(), Qt::KeepAspectRatio, mode));
+    ui->imageLabel->setAlignment(Qt::AlignCenter);
+    ui->imageLabel->setText(""); // Cancella il testo "Caricamento Immagine..."
+}
 
+/**
+ * @brief Returns the size available for the image inside the frame.
+ *
+ * @return The frame size minus padding, or a fallback before the first layout.
+ */
+QSize MainGalleryWindow::displayTargetSize() const {
     // Scala il pixmap per adattarsi alla dimensione del genitore di imageLabel (o dimensione approssimativa dello schermo)
     // Una soluzione pi robusta sarebbe scalare alla dimensione effettiva disponibile di imageLabel
     // o a una dimensione massima di visualizzazione fissa. Per semplicit, usiamo un massimo definito in ImageLoader.
@@ -142,9 +215,191 @@ void MainGalleryWindow::updateImageDisplay(const QImage& image) {
     if (targetSize.isEmpty() || targetSize.width() <= 0 || targetSize.height() <= 0) {
         targetSize = QSize(800, 600); // Dimensione di fallback se il frame non  ancora stato disposto
     }
-    ui->imageLabel->setPixmap(pixmap.scaled(targetSize, Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    return targetSize;
+}
+
+/**
+ * @brief Shows the image with the given ID.
+ *
+ * @param id The ID of the image to show.
+ */
+void MainGalleryWindow::showImage(int id) {
+    if (m_zoomView && m_zoomView->isVisible()) {
+        if (m_imageLoader->isPlaceholder(id)) {
+            setZoomMode(false); // Niente file in cui zoomare
+        } else if (id != m_zoomView->imageId()) {
+            m_zoomView->setImage(id); // Stesso ID (ricarica): lo zoom resta dov'
+        }
+    }
+    if (id != m_animatedId) {
+        startAnimation(id); // Stesso ID (ricarica): l'animazione continua
+    }
+    if (m_imageLoader->isPlaceholder(id)) {
+        showPlaceholder(id);
+    } else if (isSvgImage(id)) {
+        requestSvgRaster(id); // Niente anteprima in cache: si disegna alla dimensione del riquadro
+    } else {
+        m_imageLoader->loadImageAsync(id);
+    }
+}
+
+/**
+ * @brief Tells whether the image with the given ID is an SVG document.
+ *
+ * Goes by the probed format, whatever the file is called. Until the header
+ * is probed the image takes the loader's pipeline, which sniffs it.
+ *
+ * @param id The image ID.
+ * @return True if `id` is a real image probed as SVG.
+ */
+bool MainGalleryWindow::isSvgImage(int id) const {
+    return !m_imageLoader->isPlaceholder(id) && SvgRasterizer::isSvgFormat(m_imageLoader->imageMetadata(id).format);
+}
+
+/**
+ * @brief Asks for a raster of an SVG image at the size of the display area.
+ *
+ * The raster is drawn in device pixels, so it stays sharp on high-DPI
+ * screens and is shown without any scaling.
+ *
+ * @param id The image ID.
+ */
+void MainGalleryWindow::requestSvgRaster(int id) {
+    m_imageLoader->svgRasterizer()->requestRender(m_imageLoader->imagePath(id), displayTargetSize() * devicePixelRatioF());
+}
+
+/**
+ * @brief Slot to receive the raster of the current SVG image.
+ *
+ * @param path The SVG file.
+ * @param image The raster, at the size of the display area in device pixels.
+ */
+void MainGalleryWindow::onSvgRendered(const QString& path, const QImage& image) {
+    const int id = m_uiNavigator->currentImageId();
+    if (!isSvgImage(id) || m_imageLoader->imagePath(id) != path) {
+        return; // Arrivato dopo che l'utente  passato oltre
+    }
+    if (image.isNull()) {
+        ui->imageLabel->setText("Immagine non disponibile.");
+        ui->imageLabel->setPixmap(QPixmap());
+        return;
+    }
+    m_displayedImage = image;
+    if (m_zoomView && m_zoomView->isVisible() && m_zoomView->imageId() == id) {
+        m_zoomView->setPreview(image);
+    }
+    QPixmap pixmap = QPixmap::fromImage(image);
+    pixmap.setDevicePixelRatio(devicePixelRatioF()); // Gi alla dimensione del riquadro
+    ui->imageLabel->setPixmap(pixmap);
     ui->imageLabel->setAlignment(Qt::AlignCenter);
-    ui->imageLabel->setText(""); // Cancella il testo "Caricamento Immagine..."
+    ui->imageLabel->setText("");
+}
+
+/**
+ * @brief Re-rasterizes the current SVG image at the new size of the display area.
+ *
+ * Raster images keep their preview, which is scaled when it is next shown;
+ * an SVG is drawn again instead, so it is never blurred by scaling. An
+ * animation goes on with frames decoded at the new size.
+ *
+ * @param event The resize event.
+ */
+void MainGalleryWindow::resizeEvent(QResizeEvent* event) {
+    QMainWindow::resizeEvent(event);
+    if (!m_imageLoader || !m_uiNavigator) {
+        return;
+    }
+    const int id = m_uiNavigator->currentImageId();
+    if (isSvgImage(id)) {
+        requestSvgRaster(id); // Le richieste di un ridimensionamento continuo si sostituiscono a vicenda
+    }
+    if (m_animatedId == id) {
+        m_animation->setMaxSize(displayTargetSize() * devicePixelRatioF()); // Dal prossimo fotogramma decodificato
+    }
+}
+
+/**
+ * @brief Starts playing the image with the given ID if its format may be animated.
+ *
+ * Frames are decoded at the displayed size (in device pixels), so showing
+ * them needs no further scaling.
+ *
+ * @param id The ID of the image.
+ */
+void MainGalleryWindow::startAnimation(int id) {
+    m_animation->stop();
+    m_animatedId = -1;
+    m_animationShown = false;
+    if (m_imageLoader->isPlaceholder(id)) {
+        return;
+    }
+    const QString path = m_imageLoader->imagePath(id);
+    QByteArray format = m_imageLoader->imageMetadata(id).format;
+    if (format.isEmpty()) {
+        format = QFileInfo(path).suffix().toLower().toLatin1(); // Intestazione non ancora letta
+    }
+    if (path.isEmpty() || !AnimationPlayer::canAnimate(format)) {
+        return;
+    }
+    m_animatedId = id;
+    m_animation->play(path, displayTargetSize() * devicePixelRatioF(), m_imageLoader->imageMetadata(id).format);
+}
+
+/**
+ * @brief Slot to receive the frames of the animation of the current image.
+ *
+ * @param frame The frame due on screen.
+ */
+void MainGalleryWindow::onAnimationFrame(const QImage& frame) {
+    if (m_animatedId != m_uiNavigator->currentImageId()) {
+        return;
+    }
+    m_animationShown = true;
+    QPixmap pixmap = QPixmap::fromImage(frame);
+    pixmap.setDevicePixelRatio(devicePixelRatioF()); // Decodificato in pixel del dispositivo
+    m_displayedImage = frame;
+    ui->imageLabel->setPixmap(pixmap);
+    ui->imageLabel->setAlignment(Qt::AlignCenter);
+    ui->imageLabel->setText("");
+}
+
+/**
+ * @brief Paints the placeholder for an ID at the size of the display area.
+ *
+ * The placeholder is composed directly at the displayed size from the shared
+ * background and digit atlas: nothing is loaded, scaled or cached.
+ *
+ * @param id The placeholder ID.
+ */
+void MainGalleryWindow::showPlaceholder(int id) {
+    const PlaceholderRenderer* renderer = m_imageLoader->placeholderRenderer();
+    const QSize size = renderer->previewSize().scaled(displayTargetSize(), Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    QPixmap pixmap(size);
+    QPainter painter(&pixmap);
+    renderer->paint(&painter, pixmap.rect(), id);
+    painter.end();
+
+    m_pendingImage = QImage(); // Un'immagine ancora in arrivo per un ID precedente non deve sovrascriverlo
+    m_pendingImageId = -1;
+    ui->imageLabel->setPixmap(pixmap);
+    ui->imageLabel->setAlignment(Qt::AlignCenter);
+    ui->imageLabel->setText("");
+}
+
+/**
+ * @brief Shows the most recent image received for the current ID.
+ */
+void MainGalleryWindow::applyPendingImage() {
+    m_displayUpdateQueued = false;
+    if (m_animationShown && m_pendingImageId == m_animatedId) {
+        m_pendingImage = QImage(); // L'animazione  gi a schermo: l'anteprima statica la farebbe tornare indietro
+        return;
+    }
+    if (!m_pendingImage.isNull() && m_pendingImageId == m_uiNavigator->currentImageId()) {
+        const bool fast = m_pendingIsDraft || m_uiNavigator->isNavigatingFast();
+        updateImageDisplay(m_pendingImage, fast ? Qt::FastTransformation : Qt::SmoothTransformation);
+    }
+    m_pendingImage = QImage(); // Non trattenere il buffer oltre il necessario
 }
 
 /**
@@ -236,12 +491,43 @@ void MainGalleryWindow::setupUiIcons() {
 void MainGalleryWindow::onImageLoaded(int id, const QImage& image) {
     qDebug() << "MainGalleryWindow: Ricevuta immagine ID" << id;
     if (id == m_uiNavigator->currentImageId()) {
-        // Aggiorna la visualizzazione solo se  l'immagine che ci aspettiamo attualmente
-        updateImageDisplay(image);
+        // Aggiorna la visualizzazione solo se  l'immagine che ci aspettiamo attualmente.
+        // Il loader consegna i risultati a blocchi, una volta per frame: ridisegna una sola volta per blocco.
+        m_pendingImage = image;
+        m_pendingImageId = id;
+        m_pendingIsDraft = false;
+        if (!m_displayUpdateQueued) {
+            m_displayUpdateQueued = true;
+            QMetaObject::invokeMethod(this, &MainGalleryWindow::applyPendingImage, Qt::QueuedConnection);
+        }
     }
     // Anche se non  l'immagine corrente, potrebbe essere in cache ora per un uso futuro
 }
 
+/**
+ * @brief Slot to receive draft images from ImageLoader.
+ *
+ * Shows the draft of the current image until the refined version arrives.
+ *
+ * @param id The ID of the image.
+ * @param draft The low-quality draft.
+ */
+void MainGalleryWindow::onImageDraftLoaded(int id, const QImage& draft) {
+    if (id != m_uiNavigator->currentImageId()) {
+        return;
+    }
+    if (m_displayUpdateQueued && m_pendingImageId == id && !m_pendingIsDraft) {
+        return; // La versione definitiva  gi in attesa di essere mostrata
+    }
+    m_pendingImage = draft;
+    m_pendingImageId = id;
+    m_pendingIsDraft = true;
+    if (!m_displayUpdateQueued) {
+        m_displayUpdateQueued = true;
+        QMetaObject::invokeMethod(this, &MainGalleryWindow::applyPendingImage, Qt::QueuedConnection);
+    }
+}
+
 /**
  * @brief Slot to handle image loading errors.
  *
@@ -274,7 +560,161 @@ void MainGalleryWindow::onImageIdChanged(int newId) {
     qDebug() << "MainGalleryWindow: ID immagine cambiato in" << newId;
     updateIdLabel(newId, m_maxImageId);
     updateNavigationButtons(newId, m_maxImageId);
-    m_imageLoader->loadImageAsync(newId); // Richiede il caricamento della nuova immagine
+    // Mentre l'utente scorre velocemente le immagini intermedie restano a schermo troppo poco
+    // per apprezzare uno scaling di qualit: si usa un filtro economico fino a quando si ferma
+    m_imageLoader->setScaleQuality(m_uiNavigator->isNavigatingFast() ? ImageLoader::FastScaling
+                                                                     : ImageLoader::HighQualityScaling);
+    m_displayedImage = QImage(); // Appartiene all'ID precedente
+    showImage(newId); // Richiede il caricamento della nuova immagine
+    // Porta in RAM i byte delle prossime immagini, senza decodificarle
+    m_imageLoader->prefetchEncoded(m_uiNavigator->upcomingIds(READAHEAD_COUNT));
+}
+
+/**
+ * @brief Slot to react to the user pausing on an image.
+ *
+ * Restores high-quality scaling; reloading the current ID shows the cached
+ * quick preview at once and then its high-quality version.
+ *
+ * @param id The current image ID.
+ */
+void MainGalleryWindow::onNavigationSettled(int id) {
+    if (m_imageLoader->scaleQuality() == ImageLoader::HighQualityScaling) {
+        return; // Nessuna raffica veloce: l'immagine  gi in alta qualit
+    }
+    m_imageLoader->setScaleQuality(ImageLoader::HighQualityScaling);
+    showImage(id);
+}
+
+/**
+ * @brief Follows the file on screen to the ID the index moved it to, without reloading it.
+ *
+ * The preview cache, the animation and the zoom view keep showing the same
+ * file; only the IDs that refer to it are updated.
+ *
+ * @param newId The new ID of the current file.
+ */
+void MainGalleryWindow::followCurrentImage(int newId) {
+    const int oldId = m_uiNavigator->currentImageId();
+    if (newId > m_uiNavigator->maxImageId()) {
+        m_uiNavigator->setMaxImageId(newId); // Il nuovo conteggio arriva subito dopo con imageCountChanged
+    }
+    {
+        const QSignalBlocker blocker(m_uiNavigator); // Stesso file: niente ricaricamento
+        m_uiNavigator->setCurrentImageId(newId);
+    }
+    if (m_animatedId == oldId) {
+        m_animatedId = newId;
+    }
+    if (m_pendingImageId == oldId) {
+        m_pendingImageId = newId;
+    }
+    if (m_zoomView && m_zoomView->isVisible() && m_zoomView->imageId() == oldId) {
+        m_zoomView->renumberImage(newId);
+    }
+    updateIdLabel(newId, m_maxImageId);
+    updateNavigationButtons(newId, m_maxImageId);
+    if (m_displayedImage.isNull()) {
+        showImage(newId); // Il caricamento in corso per il vecchio ID viene scartato dal loader
+    }
+}
+
+/**
+ * @brief Slot to react to a new file appearing in the image directory.
+ *
+ * An insertion at or before the current ID moves the current file one ID
+ * up; the current ID follows it, and nothing is reloaded.
+ *
+ * @param id The ID assigned to the new file.
+ */
+void MainGalleryWindow::onImageInserted(int id) {
+    qDebug() << "MainGalleryWindow: Nuova immagine inserita con ID" << id;
+    const int currentId = m_uiNavigator->currentImageId();
+    if (id <= currentId && !m_imageLoader->isPlaceholder(currentId + 1)) {
+        followCurrentImage(currentId + 1);
+    } else if (id <= currentId) {
+        showImage(currentId); // Un segnaposto: l'ID corrente ora indica il nuovo file
+    }
+}
+
+/**
+ * @brief Slot to react to a file disappearing from the image directory.
+ *
+ * A removal before the current ID moves the current file one ID down and the
+ * current ID follows it. Only the removal of the current file itself
+ * reloads: the next file now has its ID.
+ *
+ * @param id The ID the removed file used to have.
+ */
+void MainGalleryWindow::onImageRemoved(int id) {
+    qDebug() << "MainGalleryWindow: Immagine rimossa con ID" << id;
+    const int currentId = m_uiNavigator->currentImageId();
+    if (id < currentId && !m_imageLoader->isPlaceholder(currentId - 1)) {
+        followCurrentImage(currentId - 1);
+    } else if (id <= currentId) {
+        m_animatedId = -1; // L'ID corrente ora indica un altro file
+        showImage(currentId);
+    }
+}
+
+/**
+ * @brief Slot to react to an image file being modified on disk.
+ *
+ * @param id The ID of the modified file.
+ */
+void MainGalleryWindow::onImageModified(int id) {
+    qDebug() << "MainGalleryWindow: Immagine modificata con ID" << id;
+    if (id == m_uiNavigator->currentImageId()) {
+        m_animatedId = -1; // Il file  cambiato: l'animazione riparte da capo
+        showImage(id);
+    }
+}
+
+/**
+ * @brief Slot to react to a change of the total number of images.
+ *
+ * If the current ID falls outside the new range, UINavigator clamps it and
+ * emits imageIdChanged, which in turn triggers the reload.
+ *
+ * @param count The new total number of images.
+ */
+void MainGalleryWindow::onImageCountChanged(int count) {
+    qDebug() << "MainGalleryWindow: Numero di immagini cambiato in" << count;
+    m_maxImageId = count - 1;
+    m_uiNavigator->setMaxImageId(m_maxImageId);
+    updateIdLabel(m_uiNavigator->currentImageId(), m_maxImageId);
+    updateNavigationButtons(m_uiNavigator->currentImageId(), m_maxImageId);
+}
+
+/**
+ * @brief Slot for the zoom shortcut (Z).
+ *
+ * Switches between the fitted preview and the zoom/pan view of the current image.
+ */
+void MainGalleryWindow::toggleZoomMode() {
+    setZoomMode(!m_zoomView->isVisible());
+}
+
+/**
+ * @brief Enters or leaves zoom mode.
+ *
+ * @param enabled True to enter zoom mode.
+ */
+void MainGalleryWindow::setZoomMode(bool enabled) {
+    const int id = m_uiNavigator->currentImageId();
+    if (enabled && m_imageLoader->isPlaceholder(id)) {
+        return; // I segnaposto non hanno un file da decodificare a tile
+    }
+    if (enabled) {
+        ui->imageLabel->hide();
+        m_zoomView->show(); // Prima di setImage(): una vista nascosta non richiede tile
+        m_zoomView->setImage(id, m_displayedImage);
+        m_zoomView->setFocus();
+    } else {
+        m_zoomView->hide();
+        ui->imageLabel->show();
+        m_tileLoader->requestTiles(id, 0, QRect()); // Annulla i tile ancora in attesa
+    }
 }
 
 /**
@@ -0,0 +1,369 @@
+/**
+ * @file zoompanview.cpp
+ * @brief Implementation of the ZoomPanView class.
+ */
+#include "zoompanview.h"
+
+#include <QPainter>     // Per disegnare anteprima e tile
+#include <QPaintEvent>  // Per paintEvent
+#include <QWheelEvent>  // Per lo zoom con la rotella
+#include <QMouseEvent>  // Per il trascinamento
+#include <QKeyEvent>    // Per i tasti di zoom e di uscita
+#include <QtMath>       // Per qPow
+
+namespace {
+/**
+ * @brief Largest zoom: widget pixels per full-resolution pixel.
+ */
+constexpr qreal MAX_SCALE = 8.0;
+
+/**
+ * @brief Zoom factor of one key press.
+ */
+constexpr qreal KEY_ZOOM_STEP = 1.25;
+
+/**
+ * @brief Zoom factor per eighth of a degree of wheel rotation (a notch of 15 degrees zooms by about 20%).
+ */
+constexpr qreal WHEEL_ZOOM_BASE = 1.0015;
+
+/**
+ * @brief How many coarser levels are drawn under the current one while its tiles arrive.
+ */
+constexpr int FALLBACK_LEVELS = 3;
+}
+
+/**
+ * @brief Constructs the view.
+ *
+ * @param tiles The tile loader providing the image; not owned.
+ * @param parent Pointer to the parent widget.
+ */
+ZoomPanView::ZoomPanView(TileLoader* tiles, QWidget* parent)
+    : QWidget(parent),
+    m_tiles(tiles),
+    m_id(-1),
+    m_levelCount(0),
+    m_scale(1.0),
+    m_fitted(true),
+    m_dragging(false)
+{
+    setFocusPolicy(Qt::StrongFocus); // Serve per ricevere Esc e i tasti di zoom
+    setAttribute(Qt::WA_OpaquePaintEvent); // Lo sfondo è dipinto da paintEvent
+    setCursor(Qt::OpenHandCursor);
+    connect(m_tiles, &TileLoader::tileLoaded, this, &ZoomPanView::onTileLoaded);
+    connect(m_tiles, &TileLoader::imageSizeKnown, this, &ZoomPanView::onImageSizeKnown);
+}
+
+/**
+ * @brief Shows an image, fitted to the view.
+ *
+ * @param id The image ID.
+ * @param preview A downscaled version of the image drawn under the tiles; may be null.
+ */
+void ZoomPanView::setImage(int id, const QImage& preview) {
+    m_id = id;
+    m_imageSize = m_tiles->imageSize(id);
+    m_levelCount = m_tiles->levelCount(id);
+    m_preview = preview;
+    m_fitted = true;
+    m_scale = fitScale();
+    m_centre = QRectF(QPointF(0, 0), QSizeF(m_imageSize)).center();
+    requestVisibleTiles();
+    update();
+}
+
+/**
+ * @brief Replaces the preview drawn under the tiles.
+ *
+ * @param preview A downscaled version of the current image; may be null.
+ */
+void ZoomPanView::setPreview(const QImage& preview) {
+    m_preview = preview;
+    update();
+}
+
+/**
+ * @brief Follows the image shown to a new ID, keeping the zoom and the position.
+ *
+ * @param id The new ID of the image shown.
+ */
+void ZoomPanView::renumberImage(int id) {
+    if (m_imageSize.isEmpty()) {
+        setImage(id, m_preview); // Dimensioni ancora ignote: le si chiede con il nuovo ID
+        return;
+    }
+    m_id = id;
+    requestVisibleTiles(); // I tile in cache erano indicizzati con il vecchio ID
+    update();
+}
+
+/**
+ * @brief Returns the ID of the image shown.
+ * @return The image ID, or -1 if none.
+ */
+int ZoomPanView::imageId() const {
+    return m_id;
+}
+
+/**
+ * @brief Returns the zoom at which the whole image fits the view.
+ *
+ * Small images are not enlarged: the fitted zoom is at most 1.
+ *
+ * @return Widget pixels per full-resolution pixel.
+ */
+qreal ZoomPanView::fitScale() const {
+    if (m_imageSize.isEmpty() || width() <= 0 || height() <= 0) {
+        return 1.0;
+    }
+    return qMin<qreal>(1.0, qMin(qreal(width()) / m_imageSize.width(), qreal(height()) / m_imageSize.height()));
+}
+
+/**
+ * @brief Sets the zoom, keeping the image point under `anchor` in place.
+ *
+ * @param scale The new zoom; clamped between the fitted zoom and the maximum.
+ * @param anchor The fixed point, in widget coordinates.
+ */
+void ZoomPanView::zoomTo(qreal scale, const QPointF& anchor) {
+    const qreal minScale = fitScale();
+    scale = qBound(minScale, scale, qMax(minScale, MAX_SCALE));
+    const QPointF viewCentre(width() / 2.0, height() / 2.0);
+    const QPointF anchored = m_centre + (anchor - viewCentre) / m_scale; // Punto dell'immagine sotto l'ancora
+
+    m_scale = scale;
+    m_fitted = qFuzzyCompare(scale, minScale);
+    m_centre = anchored - (anchor - viewCentre) / m_scale;
+    clampCentre();
+    requestVisibleTiles();
+    update();
+}
+
+/**
+ * @brief Keeps the image inside the view: centred if smaller, edge to edge if larger.
+ */
+void ZoomPanView::clampCentre() {
+    const qreal halfWidth = width() / (2.0 * m_scale);
+    const qreal halfHeight = height() / (2.0 * m_scale);
+    if (2 * halfWidth >= m_imageSize.width()) {
+        m_centre.setX(m_imageSize.width() / 2.0);
+    } else {
+        m_centre.setX(qBound(halfWidth, m_centre.x(), m_imageSize.width() - halfWidth));
+    }
+    if (2 * halfHeight >= m_imageSize.height()) {
+        m_centre.setY(m_imageSize.height() / 2.0);
+    } else {
+        m_centre.setY(qBound(halfHeight, m_centre.y(), m_imageSize.height() - halfHeight));
+    }
+}
+
+/**
+ * @brief Returns the part of the image visible in the view.
+ * @return The region, in full-resolution pixels.
+ */
+QRectF ZoomPanView::visibleImageRect() const {
+    const QSizeF visible(width() / m_scale, height() / m_scale);
+    const QRectF view(m_centre - QPointF(visible.width() / 2, visible.height() / 2), visible);
+    return view.intersected(QRectF(QPointF(0, 0), QSizeF(m_imageSize)));
+}
+
+/**
+ * @brief Returns the pyramid level matching the current zoom.
+ *
+ * The zoom is taken in device pixels, so that high-DPI screens get the
+ * resolution they can show.
+ *
+ * @return The level.
+ */
+int ZoomPanView::currentLevel() const {
+    return qBound(0, TileLoader::levelForScale(m_scale * devicePixelRatioF()), qMax(0, m_levelCount - 1));
+}
+
+/**
+ * @brief Asks the tile loader for the tiles of the visible region.
+ */
+void ZoomPanView::requestVisibleTiles() {
+    if (m_id < 0 || m_imageSize.isEmpty() || !isVisible()) {
+        return;
+    }
+    const int level = currentLevel();
+    const QSize levelSize = TileLoader::levelSize(m_imageSize, level);
+    const qreal sx = qreal(levelSize.width()) / m_imageSize.width();
+    const qreal sy = qreal(levelSize.height()) / m_imageSize.height();
+    const QRectF visible = visibleImageRect();
+    m_tiles->requestTiles(m_id, level, QRectF(visible.x() * sx, visible.y() * sy,
+                                              visible.width() * sx, visible.height() * sy).toAlignedRect());
+}
+
+/**
+ * @brief Draws the preview, then the cached tiles from coarse to fine.
+ *
+ * Finer tiles are painted over coarser ones, so while the tiles of the
+ * current level arrive the view shows the best resolution already decoded.
+ *
+ * @param event The paint event.
+ */
+void ZoomPanView::paintEvent(QPaintEvent* event) {
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().color(QPalette::Window));
+    if (m_id < 0 || m_imageSize.isEmpty()) {
+        return;
+    }
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+    // Da coordinate dell'immagine a coordinate del widget
+    const QPointF origin = QPointF(width() / 2.0, height() / 2.0) - m_centre * m_scale;
+    const QRectF imageRect(origin, QSizeF(m_imageSize) * m_scale);
+    if (!m_preview.isNull()) {
+        painter.drawImage(imageRect, m_preview);
+    }
+
+    const QRectF visible = visibleImageRect();
+    const int tileSize = TileLoader::tileSize();
+    const int level = currentLevel();
+    for (int l = qMin(level + FALLBACK_LEVELS, m_levelCount - 1); l >= level; --l) {
+        const QSize levelSize = TileLoader::levelSize(m_imageSize, l);
+        const qreal sx = qreal(m_imageSize.width()) / levelSize.width();   // Pixel a piena risoluzione per pixel del livello
+        const qreal sy = qreal(m_imageSize.height()) / levelSize.height();
+        const QRect region = QRectF(visible.x() / sx, visible.y() / sy, visible.width() / sx, visible.height() / sy)
+                                 .toAlignedRect();
+        if (region.isEmpty()) {
+            continue;
+        }
+        for (int ty = region.top() / tileSize; ty <= region.bottom() / tileSize; ++ty) {
+            for (int tx = region.left() / tileSize; tx <= region.right() / tileSize; ++tx) {
+                const QImage tile = m_tiles->tile(TileKey{ m_id, l, tx, ty });
+                if (tile.isNull()) {
+                    continue;
+                }
+                const QRectF target(origin.x() + tx * tileSize * sx * m_scale,
+                                    origin.y() + ty * tileSize * sy * m_scale,
+                                    tile.width() * sx * m_scale,
+                                    tile.height() * sy * m_scale);
+                painter.drawImage(target, tile);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Keeps the image fitted, or its centre in place, when the view is resized.
+ * @param event The resize event.
+ */
+void ZoomPanView::resizeEvent(QResizeEvent* event) {
+    QWidget::resizeEvent(event);
+    if (m_fitted) {
+        m_scale = fitScale();
+    } else {
+        m_scale = qMax(m_scale, fitScale());
+    }
+    clampCentre();
+    requestVisibleTiles();
+}
+
+/**
+ * @brief Zooms around the cursor.
+ * @param event The wheel event.
+ */
+void ZoomPanView::wheelEvent(QWheelEvent* event) {
+    zoomTo(m_scale * qPow(WHEEL_ZOOM_BASE, event->angleDelta().y()), event->position());
+    event->accept();
+}
+
+/**
+ * @brief Starts a drag.
+ * @param event The mouse event.
+ */
+void ZoomPanView::mousePressEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = true;
+        m_lastDragPos = event->position();
+        setCursor(Qt::ClosedHandCursor);
+    }
+    QWidget::mousePressEvent(event);
+}
+
+/**
+ * @brief Pans while dragging.
+ * @param event The mouse event.
+ */
+void ZoomPanView::mouseMoveEvent(QMouseEvent* event) {
+    if (!m_dragging) {
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+    m_centre -= (event->position() - m_lastDragPos) / m_scale; // L'immagine segue il cursore
+    m_lastDragPos = event->position();
+    clampCentre();
+    requestVisibleTiles();
+    update();
+}
+
+/**
+ * @brief Ends a drag.
+ * @param event The mouse event.
+ */
+void ZoomPanView::mouseReleaseEvent(QMouseEvent* event) {
+    if (event->button() == Qt::LeftButton) {
+        m_dragging = false;
+        setCursor(Qt::OpenHandCursor);
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+/**
+ * @brief Emits `closeRequested`.
+ * @param event The mouse event.
+ */
+void ZoomPanView::mouseDoubleClickEvent(QMouseEvent* event) {
+    event->accept();
+    emit closeRequested();
+}
+
+/**
+ * @brief Handles the zoom keys and Escape.
+ * @param event The key event.
+ */
+void ZoomPanView::keyPressEvent(QKeyEvent* event) {
+    const QPointF viewCentre(width() / 2.0, height() / 2.0);
+    switch (event->key()) {
+    case Qt::Key_Escape:
+        emit closeRequested();
+        break;
+    case Qt::Key_Plus:
+    case Qt::Key_Equal: // '+' senza Maiusc sulle tastiere US
+        zoomTo(m_scale * KEY_ZOOM_STEP, viewCentre);
+        break;
+    case Qt::Key_Minus:
+        zoomTo(m_scale / KEY_ZOOM_STEP, viewCentre);
+        break;
+    case Qt::Key_0:
+        zoomTo(fitScale(), viewCentre);
+        break;
+    default:
+        QWidget::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+/**
+ * @brief Repaints when a tile of the current image arrives.
+ * @param key The tile.
+ */
+void ZoomPanView::onTileLoaded(const TileKey& key) {
+    if (key.id == m_id) {
+        update(); // Più tile arrivati nello stesso giro di eventi producono un solo ridisegno
+    }
+}
+
+/**
+ * @brief Fits the current image once its size is known, if it was not when it was set.
+ * @param id The image whose header has been probed.
+ */
+void ZoomPanView::onImageSizeKnown(int id) {
+    if (id == m_id && m_imageSize.isEmpty()) {
+        setImage(id, m_preview);
+    }
+}
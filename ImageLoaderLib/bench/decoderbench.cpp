@@ -0,0 +1,170 @@
+/**
+ * @file decoderbench.cpp
+ * @brief Measures decode throughput per format and per decoding backend.
+ *
+ * Every sample file is decoded by each backend that accepts it (the native
+ * ones this build has, and Qt's plugins) at full resolution and, where the
+ * backend supports it, at a reduced resolution as the preview path does.
+ * Files are read into memory first, so only decoding is timed. Results are
+ * the median of several runs per file, summed per format.
+ */
+#include "imagedecoder.h"
+
+#include <QBuffer>            // For naming the format of a sample
+#include <QCommandLineParser> // For the command line
+#include <QCoreApplication>   // For the image plugins
+#include <QDirIterator>       // For sample directories
+#include <QElapsedTimer>      // For timing
+#include <QFile>              // For reading the samples
+#include <QFileInfo>          // For telling files from directories
+#include <QImageReader>       // For naming the format of a sample
+#include <QMap>               // For the sorted results
+#include <QTextStream>        // For the report
+#include <algorithm>          // For std::sort
+
+namespace {
+/**
+ * @brief Accumulated measurements of one backend on one format at one resolution.
+ */
+struct Measurement {
+    int files = 0;         ///< Number of files decoded.
+    qint64 pixels = 0;     ///< Decoded pixels, summed over the files.
+    qint64 bytes = 0;      ///< Encoded bytes, summed over the files.
+    qint64 nanoseconds = 0; ///< Median decode time, summed over the files.
+};
+
+/**
+ * @brief Decodes a sample repeatedly and returns the median time.
+ *
+ * @param decoder The backend.
+ * @param input The encoded sample.
+ * @param size The size to decode at.
+ * @param iterations The number of timed runs.
+ * @return The median time in nanoseconds, or -1 if decoding failed.
+ */
+qint64 medianDecodeTime(const ImageDecoder* decoder, const ImageDecoder::Input& input, const QSize& size, int iterations) {
+    QImage image;
+    if (!decoder->decode(input, size, &image)) {
+        return -1; // Also warms up caches and allocates the buffer reused by the timed runs
+    }
+    QVector<qint64> times;
+    times.reserve(iterations);
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; ++i) {
+        timer.start();
+        decoder->decode(input, size, &image);
+        times.append(timer.nsecsElapsed());
+    }
+    std::sort(times.begin(), times.end());
+    return times.at(times.size() / 2);
+}
+
+/**
+ * @brief Lists the sample files named on the command line, expanding directories.
+ *
+ * @param arguments Files and directories.
+ * @return The files.
+ */
+QStringList collectSamples(const QStringList& arguments) {
+    QStringList files;
+    for (const QString& argument : arguments) {
+        if (QFileInfo(argument).isDir()) {
+            QDirIterator it(argument, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                files.append(it.next());
+            }
+        } else {
+            files.append(argument);
+        }
+    }
+    return files;
+}
+}
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("decoderbench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures decode throughput per format and per backend."));
+    parser.addHelpOption();
+    const QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Timed runs per file (default 5)."),
+                                              QStringLiteral("n"), QStringLiteral("5"));
+    const QCommandLineOption scaleOption(QStringLiteral("scale"), QStringLiteral("Divisor of the reduced-resolution runs (default 8)."),
+                                         QStringLiteral("d"), QStringLiteral("8"));
+    parser.addOption(iterationsOption);
+    parser.addOption(scaleOption);
+    parser.addPositionalArgument(QStringLiteral("samples"), QStringLiteral("Image files or directories."), QStringLiteral("<path>..."));
+    parser.process(app);
+
+    const int iterations = qMax(1, parser.value(iterationsOption).toInt());
+    const int scale = qMax(2, parser.value(scaleOption).toInt());
+    const QStringList samples = collectSamples(parser.positionalArguments());
+    if (samples.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    ImageDecoderRegistry* registry = ImageDecoderRegistry::instance();
+    QVector<const ImageDecoder*> backends = registry->decoders();
+    backends.append(registry->fallback());
+
+    // (format, backend, resolution) -> measurements
+    QMap<QString, Measurement> results;
+    QTextStream err(stderr);
+    for (const QString& path : samples) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QByteArray bytes = file.readAll();
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::ReadOnly);
+        const QByteArray format = QImageReader::imageFormat(&buffer);
+        if (format.isEmpty()) {
+            continue; // Not an image
+        }
+
+        ImageDecoder::Input input;
+        input.data = reinterpret_cast<const uchar*>(bytes.constData());
+        input.size = bytes.size();
+        input.format = format;
+
+        for (const ImageDecoder* decoder : std::as_const(backends)) {
+            ImageDecoder::Header header;
+            if (!decoder->canDecode(input.data, input.size) || !decoder->readHeader(input, &header)) {
+                continue;
+            }
+            QVector<QPair<QString, QSize>> runs;
+            runs.append({ QStringLiteral("full"), header.size });
+            if (decoder->cheapScaledDecode(input)) {
+                const QSize requested((header.size.width() + scale - 1) / scale, (header.size.height() + scale - 1) / scale);
+                runs.append({ QStringLiteral("1/%1").arg(scale), decoder->scaledDecodeSize(header.size, requested) });
+            }
+            for (const auto& run : std::as_const(runs)) {
+                const qint64 nanoseconds = medianDecodeTime(decoder, input, run.second, iterations);
+                if (nanoseconds < 0) {
+                    err << "Decode failed: " << path << " with " << decoder->name() << "\n";
+                    continue;
+                }
+                Measurement& m = results[QStringLiteral("%1\t%2\t%3").arg(QString::fromLatin1(format),
+                                                                         QString::fromLatin1(decoder->name()), run.first)];
+                ++m.files;
+                m.pixels += qint64(run.second.width()) * run.second.height();
+                m.bytes += input.size;
+                m.nanoseconds += nanoseconds;
+            }
+        }
+    }
+
+    QTextStream out(stdout);
+    out << "format\tbackend\tsize\tfiles\tMPix/s\tMB/s\tms/file\n";
+    for (auto it = results.cbegin(); it != results.cend(); ++it) {
+        const Measurement& m = it.value();
+        const double seconds = qMax<qint64>(1, m.nanoseconds) / 1e9;
+        out << it.key() << '\t' << m.files << '\t'
+            << QString::number(m.pixels / 1e6 / seconds, 'f', 1) << '\t'
+            << QString::number(m.bytes / 1e6 / seconds, 'f', 1) << '\t'
+            << QString::number(seconds * 1e3 / m.files, 'f', 2) << '\n';
+    }
+    return 0;
+}
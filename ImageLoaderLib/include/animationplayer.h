@@ -0,0 +1,144 @@
+/**
+ * @file animationplayer.h
+ * @brief Declaration of the AnimationPlayer class, which streams the frames of animated images.
+ *
+ * This file defines the AnimationPlayer class. A worker thread decodes the
+ * frames of an animated GIF or WebP one at a time into a small ring of
+ * upcoming frames; the player hands them out on its own thread at the
+ * delays stored in the file. However long the animation, only the ring is
+ * ever held in memory.
+ */
+#ifndef IMAGELOADERLIB_ANIMATIONPLAYER_H
+#define IMAGELOADERLIB_ANIMATIONPLAYER_H
+
+#include <QObject>        // Base class for Qt objects
+#include <QImage>         // For the frames
+#include <QSize>          // For the frame size
+#include <QString>        // For file paths
+#include <QByteArray>     // For encoded format names
+#include <QSharedPointer> // For the frame ring shared with the decoder thread
+#include <QElapsedTimer>  // For the presentation clock
+
+class QTimer;
+
+// Macro standard per l'esportazione/importazione (come in imageloader.h)
+#ifndef IMAGELOADERLIB_EXPORT
+#  if defined(IMAGELOADERLIB_LIBRARY)
+#    define IMAGELOADERLIB_EXPORT Q_DECL_EXPORT
+#  else
+#    define IMAGELOADERLIB_EXPORT Q_DECL_IMPORT
+#  endif
+#endif
+
+/**
+ * @brief Plays an animated image by streaming its frames through a bounded ring.
+ *
+ * The decoder runs ahead of the presentation by at most the capacity of the
+ * ring, then blocks until a frame is shown. Frames are presented by a timer
+ * on the player's thread, which never waits for the decoder: a frame that
+ * is late is shown as soon as it arrives and the schedule resumes from there.
+ *
+ * Files that turn out to hold a single image emit `finished` without any frame.
+ *
+ * Stopping never waits for the decoder: the ring is closed and left to the
+ * decoder thread, which finishes the frame it is on, if any, and then
+ * deletes itself and the ring.
+ */
+class IMAGELOADERLIB_EXPORT AnimationPlayer : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs an idle player.
+     * @param parent Pointer to the parent QObject.
+     */
+    explicit AnimationPlayer(QObject* parent = nullptr);
+
+    /**
+     * @brief Stops playback and destroys the player.
+     */
+    ~AnimationPlayer();
+
+    /**
+     * @brief Tells whether files of a format may hold an animation.
+     *
+     * @param format The encoded format, as reported by QImageReader.
+     * @return True for GIF and WebP.
+     */
+    static bool canAnimate(const QByteArray& format);
+
+    /**
+     * @brief Starts playing a file, replacing the current animation.
+     *
+     * @param path The image file.
+     * @param maxSize Frames larger than this are scaled down to fit, keeping their aspect ratio.
+     * @param format The probed format, passed to the decoder so it does not probe the plugins; may be empty.
+     */
+    void play(const QString& path, const QSize& maxSize, const QByteArray& format = QByteArray());
+
+    /**
+     * @brief Changes the size frames are scaled down to, from the next frame decoded on.
+     *
+     * @param maxSize Frames larger than this are scaled down to fit, keeping their aspect ratio.
+     */
+    void setMaxSize(const QSize& maxSize);
+
+    /**
+     * @brief Stops playback and releases the frames, without waiting for the decoder.
+     */
+    void stop();
+
+    /**
+     * @brief Returns the file being played.
+     * @return The path, or an empty string when stopped.
+     */
+    QString path() const;
+
+signals:
+    /**
+     * @brief Emitted when a frame is due on screen.
+     * @param frame The frame.
+     */
+    void frameReady(const QImage& frame);
+
+    /**
+     * @brief Emitted when the animation has played its last loop, or the file is not animated.
+     */
+    void finished();
+
+private:
+    /**
+     * @brief A decoded frame and how long it stays on screen.
+     */
+    struct Frame {
+        QImage image;  ///< The frame; null marks the end of the animation.
+        int delay = 0; ///< Display time in milliseconds.
+    };
+
+    /**
+     * @brief What the player and its decoder thread share: the frame ring and the frame size.
+     */
+    struct Stream;
+
+    /**
+     * @brief Decodes the frames of a file into the ring; runs on the worker thread.
+     *
+     * @param path The image file.
+     * @param format The format hint; may be empty.
+     * @param stream The ring to fill and the largest frame size.
+     */
+    static void decodeFrames(const QString& path, const QByteArray& format, const QSharedPointer<Stream>& stream);
+
+    /**
+     * @brief Presents the next frame if it is ready; runs on the player's thread.
+     */
+    void presentNextFrame();
+
+    QSharedPointer<Stream> m_stream; ///< Frames decoded ahead of presentation; null when stopped.
+    QTimer* m_timer;         ///< Fires when the next frame is due.
+    QElapsedTimer m_clock;   ///< Time since playback started.
+    qint64 m_nextDue;        ///< When the next frame is due, on `m_clock`, in milliseconds.
+    QString m_path;          ///< The file being played.
+};
+
+#endif // IMAGELOADERLIB_ANIMATIONPLAYER_H
@@ -15,6 +15,33 @@
 #include <QString>      // For string handling
 #include <QVector>      // For the lookup table of image paths
 #include <QSize>        // For image dimensions
+#include <QHash>        // For the per-file change stamps
+#include <QDateTime>    // For file modification times
+#include <QFileInfo>    // For directory listings
+#include <QByteArray>   // For encoded format names
+#include <QStringList>  // For the individually watched files
+#include <QMutex>       // For the jobs parked for decode memory
+#include <QSet>         // For the previews whose upgrade was attempted
+#include <QScopedPointer> // For owning internal helpers
+#include <QSharedPointer> // For pipeline jobs
+#include <QQueue>       // For jobs waiting to enter the pipeline
+#include <QAtomicInt>   // For the publish queue depth
+#include <QFuture>      // For requestImage()
+#include <QMultiHash>   // For the jobs in flight per ID
+#include <QPair>        // For batched (ID, image) results
+
+class QFileSystemWatcher;
+class QTimer;
+class QThreadPool;
+class MemoryBudget;
+class ReadaheadCache;
+class LoadPipeline;
+class PlaceholderRenderer;
+class SvgRasterizer;
+class ImageDecoder;
+struct LoadJob;
+struct LoadCompletion;
+template <typename T> class MpscRing;
 
 #include "imagecache.h" // Include the ImageCacheLib header (ora senza namespace)
 
@@ -28,10 +55,11 @@
 // Namespace ImageGallery::Loader rimosso
 
 /**
- * @brief A structure to hold image name and image data.
+ * @brief A structure to hold image name, image data and header metadata.
  *
- * This structure is used internally by the ImageLoader to manage
- * information about individual images, primarily their name and QImage data.
+ * This structure is used by the ImageLoader to manage information about
+ * individual images: their name, the header metadata gathered by the probe
+ * pass (available before any pixel is decoded) and, optionally, the QImage data.
  */
 struct ImageData {
     /**
@@ -42,6 +70,105 @@ struct ImageData {
      * @brief The actual image data.
      */
     QImage image; // The actual image data
+    /**
+     * @brief The full-resolution dimensions read from the file header, before EXIF orientation.
+     * Invalid if the header could not be read.
+     */
+    QSize size;
+    /**
+     * @brief The encoded file format as reported by QImageReader (e.g. "jpeg", "png").
+     */
+    QByteArray format;
+    /**
+     * @brief The pixel format the decoder will produce, if the plugin can tell in advance.
+     */
+    QImage::Format pixelFormat = QImage::Format_Invalid;
+    /**
+     * @brief The EXIF orientation as a QImageIOHandler::Transformations bit mask.
+     *
+     * Previews are delivered (and cached) with this orientation already applied.
+     */
+    quint8 transformation = 0;
+    /**
+     * @brief True once the header probe has run for this image.
+     */
+    bool probed = false;
+};
+
+/**
+ * @brief Header metadata for every indexed file, stored as a structure of arrays.
+ *
+ * Each column is indexed by image ID. Keeping the fields in separate,
+ * contiguous arrays lets scheduling and memory-admission code scan a single
+ * attribute (typically `sizes`) over thousands of images without touching
+ * the others. Rows are kept aligned with the loader's path index.
+ */
+struct IMAGELOADERLIB_EXPORT ImageMetadataTable {
+    QVector<QString> names;                 ///< File names.
+    QVector<QSize> sizes;                   ///< Full-resolution dimensions.
+    QVector<QByteArray> formats;            ///< Encoded formats ("jpeg", "png", ...).
+    QVector<QImage::Format> pixelFormats;   ///< Pixel formats the decoders will produce.
+    QVector<quint8> transformations;        ///< EXIF orientations (QImageIOHandler::Transformations).
+    QVector<quint8> probed;                 ///< Non-zero once the row has been probed.
+
+    /**
+     * @brief Returns the number of rows in the table.
+     * @return The number of rows.
+     */
+    int size() const;
+    /**
+     * @brief Resizes every column to `rows` entries; new rows are unprobed.
+     * @param rows The new number of rows.
+     */
+    void resize(int rows);
+    /**
+     * @brief Inserts an unprobed row at `id`, shifting the following rows up.
+     * @param id The position of the new row.
+     */
+    void insertRow(int id);
+    /**
+     * @brief Removes the row at `id`, shifting the following rows down.
+     * @param id The row to remove.
+     */
+    void removeRow(int id);
+    /**
+     * @brief Stores the metadata of `data` in row `id`.
+     * @param id The row to write.
+     * @param data The metadata to store; `data.image` is ignored.
+     */
+    void setRow(int id, const ImageData& data);
+    /**
+     * @brief Assembles the row `id` into an ImageData value (without pixels).
+     * @param id The row to read.
+     * @return The metadata of the row, or a default ImageData if `id` is out of range.
+     */
+    ImageData row(int id) const;
+};
+
+/**
+ * @brief Thread counts and queue capacities of the ImageLoader pipeline stages.
+ *
+ * A thread count of 0 selects a default derived from QThread::idealThreadCount().
+ */
+struct LoaderPipelineConfig {
+    int ioThreads = 2;             ///< Workers reading encoded bytes into memory.
+    int decodeThreads = 0;         ///< Workers decoding pixels (default: one per core).
+    int scaleThreads = 0;          ///< Workers scaling to the preview (default: half the cores).
+    int ioQueueCapacity = 64;      ///< Jobs waiting for the I/O stage.
+    int decodeQueueCapacity = 8;   ///< Jobs read and waiting for a decoder.
+    int scaleQueueCapacity = 8;    ///< Jobs decoded and waiting to be scaled.
+};
+
+/**
+ * @brief A snapshot of the queue depths of the ImageLoader pipeline, for tuning.
+ */
+struct LoaderPipelineStats {
+    int ioQueueDepth = 0;          ///< Jobs waiting for the I/O stage.
+    int decodeQueueDepth = 0;      ///< Jobs waiting for the decode stage.
+    int scaleQueueDepth = 0;       ///< Jobs waiting for the scale stage.
+    int publishQueueDepth = 0;     ///< Finished jobs waiting for the loader's thread (completion ring included).
+    int overflowDepth = 0;         ///< Jobs parked because the I/O queue was full.
+    qint64 decodeBytesInFlight = 0; ///< Memory reserved by in-flight decodes.
 };
 
 /**
@@ -58,6 +185,15 @@ class IMAGELOADERLIB_EXPORT ImageLoader : public QObject {
     Q_OBJECT
 
 public:
+    /**
+     * @brief Filter used to scale decoded images down to their preview.
+     */
+    enum ScaleQuality {
+        FastScaling,        ///< Point sampling: for images that are only on screen briefly.
+        HighQualityScaling  ///< Area averaging: for the image the user actually looks at.
+    };
+    Q_ENUM(ScaleQuality)
+
     /**
      * @brief Constructor for ImageLoader.
      *
@@ -90,6 +226,35 @@ public:
      */
     int imageCount() const;
 
+    /**
+     * @brief Returns true if an ID has no image file and shows a placeholder.
+     *
+     * Placeholders are never cached nor loaded through the pipeline: views
+     * can paint them directly with placeholderRenderer() instead of
+     * requesting an image.
+     *
+     * @param id The image ID.
+     * @return True if `id` is in range and beyond the real image files.
+     */
+    bool isPlaceholder(int id) const;
+
+    /**
+     * @brief Returns the renderer used for placeholder images.
+     *
+     * @return The renderer, owned by the loader.
+     */
+    const PlaceholderRenderer* placeholderRenderer() const;
+
+    /**
+     * @brief Returns the rasterizer used for SVG documents.
+     *
+     * Views showing an SVG file should rasterize it at their own size with
+     * SvgRasterizer::requestRender() rather than scale the preview.
+     *
+     * @return The rasterizer, owned by the loader.
+     */
+    SvgRasterizer* svgRasterizer() const;
+
     /**
      * @brief Asynchronously loads an image by its ID.
      *
@@ -102,6 +267,206 @@ public:
      */
     void loadImageAsync(int id);
 
+    /**
+     * @brief Requests an image and returns a future for it.
+     *
+     * Unlike loadImageAsync(), the result is delivered only to the returned
+     * future (and its continuations); `imageLoaded` is not emitted for it.
+     * Preview-sized results are still served from and stored in the cache.
+     *
+     * Cancelling the future tells the pipeline the result is no longer
+     * needed: once every requester of an image has cancelled, the remaining
+     * stages skip it. If the ID starts referring to another file while the
+     * request is in flight, the future is cancelled too.
+     *
+     * @param id The ID (index) of the image to load.
+     * @param size The bounding box of the image, keeping aspect ratio;
+     *             an invalid size means the maximum preview size.
+     * @param priority Requests with a higher priority are scheduled first.
+     * @return A future receiving the image. It is cancelled on invalid IDs
+     *         and stale results.
+     */
+    QFuture<QImage> requestImage(int id, const QSize& size = QSize(), int priority = 0);
+
+    /**
+     * @brief Loads a contiguous range of images as one batch.
+     *
+     * Meant for filmstrips and contact sheets: instead of one `imageLoaded`
+     * per image, the results (cached ones included) are collected and
+     * delivered through `imagesLoaded` in chunks, at most once per frame.
+     * IDs outside [0, imageCount()) are ignored.
+     *
+     * @param first The first ID of the range.
+     * @param last The last ID of the range, inclusive.
+     * @param size The bounding box of the images, keeping aspect ratio;
+     *             an invalid size means the maximum preview size.
+     */
+    void loadRange(int first, int last, const QSize& size = QSize());
+
+    /**
+     * @brief Loads an arbitrary set of images as one batch.
+     *
+     * Same as loadRange(), for IDs that are not contiguous.
+     *
+     * @param ids The IDs to load, most urgent first.
+     * @param size The bounding box of the images; invalid for the maximum preview size.
+     */
+    void loadImages(const QVector<int>& ids, const QSize& size = QSize());
+
+    /**
+     * @brief Sets the filter used for loadImageAsync() and batch loads from now on.
+     *
+     * Views switch to FastScaling while the user flips quickly through the
+     * images and back to HighQualityScaling once navigation settles.
+     * Previews scaled with the fast filter are cached like the others; a
+     * high-quality request for one of them delivers the cached preview right
+     * away and then the re-scaled one, and when the loader has been idle for
+     * a moment it re-scales the remaining ones in the background.
+     * requestImage() always uses high quality.
+     *
+     * @param quality The new scaling quality.
+     */
+    void setScaleQuality(ScaleQuality quality);
+
+    /**
+     * @brief Returns the filter used for loadImageAsync() and batch loads.
+     *
+     * @return The current scaling quality.
+     */
+    ScaleQuality scaleQuality() const;
+
+    /**
+     * @brief Returns the header metadata of an image.
+     *
+     * The metadata is filled in by the background probe pass; until then
+     * the returned value has `probed == false`. Placeholder IDs never have
+     * metadata.
+     *
+     * @param id The ID of the image.
+     * @return The metadata of the image, without pixel data.
+     */
+    ImageData imageMetadata(int id) const;
+
+    /**
+     * @brief Returns the file currently behind an ID.
+     *
+     * @param id The ID of the image.
+     * @return The absolute path, or an empty string for placeholders and out-of-range IDs.
+     */
+    QString imagePath(int id) const;
+
+    /**
+     * @brief Returns the whole metadata table, indexed by image ID.
+     *
+     * @return A reference to the structure-of-arrays metadata table.
+     */
+    const ImageMetadataTable& metadataTable() const;
+
+    /**
+     * @brief Sets the global budget for memory held by in-flight decodes.
+     *
+     * Before decoding, every job predicts its peak footprint (full-resolution
+     * pixels plus the scaled preview) from the image header. Jobs that do not
+     * fit in what is left of the budget are set aside until other decodes
+     * finish, without holding up a decode worker. A
+     * job that would not fit even in the whole budget is decoded at reduced
+     * resolution if its format supports scaled decoding, and rejected (the
+     * placeholder is shown instead) otherwise.
+     *
+     * @param bytes The budget in bytes.
+     */
+    void setDecodeMemoryBudget(qint64 bytes);
+
+    /**
+     * @brief Returns the global budget for memory held by in-flight decodes.
+     *
+     * @return The budget in bytes.
+     */
+    qint64 decodeMemoryBudget() const;
+
+    /**
+     * @brief Reserves decode memory for a decode outside the pipeline, blocking until it is available.
+     *
+     * For decoders running on their own threads, such as the TileLoader, so
+     * that they share one budget with the pipeline. Not for the GUI thread.
+     *
+     * @param bytes The predicted peak footprint.
+     * @return The number of bytes reserved; pass it to releaseDecodeMemory().
+     *         -1 if the pipeline is being stopped; nothing is reserved then.
+     */
+    qint64 acquireDecodeMemory(qint64 bytes);
+
+    /**
+     * @brief Returns a decode memory reservation and requeues the jobs parked for memory.
+     *
+     * @param bytes The reservation to return, or 0 to only requeue.
+     */
+    void releaseDecodeMemory(qint64 bytes) const;
+
+    /**
+     * @brief Prefetches the encoded bytes of the given images into RAM, without decoding them.
+     *
+     * This is a cheap, I/O-only form of prefetching: the files are read on a
+     * dedicated I/O thread into a byte-bounded buffer, so a later
+     * `loadImageAsync()` for one of them never waits for the disk. Callers
+     * typically pass the next few IDs in navigation order; each call
+     * supersedes the part of the previous one that has not been read yet.
+     *
+     * @param ids The IDs to prefetch, most urgent first. Placeholder IDs are ignored.
+     */
+    void prefetchEncoded(const QVector<int>& ids);
+
+    /**
+     * @brief Sets how many bytes of encoded files the readahead buffer may hold.
+     *
+     * @param bytes The capacity in bytes.
+     */
+    void setReadaheadCapacity(qint64 bytes);
+
+    /**
+     * @brief Sets the file size from which originals bypass the page cache.
+     *
+     * Large originals (multi-megabyte TIFFs, for instance) are read once to
+     * build their preview and then never again; keeping them in the page
+     * cache only evicts small, hot files. Files at least this large are
+     * dropped from the page cache as soon as they have been decoded or
+     * buffered by the readahead stage. Only has an effect on Linux.
+     *
+     * @param bytes The threshold in bytes; 0 (the default) disables bypassing.
+     */
+    void setPageCacheBypassThreshold(qint64 bytes);
+
+    /**
+     * @brief Returns the file size from which originals bypass the page cache.
+     *
+     * @return The threshold in bytes; 0 if bypassing is disabled.
+     */
+    qint64 pageCacheBypassThreshold() const;
+
+    /**
+     * @brief Changes the thread counts and queue capacities of the pipeline stages.
+     *
+     * The pipeline is stopped and restarted with the new configuration; jobs
+     * that were in flight are resubmitted.
+     *
+     * @param config The new configuration.
+     */
+    void setPipelineConfig(const LoaderPipelineConfig& config);
+
+    /**
+     * @brief Returns the current configuration of the pipeline stages.
+     *
+     * @return The configuration, with defaulted thread counts resolved.
+     */
+    LoaderPipelineConfig pipelineConfig() const;
+
+    /**
+     * @brief Returns the current queue depths of the pipeline stages.
+     *
+     * @return A snapshot of the pipeline queues.
+     */
+    LoaderPipelineStats pipelineStats() const;
+
 signals:
     /**
      * @brief Signal emitted when an image is successfully loaded or retrieved from cache.
@@ -110,6 +475,18 @@ signals:
      * @param image The loaded QImage data.
      */
     void imageLoaded(int id, const QImage& image);
+    /**
+     * @brief Signal emitted with a quick, low-quality version of an image still being loaded.
+     *
+     * Only sent for loadImageAsync() requests whose full decode is expensive:
+     * large JPEGs (and other formats able to decode at reduced resolution)
+     * are first decoded at 1/8 scale. The matching `imageLoaded` always
+     * follows, with the refined image; drafts are never cached.
+     *
+     * @param id The ID of the image.
+     * @param draft The draft image, no larger than the maximum preview size.
+     */
+    void imageDraftLoaded(int id, const QImage& draft);
     /**
      * @brief Signal emitted if an error occurs during image loading.
      *
@@ -118,7 +495,206 @@ signals:
      */
     void loadingError(int id, const QString& errorMessage);
 
+    /**
+     * @brief Signal emitted with a chunk of results of loadRange() / loadImages().
+     *
+     * Emitted at most once per frame interval, with every batch result that
+     * completed since the previous emission, in completion order.
+     *
+     * @param images The loaded images, paired with their IDs.
+     */
+    void imagesLoaded(const QVector<QPair<int, QImage>>& images);
+
+    /**
+     * @brief Signal emitted after a frame's worth of results has been delivered.
+     *
+     * Completed loads are not delivered one event at a time: they are drained
+     * from the completion ring once per frame, and this signal follows the
+     * `imageLoaded` / `imagesLoaded` emissions of that frame. Views can defer
+     * their repaint to it, so a burst of completions costs one repaint.
+     *
+     * @param count The number of loads delivered in this frame.
+     */
+    void frameDelivered(int count);
+
+    /**
+     * @brief Signal emitted when a new image file appeared in the watched directory.
+     *
+     * The file now lives at `id`; every image that previously had an ID greater
+     * than or equal to `id` moved up by one.
+     *
+     * @param id The ID assigned to the new file.
+     */
+    void imageInserted(int id);
+    /**
+     * @brief Signal emitted when an image file disappeared from the watched directory.
+     *
+     * Every image that previously had an ID greater than `id` moved down by one.
+     *
+     * @param id The ID the removed file used to have.
+     */
+    void imageRemoved(int id);
+    /**
+     * @brief Signal emitted when the contents of an image file changed on disk.
+     *
+     * The cached preview for `id` has already been dropped, so the next
+     * `loadImageAsync(id)` decodes the new contents.
+     *
+     * @param id The ID of the modified file.
+     */
+    void imageModified(int id);
+    /**
+     * @brief Signal emitted when the value returned by `imageCount()` changes.
+     *
+     * @param count The new total number of images.
+     */
+    void imageCountChanged(int count);
+
+    /**
+     * @brief Signal emitted when the header probe finished for a group of images.
+     *
+     * @param ids The IDs whose metadata is now available.
+     */
+    void metadataProbed(const QVector<int>& ids);
+
+private slots:
+    /**
+     * @brief Reacts to a change notification for the watched directory.
+     *
+     * Restarts the debounce timer; the actual delta is computed by
+     * `applyDirectoryDelta()` once the directory has been quiet for a moment.
+     *
+     * @param path The path of the directory that changed.
+     */
+    void onDirectoryChanged(const QString& path);
+    /**
+     * @brief Reacts to a change notification for a watched image file.
+     *
+     * @param path The path of the file that changed.
+     */
+    void onFileChanged(const QString& path);
+    /**
+     * @brief Re-lists the directory and applies add, remove and modify deltas to the index.
+     *
+     * Only the cache entries of the files that actually changed are dropped;
+     * entries of files whose ID moved are re-keyed instead.
+     */
+    void applyDirectoryDelta();
+    /**
+     * @brief Emits `imagesLoaded` with the batch results collected since the last frame.
+     */
+    void flushBatchResults();
+    /**
+     * @brief Publishes completed jobs from the completion ring, within the per-frame time budget.
+     *
+     * Runs on the frame timer while the ring is non-empty; stops the timer
+     * once it has been emptied.
+     */
+    void drainCompletions();
+    /**
+     * @brief Re-scales a few cached low-quality previews in high quality, if the loader is idle.
+     *
+     * Runs on the idle timer and re-arms it while there is more to do. Each
+     * low-quality preview is upgraded at most once, so a file that fails to
+     * load is not retried every second.
+     */
+    void upgradeCachedImages();
+
 private:
+    /**
+     * @brief Size and modification time of a file, used to detect content changes.
+     */
+    struct FileStamp {
+        qint64 size = -1;            ///< File size in bytes.
+        QDateTime lastModified;      ///< Last modification time.
+
+        /**
+         * @brief Tells whether two stamps describe the same contents.
+         */
+        bool operator==(const FileStamp& other) const {
+            return size == other.size && lastModified == other.lastModified;
+        }
+    };
+
+    /**
+     * @brief Content format of a file without an image extension, as sniffed from its first bytes.
+     */
+    struct SniffedFormat {
+        FileStamp stamp;    ///< The file's size and modification time when it was sniffed.
+        QByteArray format;  ///< The sniffed format; empty if the content is not an image.
+    };
+
+    /**
+     * @brief Lists the image files currently present in the image directory.
+     *
+     * @param unsniffed Receives the files without an image extension whose content has not been sniffed yet, if not null.
+     * @return The image files, sorted by name.
+     */
+    QFileInfoList listImageFiles(QFileInfoList* unsniffed = nullptr);
+
+    /**
+     * @brief Sniffs the content of files without an image extension on the probe pool.
+     *
+     * @param files The files to sniff.
+     */
+    void sniffFilesAsync(const QFileInfoList& files);
+
+    /**
+     * @brief Records sniffed formats and adds the files recognised as images to the index.
+     *
+     * @param paths The sniffed files.
+     * @param stamps The size and modification time of each file when it was listed.
+     * @param formats The sniffed formats, empty for other content.
+     */
+    void applySniffResults(const QStringList& paths, const QVector<FileStamp>& stamps,
+                           const QVector<QByteArray>& formats);
+
+    /**
+     * @brief Reads the header metadata of one file without decoding pixels.
+     *
+     * Safe to call from any thread.
+     *
+     * @param path The absolute path of the file.
+     * @return The probed metadata.
+     */
+    static ImageData probeFile(const QString& path);
+
+    /**
+     * @brief Probes the headers of the given images in parallel on the probe pool.
+     *
+     * The IDs are split into chunks, one task per chunk; results are applied
+     * to the metadata table on the loader's thread.
+     *
+     * @param ids The IDs of the real images to probe.
+     */
+    void probeMetadataAsync(const QVector<int>& ids);
+
+    /**
+     * @brief Writes the results of one probe task into the metadata table.
+     *
+     * Results whose path no longer matches the ID (because the index changed
+     * while the task was running) are re-targeted to the file's current ID or
+     * dropped if the file is gone. Results for a file modified since the
+     * task was scheduled are dropped too: the probe scheduled by the
+     * modification fills in the row.
+     *
+     * @param ids The IDs the task was asked to probe.
+     * @param paths The paths that were probed, parallel to `ids`.
+     * @param stamps The stamps of the files when the task was scheduled, parallel to `ids`.
+     * @param results The probed metadata, parallel to `ids`.
+     */
+    void applyProbeResults(const QVector<int>& ids, const QVector<QString>& paths,
+                           const QVector<FileStamp>& stamps, const QVector<ImageData>& results);
+    /**
+     * @brief Watches the image directory, or its nearest existing parent while it does not exist.
+     */
+    void watchImageDirectory();
+    /**
+     * @brief Watches a loaded file for in-place writes, dropping the least recently loaded watch beyond the limit.
+     *
+     * @param path The file.
+     */
+    void watchLoadedFile(const QString& path);
     /**
      * @brief Discovers and stores paths to image files in the specified directory.
      *
@@ -128,13 +704,152 @@ private:
     /**
      * @brief Generates a dummy placeholder image.
      *
-     * This method creates a generic QImage to be used when a real image
-     * corresponding to the requested ID is not found.
+     * This method composes a generic QImage to be used when a real image
+     * corresponding to the requested ID is not found. It is thread-safe.
      *
      * @param id The ID of the image for which to generate a placeholder.
+     * @param targetSize The bounding box of the image.
      * @return A QImage representing the placeholder.
      */
-    QImage generatePlaceholderImage(int id) const; // Generates a dummy image
+    QImage generatePlaceholderImage(int id, const QSize& targetSize) const; // Generates a dummy image
+
+    /**
+     * @brief Creates the pipeline workers for `m_pipelineConfig`.
+     */
+    void startPipeline();
+
+    /**
+     * @brief Returns the in-flight job producing the given ID at the given size, if any.
+     *
+     * @param id The image ID.
+     * @param targetSize The bounding box of the requested image.
+     * @param acceptFast True if a job scaling with the fast filter will do.
+     * @return The job, or a null pointer if a new one must be created.
+     */
+    QSharedPointer<LoadJob> findInFlight(int id, const QSize& targetSize, bool acceptFast) const;
+
+    /**
+     * @brief Creates a job for the current file of an ID and registers it as in flight.
+     *
+     * The job is not submitted: the caller attaches its requester first.
+     *
+     * @param id The image ID.
+     * @param targetSize The bounding box of the image to produce.
+     * @param priority The queue priority of the job.
+     * @param fastScale True to scale with the fast filter.
+     * @return The new job.
+     */
+    QSharedPointer<LoadJob> createJob(int id, const QSize& targetSize, int priority, bool fastScale);
+
+    /**
+     * @brief Returns true if a preview was scaled with the fast filter.
+     *
+     * @param image The preview.
+     * @return True if it deserves a high-quality re-scale.
+     */
+    static bool isFastScaled(const QImage& image);
+
+    /**
+     * @brief Queues a batch result for the next `imagesLoaded` emission.
+     *
+     * @param id The image ID.
+     * @param image The loaded image.
+     */
+    void appendBatchResult(int id, const QImage& image);
+
+    /**
+     * @brief Hands a job to the I/O stage, or parks it if the I/O queue is full.
+     *
+     * Never blocks: it runs on the loader's thread. Parked jobs are kept in
+     * priority order, like the pipeline queues.
+     *
+     * @param job The job to submit.
+     */
+    void submitJob(const QSharedPointer<LoadJob>& job);
+
+    /**
+     * @brief Moves parked jobs into the I/O queue while it has room.
+     */
+    void drainOverflow();
+
+    /**
+     * @brief I/O stage: brings the encoded bytes of the file into memory.
+     *
+     * Uses the readahead buffer when the file was prefetched; otherwise maps
+     * the file and faults its pages in. Runs on an I/O worker.
+     *
+     * @param job The job to process.
+     */
+    void runIoStage(const QSharedPointer<LoadJob>& job) const;
+
+    /**
+     * @brief Decode stage: decodes the pixels under the memory budget.
+     *
+     * Runs on a decode worker. The reservation is kept in the job until the
+     * scale stage has released the full-resolution pixels. For signal
+     * requests of large images a reduced-resolution draft is decoded and
+     * posted first.
+     *
+     * @param job The job to process.
+     * @return False if the job was parked until decode memory is released.
+     */
+    bool runDecodeStage(const QSharedPointer<LoadJob>& job);
+
+    /**
+     * @brief Reserves decode memory for a job, or parks the job until memory is released.
+     *
+     * @param job The job about to decode.
+     * @param bytes The predicted peak footprint.
+     * @return True if reserved (stored in the job); false if the job was parked.
+     */
+    bool reserveDecodeMemory(const QSharedPointer<LoadJob>& job, qint64 bytes);
+
+    /**
+     * @brief Decodes and posts a 1/8-scale draft of a large image, if its decoder can.
+     *
+     * Runs on a decode worker, before the full decode.
+     *
+     * @param job The job being decoded.
+     * @param decoder The decoder picked for the job's encoded bytes.
+     */
+    void postDraft(const QSharedPointer<LoadJob>& job, const ImageDecoder* decoder);
+
+    /**
+     * @brief Pushes an entry into the completion ring and makes sure a drain is scheduled.
+     *
+     * Callable from any thread.
+     *
+     * @param completion The entry to push.
+     * @return True if pushed, false if the ring is full.
+     */
+    bool pushCompletion(const LoadCompletion& completion);
+
+    /**
+     * @brief Scale stage: produces the preview and releases the decode memory.
+     *
+     * Runs on a scale worker. Files that failed to load get a placeholder.
+     *
+     * @param job The job to process.
+     */
+    void runScaleStage(const QSharedPointer<LoadJob>& job) const;
+
+    /**
+     * @brief Publish stage: inserts the finished image in the cache and emits `imageLoaded`.
+     *
+     * Runs on the loader's thread. The result is discarded if the index
+     * changed while the job was in flight and its path no longer has its ID.
+     *
+     * @param job The finished job.
+     */
+    void publishJob(const QSharedPointer<LoadJob>& job);
+
+    /**
+     * @brief Emits `imageDraftLoaded` for a job still in progress, unless it went stale.
+     *
+     * @param job The job the draft belongs to.
+     * @param draft The draft image.
+     */
+    void publishDraft(const QSharedPointer<LoadJob>& job, const QImage& draft);
 
     /**
      * @brief Path to the directory containing actual image files.
@@ -162,6 +877,121 @@ private:
      * This cache is used to store and retrieve images efficiently.
      */
     ImageCache* m_imageCache; // Pointer to the shared image cache instance (senza namespace)
+
+    /**
+     * @brief Size and modification time of every indexed file, keyed by absolute path.
+     */
+    QHash<QString, FileStamp> m_fileStamps;
+    /**
+     * @brief Sniffed formats of the files without an image extension, keyed by absolute path.
+     */
+    QHash<QString, SniffedFormat> m_sniffedFormats;
+    /**
+     * @brief Watches the image directory and the most recently loaded files for changes.
+     */
+    QFileSystemWatcher* m_watcher;
+    /**
+     * @brief Files watched individually, least recently loaded first.
+     */
+    QStringList m_watchedFiles;
+    /**
+     * @brief Debounces bursts of change notifications (e.g. a file being written in chunks).
+     */
+    QTimer* m_rescanTimer;
+
+    /**
+     * @brief Header metadata of the real images, aligned with `m_imagePaths`.
+     */
+    ImageMetadataTable m_metadata;
+    /**
+     * @brief Thread pool running the header probe tasks.
+     */
+    QThreadPool* m_probePool;
+
+    /**
+     * @brief The I/O, decode and scale stages and their queues.
+     */
+    QScopedPointer<LoadPipeline> m_pipeline;
+    /**
+     * @brief Thread counts and queue capacities of the pipeline.
+     */
+    LoaderPipelineConfig m_pipelineConfig;
+    /**
+     * @brief Jobs waiting for room in the I/O queue.
+     */
+    QQueue<QSharedPointer<LoadJob>> m_overflow;
+    /**
+     * @brief Jobs in the pipeline for each ID, so that repeated requests share them.
+     */
+    QMultiHash<int, QSharedPointer<LoadJob>> m_inFlight;
+    /**
+     * @brief Finished jobs posted to the loader's thread but not yet published.
+     */
+    QAtomicInt m_publishPending;
+    /**
+     * @brief Finished jobs pushed by the workers, drained by the loader's thread once per frame.
+     */
+    QScopedPointer<MpscRing<LoadCompletion>> m_completions;
+    /**
+     * @brief Set while a drain of `m_completions` is scheduled, so workers post at most one wake-up.
+     */
+    QAtomicInt m_drainScheduled;
+    /**
+     * @brief Paces the drain of `m_completions` to the display frame rate.
+     */
+    QTimer* m_frameTimer;
+    /**
+     * @brief Admission control for the memory held by in-flight decodes.
+     */
+    QScopedPointer<MemoryBudget> m_decodeBudget;
+    /**
+     * @brief Guards `m_awaitingMemory` together with the budget checks that fill it.
+     */
+    mutable QMutex m_awaitingMemoryMutex;
+    /**
+     * @brief Decode jobs parked until enough of the decode memory budget is released.
+     */
+    mutable QVector<QSharedPointer<LoadJob>> m_awaitingMemory;
+    /**
+     * @brief Encoded bytes of the images expected to be viewed next.
+     */
+    QScopedPointer<ReadaheadCache> m_readahead;
+    /**
+     * @brief File size from which originals are dropped from the page cache; 0 = never.
+     */
+    QAtomicInteger<qint64> m_pageCacheBypassThreshold;
+
+    /**
+     * @brief Limits `imagesLoaded` to one emission per frame interval.
+     */
+    QTimer* m_batchTimer;
+    /**
+     * @brief Batch results waiting for the next `imagesLoaded` emission.
+     */
+    QVector<QPair<int, QImage>> m_batchResults;
+
+    /**
+     * @brief Filter used for loadImageAsync() and batch loads.
+     */
+    ScaleQuality m_scaleQuality;
+    /**
+     * @brief Fires once no request has come in for a while, to upgrade low-quality previews.
+     */
+    QTimer* m_idleUpgradeTimer;
+    /**
+     * @brief Files whose current low-quality preview already had its idle upgrade attempt.
+     */
+    QSet<QString> m_upgradeAttempted;
+
+    /**
+     * @brief Composes placeholder images from a shared background and digit atlas.
+     */
+    QScopedPointer<PlaceholderRenderer> m_placeholders;
+
+    /**
+     * @brief Parses SVG documents once and rasterizes them at the requested size.
+     */
+    QScopedPointer<SvgRasterizer> m_svg;
 };
 
 #endif // IMAGELOADERLIB_IMAGELOADER_H
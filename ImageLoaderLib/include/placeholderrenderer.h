@@ -0,0 +1,108 @@
+/**
+ * @file placeholderrenderer.h
+ * @brief Declaration of the PlaceholderRenderer class, which draws placeholder images on demand.
+ *
+ * Placeholders stand in for the IDs beyond the real files of the gallery.
+ * Rather than generating and caching one image per ID, the renderer keeps a
+ * single background colour and a small atlas with the glyphs of the ten
+ * digits, and composes the ID number from it whenever a placeholder is painted.
+ */
+#ifndef IMAGELOADERLIB_PLACEHOLDERRENDERER_H
+#define IMAGELOADERLIB_PLACEHOLDERRENDERER_H
+
+#include <QColor> // For the shared background
+#include <QImage> // For the glyph atlas
+#include <QRect>  // For the glyph positions in the atlas
+#include <QSize>  // For the reference preview size
+
+class QPainter;
+
+// Macro standard per l'esportazione/importazione (come in imageloader.h)
+#ifndef IMAGELOADERLIB_EXPORT
+#  if defined(IMAGELOADERLIB_LIBRARY)
+#    define IMAGELOADERLIB_EXPORT Q_DECL_EXPORT
+#  else
+#    define IMAGELOADERLIB_EXPORT Q_DECL_IMPORT
+#  endif
+#endif
+
+/**
+ * @brief Composes placeholder images from a shared background and a digit glyph atlas.
+ *
+ * The atlas is rendered once, at the size the digits have on a placeholder
+ * of `previewSize()`; painting a placeholder is one fill plus one blit per
+ * digit, scaled along with the target rectangle. No memory is held per ID,
+ * so the cost does not depend on how many placeholders the gallery has.
+ *
+ * The renderer is immutable after construction: paint() and render() may be
+ * called from any thread.
+ */
+class IMAGELOADERLIB_EXPORT PlaceholderRenderer {
+public:
+    /**
+     * @brief Constructs the renderer and rasterizes the glyph atlas.
+     *
+     * @param previewSize The size of a full placeholder; glyphs are scaled relative to it.
+     */
+    explicit PlaceholderRenderer(const QSize& previewSize);
+
+    /**
+     * @brief Returns the size of a full placeholder.
+     * @return The reference preview size.
+     */
+    QSize previewSize() const;
+
+    /**
+     * @brief Returns the background colour of the placeholders.
+     * @return The shared background colour.
+     */
+    QColor background() const;
+
+    /**
+     * @brief Paints the placeholder for an ID into a rectangle.
+     *
+     * The background fills `target`; the digits are centred in it, scaled by
+     * the ratio between `target` and `previewSize()`.
+     *
+     * @param painter The painter to draw with.
+     * @param target The rectangle covered by the placeholder.
+     * @param id The ID whose number is drawn.
+     */
+    void paint(QPainter* painter, const QRect& target, int id) const;
+
+    /**
+     * @brief Renders the placeholder for an ID into a new image.
+     *
+     * For callers that need a QImage, such as requestImage() futures. The
+     * image comes from the pixel buffer pool and is not cached.
+     *
+     * @param id The ID whose number is drawn.
+     * @param size The size of the image; invalid for `previewSize()`.
+     * @return The placeholder image.
+     */
+    QImage render(int id, const QSize& size = QSize()) const;
+
+private:
+    /**
+     * @brief Size of a full placeholder.
+     */
+    QSize m_previewSize;
+    /**
+     * @brief Background colour shared by every placeholder.
+     */
+    QColor m_background;
+    /**
+     * @brief The ten digits, white on transparent, side by side in cells of `m_cellWidth`.
+     */
+    QImage m_atlas;
+    /**
+     * @brief Width of the widest digit in the atlas; each digit has a cell this wide.
+     */
+    int m_cellWidth;
+    /**
+     * @brief Advance of each digit, in atlas pixels.
+     */
+    int m_advances[10];
+};
+
+#endif // IMAGELOADERLIB_PLACEHOLDERRENDERER_H
@@ -0,0 +1,137 @@
+/**
+ * @file svgrasterizer.h
+ * @brief Declaration of the SvgRasterizer class, which renders SVG documents at the size they are shown.
+ *
+ * This file defines the SvgRasterizer class. SVG files are parsed once into
+ * a QSvgRenderer kept in a small document cache; every raster is then drawn
+ * straight at the requested pixel size, never scaled from a raster of
+ * another size. Views ask for the exact size of their frame times the
+ * device pixel ratio and ask again when it changes.
+ */
+#ifndef IMAGELOADERLIB_SVGRASTERIZER_H
+#define IMAGELOADERLIB_SVGRASTERIZER_H
+
+#include <QObject>        // Base class for Qt objects
+#include <QImage>         // For the rasters
+#include <QSize>          // For raster dimensions
+#include <QByteArray>     // For format names
+#include <QString>        // For file paths
+#include <QCache>         // For the parsed documents
+#include <QMutex>         // For guarding the document cache
+#include <QSharedPointer> // For documents shared with the workers
+#include <QAtomicInt>     // For superseding render requests
+
+class QThreadPool;
+
+// Macro standard per l'esportazione/importazione (come in imageloader.h)
+#ifndef IMAGELOADERLIB_EXPORT
+#  if defined(IMAGELOADERLIB_LIBRARY)
+#    define IMAGELOADERLIB_EXPORT Q_DECL_EXPORT
+#  else
+#    define IMAGELOADERLIB_EXPORT Q_DECL_IMPORT
+#  endif
+#endif
+
+/**
+ * @brief Parses SVG files once and rasterizes them at any size.
+ *
+ * render() draws synchronously and may be called from any thread; the
+ * pipeline uses it for previews. requestRender() draws on the rasterizer's
+ * own worker and emits `rendered`; each request supersedes the previous
+ * one, so a view being resized only gets the raster of its final size.
+ *
+ * The document cache is bounded by the size of the SVG sources, which is
+ * what a QSvgRenderer's parsed tree grows with; rasters are never cached
+ * here.
+ */
+class IMAGELOADERLIB_EXPORT SvgRasterizer : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a rasterizer with an empty document cache.
+     * @param parent Pointer to the parent QObject.
+     */
+    explicit SvgRasterizer(QObject* parent = nullptr);
+
+    /**
+     * @brief Waits for the render in progress and destroys the rasterizer.
+     */
+    ~SvgRasterizer();
+
+    /**
+     * @brief Tells whether a file is an SVG document, by its extension.
+     *
+     * @param path The file.
+     * @return True for .svg and .svgz files.
+     */
+    static bool isSvgFile(const QString& path);
+
+    /**
+     * @brief Tells whether a probed or sniffed format names an SVG document.
+     *
+     * @param format The format name, as reported by FormatSniffer or QImageReader.
+     * @return True for "svg" and "svgz".
+     */
+    static bool isSvgFormat(const QByteArray& format);
+
+    /**
+     * @brief Returns the size of a document's raster fitting a box.
+     *
+     * @param path The SVG file.
+     * @param box The bounding box.
+     * @return The box shrunk to the document's aspect ratio, or an invalid size if it cannot be parsed.
+     */
+    QSize fittedSize(const QString& path, const QSize& box);
+
+    /**
+     * @brief Rasterizes a document at an exact size. Thread-safe.
+     *
+     * @param path The SVG file.
+     * @param size The size of the raster.
+     * @return The raster in Format_ARGB32_Premultiplied, or a null image if the file cannot be parsed.
+     */
+    QImage render(const QString& path, const QSize& size);
+
+    /**
+     * @brief Rasterizes a document on the worker, superseding the previous request.
+     *
+     * @param path The SVG file.
+     * @param box The bounding box of the raster, which keeps the document's aspect ratio.
+     */
+    void requestRender(const QString& path, const QSize& box);
+
+    /**
+     * @brief Drops the parsed document of a file, so that its next render reads it again.
+     *
+     * @param path The SVG file.
+     */
+    void forget(const QString& path);
+
+signals:
+    /**
+     * @brief Emitted when the latest requestRender() has finished.
+     *
+     * @param path The SVG file.
+     * @param image The raster; null if the file cannot be parsed.
+     */
+    void rendered(const QString& path, const QImage& image);
+
+private:
+    struct Document;
+
+    /**
+     * @brief Returns the parsed document of a file, parsing it if needed. Thread-safe.
+     *
+     * @param path The SVG file.
+     * @return The document, or null if the file cannot be parsed.
+     */
+    QSharedPointer<Document> document(const QString& path);
+
+    QThreadPool* m_pool;                                   ///< Runs requestRender() work.
+    QMutex m_mutex;                                        ///< Guards `m_documents`.
+    QCache<QString, QSharedPointer<Document>> m_documents; ///< Parsed documents by path; the cost is the file size in KiB.
+    QAtomicInt m_generation;                               ///< Incremented by each requestRender().
+};
+
+#endif // IMAGELOADERLIB_SVGRASTERIZER_H
@@ -0,0 +1,302 @@
+/**
+ * @file tileloader.h
+ * @brief Declaration of the TileLoader class, which decodes regions of large images as tiles.
+ *
+ * This file defines the TileLoader class, the backend of zoomed viewing. An
+ * image is seen as a pyramid of levels, level 0 being the full resolution and
+ * every further level half the size of the previous one; each level is cut
+ * into square tiles. Tiles are decoded on demand with QImageReader's clip
+ * rectangle and scaled size, so that only the visible part of an image is
+ * ever held in memory, and kept in a cache keyed by (id, level, tx, ty).
+ * Images that are zoomed into also get a tile pyramid in the disk cache,
+ * from which later tiles are read instead of being decoded.
+ */
+#ifndef IMAGELOADERLIB_TILELOADER_H
+#define IMAGELOADERLIB_TILELOADER_H
+
+#include <QObject>        // Base class for Qt objects
+#include <QImage>         // For the tiles
+#include <QImageIOHandler> // For EXIF orientations
+#include <QCache>         // For the tile cache
+#include <QHash>          // For the per-image decode parameters
+#include <QMutex>         // For serialising whole-image decodes
+#include <QSet>           // For the images waiting for their header probe
+#include <QVector>        // For the queue of wanted tiles
+#include <QRect>          // For visible regions and tile rectangles
+#include <QSize>          // For image and level dimensions
+#include <QScopedPointer> // For owning the pyramid store
+
+#include "imageloader.h"  // For ImageLoader and IMAGELOADERLIB_EXPORT
+
+class QThreadPool;
+class TilePyramid;
+
+/**
+ * @brief Identifies one tile of one level of one image.
+ */
+struct TileKey {
+    int id = -1;    ///< The image ID.
+    int level = 0;  ///< The pyramid level; 0 is the full resolution.
+    int tx = 0;     ///< The tile column.
+    int ty = 0;     ///< The tile row.
+};
+
+/**
+ * @brief Compares two tile keys.
+ */
+inline bool operator==(const TileKey& a, const TileKey& b) {
+    return a.id == b.id && a.level == b.level && a.tx == b.tx && a.ty == b.ty;
+}
+
+/**
+ * @brief Hashes a tile key for QCache and QHash.
+ */
+inline size_t qHash(const TileKey& key, size_t seed = 0) {
+    return qHashMulti(seed, key.id, key.level, key.tx, key.ty);
+}
+
+/**
+ * @brief What a worker needs to decode tiles of one image.
+ */
+struct TileSource {
+    QString path;             ///< The file.
+    QByteArray format;        ///< The encoded format.
+    QSize decodedSize;        ///< The full-resolution size, before orientation.
+    QImageIOHandler::Transformations orientation; ///< The EXIF orientation.
+    QString pyramid;          ///< Directory of the image's tile pyramid in the disk cache.
+
+    /**
+     * @brief Returns the full-resolution size with the orientation applied.
+     */
+    QSize orientedSize() const {
+        return orientation.testFlag(QImageIOHandler::TransformationRotate90) ? decodedSize.transposed() : decodedSize;
+    }
+};
+
+/**
+ * @brief Decodes and caches tiles of large images for zoomed viewing.
+ *
+ * Coordinates are in the oriented image: tiles are cut from the image as it
+ * is displayed, with its EXIF orientation applied. A view calls
+ * requestTiles() with the region it shows whenever it changes; the tiles
+ * missing from the cache are decoded in the background, those nearest to
+ * the centre of the region first, and `tileLoaded` is emitted for each.
+ * A new request replaces the tiles still waiting from the previous one.
+ *
+ * The first request for an image larger than a tile also schedules the
+ * build of its pyramid in the disk cache; tiles already written there are
+ * read rather than decoded from the original. The pyramid cache is bounded
+ * and drops the least recently used pyramids.
+ *
+ * Sizes come from the ImageLoader's header probe; an image not probed yet
+ * has no size until `imageSizeKnown` is emitted for it. Tile decodes
+ * reserve their memory in the loader's decode budget. Formats without clip
+ * rectangles (PNG, ...) are decoded once per level, and their tiles cut
+ * from that.
+ *
+ * The tile loader follows the index of its ImageLoader: when files are
+ * inserted, removed or modified, cached tiles are dropped.
+ */
+class IMAGELOADERLIB_EXPORT TileLoader : public QObject {
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Constructs a tile loader for the images of an ImageLoader.
+     *
+     * @param loader The loader providing the files and their metadata.
+     * @param parent Pointer to the parent QObject.
+     */
+    explicit TileLoader(ImageLoader* loader, QObject* parent = nullptr);
+
+    /**
+     * @brief Destroys the tile loader, waiting for the tiles being decoded.
+     */
+    ~TileLoader();
+
+    /**
+     * @brief Returns the width and height of a tile, in pixels.
+     * @return The tile size.
+     */
+    static int tileSize();
+
+    /**
+     * @brief Returns the size of a pyramid level.
+     *
+     * @param fullSize The size of level 0.
+     * @param level The level.
+     * @return The size of the level, at least 1x1.
+     */
+    static QSize levelSize(const QSize& fullSize, int level);
+
+    /**
+     * @brief Returns the level to draw from at a given zoom.
+     *
+     * This is the coarsest level whose resolution is still at least the
+     * displayed one.
+     *
+     * @param scale Device pixels per full-resolution pixel.
+     * @return The level.
+     */
+    static int levelForScale(qreal scale);
+
+    /**
+     * @brief Returns the full-resolution size of an image, with its orientation applied.
+     *
+     * @param id The image ID.
+     * @return The size, or an invalid size if the image has no readable file or has not been probed yet.
+     */
+    QSize imageSize(int id);
+
+    /**
+     * @brief Returns the number of levels of an image: down to the level that fits in one tile.
+     *
+     * @param id The image ID.
+     * @return The number of levels, or 0 if the image has no readable file.
+     */
+    int levelCount(int id);
+
+    /**
+     * @brief Returns a tile if it is in the cache.
+     *
+     * @param key The tile.
+     * @return The tile, or a null image if it has not been decoded (yet).
+     */
+    QImage tile(const TileKey& key) const;
+
+    /**
+     * @brief Asks for the tiles covering a region of a level.
+     *
+     * @param id The image ID.
+     * @param level The level.
+     * @param region The region, in pixels of the level.
+     */
+    void requestTiles(int id, int level, const QRect& region);
+
+    /**
+     * @brief Sets how many bytes of decoded tiles the cache may hold.
+     * @param bytes The capacity in bytes.
+     */
+    void setCacheCapacity(qint64 bytes);
+
+    /**
+     * @brief Sets how many bytes of tile pyramids the disk cache may hold.
+     * @param bytes The capacity in bytes.
+     */
+    void setPyramidCacheCapacity(qint64 bytes);
+
+    /**
+     * @brief Drops every cached tile and every tile waiting to be decoded.
+     */
+    void clear();
+
+    /**
+     * @brief Tells whether an image can be decoded a region at a time.
+     *
+     * @param source The image.
+     * @return True if its reader supports clip rectangles (JPEG); false if every region costs a whole decode.
+     */
+    static bool decodesRegions(const TileSource& source);
+
+    /**
+     * @brief Decodes a region of an image from its file.
+     *
+     * @param source The image.
+     * @param region The region, in full-resolution pixels of the oriented image.
+     * @param size The size to decode the region to, oriented.
+     * @return The region in Format_RGB32 or Format_ARGB32_Premultiplied, or a null image on failure.
+     */
+    static QImage decodeRegion(const TileSource& source, const QRect& region, const QSize& size);
+
+signals:
+    /**
+     * @brief Emitted when a requested tile has been decoded and cached.
+     *
+     * @param key The tile.
+     */
+    void tileLoaded(const TileKey& key);
+
+    /**
+     * @brief Emitted when the header probe of an image whose size was asked for too early has run.
+     *
+     * @param id The image ID; imageSize() now returns its size, or an invalid size if it is unreadable.
+     */
+    void imageSizeKnown(int id);
+
+private:
+    /**
+     * @brief Returns the decode parameters of an image, from its probed metadata.
+     *
+     * @param id The image ID.
+     * @return The parameters; the path is empty if the image has no readable file or has not been probed yet.
+     */
+    const TileSource& source(int id);
+
+    /**
+     * @brief Forgets the parameters of images that were waiting for their header probe.
+     *
+     * @param ids The probed images.
+     */
+    void onMetadataProbed(const QVector<int>& ids);
+
+    /**
+     * @brief Starts decoding wanted tiles while workers are free.
+     */
+    void startWantedTiles();
+
+    /**
+     * @brief Reads one tile from the image's pyramid, or decodes it; runs on a worker thread.
+     *
+     * @param source The decode parameters of the image.
+     * @param key The tile.
+     * @return The tile, or a null image on failure.
+     */
+    QImage decodeTile(const TileSource& source, const TileKey& key);
+
+    /**
+     * @brief Cuts a tile from a whole level of an image, decoding the level if it is not the one kept.
+     *
+     * For formats that cannot decode a region without decoding the whole
+     * image; runs on a worker thread.
+     *
+     * @param source The decode parameters of the image.
+     * @param key The tile.
+     * @param tileRect The tile, in pixels of its level.
+     * @return The tile, or a null image on failure.
+     */
+    QImage cutTile(const TileSource& source, const TileKey& key, const QRect& tileRect);
+
+    /**
+     * @brief Drops the whole level kept by cutTile() and returns its memory reservation.
+     */
+    void releaseWholeLevel();
+
+    /**
+     * @brief Caches a decoded tile and starts the next one; runs on the loader's thread.
+     *
+     * @param key The tile.
+     * @param tile The decoded tile.
+     * @param generation The value of `m_generation` when the tile was started.
+     */
+    void onTileDecoded(const TileKey& key, const QImage& tile, int generation);
+
+    ImageLoader* m_loader;                   ///< Provides the files and their metadata.
+    QThreadPool* m_pool;                     ///< Workers decoding tiles.
+    QScopedPointer<TilePyramid> m_pyramids;  ///< Tile pyramids in the disk cache.
+    QCache<TileKey, QImage> m_cache;         ///< Decoded tiles; the cost is in KiB.
+    QHash<int, TileSource> m_sources;        ///< Decode parameters per image, filled on demand.
+    QSet<int> m_awaitingProbe;               ///< Images asked for before their header probe ran.
+    QMutex m_wholeMutex;                     ///< Serialises whole-level decodes; guards the members below.
+    QString m_wholePyramid;                  ///< Pyramid directory, i.e. file version, of `m_wholeLevel`.
+    int m_wholeLevelIndex;                   ///< Level kept in `m_wholeLevel`.
+    QImage m_wholeLevel;                     ///< The last level decoded whole, oriented.
+    qint64 m_wholeReservedBytes;             ///< Decode memory reserved for `m_wholeLevel`.
+    QVector<TileKey> m_wanted;               ///< Tiles to decode, most urgent last.
+    QVector<TileKey> m_decoding;             ///< Tiles being decoded.
+    int m_running;                           ///< Workers busy, including those decoding tiles of an old index.
+    int m_generation;                        ///< Incremented by clear(), to discard tiles of an old index.
+};
+
+Q_DECLARE_METATYPE(TileKey)
+
+#endif // IMAGELOADERLIB_TILELOADER_H
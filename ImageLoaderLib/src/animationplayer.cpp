@@ -0,0 +1,253 @@
+/**
+ * @file animationplayer.cpp
+ * @brief Implementation of the AnimationPlayer class.
+ */
+#include "animationplayer.h"
+#include "boundedqueue.h"   // For the frame ring
+#include <QImageReader>     // For decoding the frames
+#include <QMutex>           // For guarding the frame size
+#include <QThread>          // For the decoder thread
+#include <QTimer>           // For presenting frames on time
+#include <QDebug>           // For debugging output
+
+namespace {
+/**
+ * @brief Number of frames decoded ahead of the one on screen.
+ */
+constexpr int FRAME_RING_CAPACITY = 4;
+
+/**
+ * @brief Shortest frame delay honoured, in milliseconds.
+ *
+ * Many GIFs store 0 or 10 ms and rely on viewers slowing them down; like
+ * web browsers, such delays are shown as DEFAULT_FRAME_DELAY.
+ */
+constexpr int MIN_FRAME_DELAY = 20;
+
+/**
+ * @brief Delay used for frames whose stored delay is missing or too short, in milliseconds.
+ */
+constexpr int DEFAULT_FRAME_DELAY = 100;
+
+/**
+ * @brief How often a frame that is late is looked for, in milliseconds.
+ */
+constexpr int LATE_FRAME_POLL_INTERVAL = 5;
+}
+
+/**
+ * @brief What the player and its decoder thread share: the frame ring and the frame size.
+ *
+ * The decoder thread holds the last reference once the player has stopped.
+ */
+struct AnimationPlayer::Stream {
+    /**
+     * @brief Constructs an open ring.
+     * @param maxSize The initial largest frame size.
+     */
+    explicit Stream(const QSize& maxSize)
+        : ring(FRAME_RING_CAPACITY),
+        maxSize(maxSize)
+    {
+    }
+
+    BoundedQueue<Frame> ring; ///< Frames decoded ahead of presentation.
+    QMutex mutex;             ///< Guards `maxSize`.
+    QSize maxSize;            ///< Frames larger than this are scaled down to fit.
+};
+
+/**
+ * @brief Constructs an idle player.
+ * @param parent Pointer to the parent QObject.
+ */
+AnimationPlayer::AnimationPlayer(QObject* parent)
+    : QObject(parent),
+    m_timer(new QTimer(this)),
+    m_nextDue(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer); // Frame delays are short: a coarse timer would make them uneven
+    connect(m_timer, &QTimer::timeout, this, &AnimationPlayer::presentNextFrame);
+}
+
+/**
+ * @brief Stops playback and destroys the player.
+ */
+AnimationPlayer::~AnimationPlayer() {
+    stop();
+}
+
+/**
+ * @brief Tells whether files of a format may hold an animation.
+ *
+ * @param format The encoded format, as reported by QImageReader.
+ * @return True for GIF and WebP.
+ */
+bool AnimationPlayer::canAnimate(const QByteArray& format) {
+    const QByteArray lower = format.toLower();
+    return lower == "gif" || lower == "webp";
+}
+
+/**
+ * @brief Starts playing a file, replacing the current animation.
+ *
+ * @param path The image file.
+ * @param maxSize Frames larger than this are scaled down to fit, keeping their aspect ratio.
+ * @param format The probed format, passed to the decoder so it does not probe the plugins; may be empty.
+ */
+void AnimationPlayer::play(const QString& path, const QSize& maxSize, const QByteArray& format) {
+    stop();
+    m_path = path;
+    m_stream.reset(new Stream(maxSize));
+    const QSharedPointer<Stream> stream = m_stream;
+    QThread* worker = QThread::create([path, format, stream]() {
+        decodeFrames(path, format, stream);
+    });
+    worker->setObjectName(QStringLiteral("AnimationPlayer decoder"));
+    connect(worker, &QThread::finished, worker, &QObject::deleteLater); // Also releases its reference to the stream
+    worker->start();
+
+    m_clock.start();
+    m_nextDue = 0;
+    m_timer->start(0); // The first frame is shown as soon as it is decoded
+}
+
+/**
+ * @brief Changes the size frames are scaled down to, from the next frame decoded on.
+ *
+ * The frames already in the ring keep their size; the decoder rescales
+ * from the following one, without restarting the animation.
+ *
+ * @param maxSize Frames larger than this are scaled down to fit, keeping their aspect ratio.
+ */
+void AnimationPlayer::setMaxSize(const QSize& maxSize) {
+    if (!m_stream) {
+        return;
+    }
+    QMutexLocker locker(&m_stream->mutex);
+    m_stream->maxSize = maxSize;
+}
+
+/**
+ * @brief Stops playback and releases the frames, without waiting for the decoder.
+ *
+ * Closing the ring wakes the decoder if it is waiting for room and makes
+ * it return after the frame it is decoding, if any; the thread then
+ * deletes itself, dropping the last reference to the ring.
+ */
+void AnimationPlayer::stop() {
+    m_timer->stop();
+    if (m_stream) {
+        m_stream->ring.close();
+    }
+    m_stream.reset();
+    m_path.clear();
+}
+
+/**
+ * @brief Returns the file being played.
+ * @return The path, or an empty string when stopped.
+ */
+QString AnimationPlayer::path() const {
+    return m_path;
+}
+
+/**
+ * @brief Decodes the frames of a file into the ring; runs on the worker thread.
+ *
+ * Frames are read one after the other with the same reader, which keeps
+ * the decoder's state between them, so each frame costs one incremental
+ * decode. Each new loop reopens the file. The decoder blocks as soon as the
+ * ring is full, and returns when the ring is closed. The largest frame
+ * size is looked up before every frame, so a resized display gets frames
+ * at its new size from the next one on.
+ *
+ * @param path The image file.
+ * @param format The format hint; may be empty.
+ * @param stream The ring to fill and the largest frame size.
+ */
+void AnimationPlayer::decodeFrames(const QString& path, const QByteArray& format, const QSharedPointer<Stream>& stream) {
+    BoundedQueue<Frame>* ring = &stream->ring;
+    QImageReader reader(path, format);
+    if (!reader.supportsAnimation() || reader.imageCount() == 1) {
+        ring->push(Frame()); // A still image: nothing to play
+        return;
+    }
+
+    const QSize size = reader.size();
+    QSize maxSize;
+    int loopsLeft = reader.loopCount(); // -1 loops forever, 0 plays once
+    forever {
+        int frames = 0;
+        while (reader.canRead()) {
+            QSize wanted;
+            {
+                QMutexLocker locker(&stream->mutex);
+                wanted = stream->maxSize;
+            }
+            if (wanted != maxSize) {
+                maxSize = wanted;
+                const bool larger = size.isValid() && maxSize.isValid()
+                                    && (size.width() > maxSize.width() || size.height() > maxSize.height());
+                reader.setScaledSize(larger ? size.scaled(maxSize, Qt::KeepAspectRatio) : QSize());
+            }
+            QImage image = reader.read();
+            if (image.isNull()) {
+                break;
+            }
+            int delay = reader.nextImageDelay();
+            if (delay < MIN_FRAME_DELAY) {
+                delay = DEFAULT_FRAME_DELAY;
+            }
+            const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+            if (image.format() != format) {
+                image = image.convertToFormat(format); // Fast to blit on the GUI thread
+            }
+            if (!ring->push(Frame{ image, delay })) {
+                return; // Stopped
+            }
+            ++frames;
+        }
+
+        if (frames == 0) {
+            qDebug() << "AnimationPlayer: no frame decoded from" << path << ":" << reader.errorString();
+            break;
+        }
+        if (loopsLeft == 0) {
+            break;
+        }
+        if (loopsLeft > 0) {
+            --loopsLeft;
+        }
+        reader.setFileName(path); // Back to the first frame
+    }
+    ring->push(Frame()); // End of the animation
+}
+
+/**
+ * @brief Presents the next frame if it is ready; runs on the player's thread.
+ *
+ * Each frame is due the stored delay after the previous one. A frame that
+ * is late is shown on arrival and the schedule restarts from there, rather
+ * than rushing the following frames to catch up.
+ */
+void AnimationPlayer::presentNextFrame() {
+    if (!m_stream) {
+        return;
+    }
+    Frame frame;
+    if (!m_stream->ring.tryPop(&frame)) {
+        m_timer->start(LATE_FRAME_POLL_INTERVAL); // Il decoder è in ritardo: non bloccare il thread della GUI
+        return;
+    }
+    if (frame.image.isNull()) {
+        stop();
+        emit finished();
+        return;
+    }
+
+    const qint64 now = m_clock.elapsed();
+    m_nextDue = qMax(m_nextDue, now) + frame.delay;
+    emit frameReady(frame.image);
+    m_timer->start(int(qMax<qint64>(0, m_nextDue - m_clock.elapsed())));
+}
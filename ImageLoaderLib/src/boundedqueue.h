@@ -0,0 +1,168 @@
+/**
+ * @file boundedqueue.h
+ * @brief Declaration and implementation of the BoundedQueue class template.
+ *
+ * This file defines BoundedQueue, a blocking priority FIFO with a fixed
+ * capacity used to connect the stages of the ImageLoader pipeline. A full
+ * queue blocks its producer, which is how a slow stage pushes back on the
+ * stage feeding it.
+ */
+#ifndef IMAGELOADERLIB_BOUNDEDQUEUE_H
+#define IMAGELOADERLIB_BOUNDEDQUEUE_H
+
+#include <QMutex>         // For guarding the items
+#include <QMutexLocker>   // For scoped locking
+#include <QQueue>         // For the items
+#include <QWaitCondition> // For blocking producers and consumers
+
+/**
+ * @brief A thread-safe FIFO with a fixed capacity and blocking push/pop.
+ *
+ * Items carry an optional priority: an item is queued behind every item of
+ * the same or higher priority, so with the default priority of 0 the queue
+ * is a plain FIFO.
+ *
+ * Once closed, blocked and future push() and pop() calls return false
+ * immediately; items still queued can be collected with tryPop().
+ *
+ * @tparam T The item type; must be copyable.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    /**
+     * @brief Constructs an empty, open queue.
+     * @param capacity The maximum number of queued items (at least 1).
+     */
+    explicit BoundedQueue(int capacity)
+        : m_capacity(qMax(1, capacity)),
+        m_closed(false)
+    {
+    }
+
+    /**
+     * @brief Queues an item, blocking while the queue is full.
+     * @param item The item to queue.
+     * @param priority Items with a higher priority are popped first.
+     * @return True if the item was queued, false if the queue was closed.
+     */
+    bool push(const T& item, int priority = 0) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_closed && m_items.size() >= m_capacity) {
+            m_notFull.wait(&m_mutex);
+        }
+        if (m_closed) {
+            return false;
+        }
+        insert(item, priority);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief Queues an item if there is room, without blocking.
+     * @param item The item to queue.
+     * @param priority Items with a higher priority are popped first.
+     * @return True if the item was queued.
+     */
+    bool tryPush(const T& item, int priority = 0) {
+        QMutexLocker locker(&m_mutex);
+        if (m_closed || m_items.size() >= m_capacity) {
+            return false;
+        }
+        insert(item, priority);
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief Removes the first item, blocking while the queue is empty.
+     * @param item Receives the removed item.
+     * @return True if an item was removed, false if the queue was closed.
+     */
+    bool pop(T* item) {
+        QMutexLocker locker(&m_mutex);
+        while (!m_closed && m_items.isEmpty()) {
+            m_notEmpty.wait(&m_mutex);
+        }
+        if (m_closed) {
+            return false;
+        }
+        *item = m_items.dequeue().item;
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief Removes the first item if there is one, without blocking. Works on closed queues.
+     * @param item Receives the removed item.
+     * @return True if an item was removed.
+     */
+    bool tryPop(T* item) {
+        QMutexLocker locker(&m_mutex);
+        if (m_items.isEmpty()) {
+            return false;
+        }
+        *item = m_items.dequeue().item;
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    /**
+     * @brief Closes the queue and wakes every blocked producer and consumer.
+     */
+    void close() {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    /**
+     * @brief Returns the number of queued items.
+     * @return The current depth of the queue.
+     */
+    int size() const {
+        QMutexLocker locker(&m_mutex);
+        return int(m_items.size());
+    }
+
+    /**
+     * @brief Returns the capacity of the queue.
+     * @return The maximum number of queued items.
+     */
+    int capacity() const {
+        return m_capacity;
+    }
+
+private:
+    /**
+     * @brief A queued item and its priority.
+     */
+    struct Entry {
+        T item;       ///< The queued item.
+        int priority; ///< Its priority.
+    };
+
+    /**
+     * @brief Inserts an item behind every item of the same or higher priority. Caller holds the mutex.
+     * @param item The item to insert.
+     * @param priority Its priority.
+     */
+    void insert(const T& item, int priority) {
+        qsizetype position = m_items.size();
+        while (position > 0 && m_items.at(position - 1).priority < priority) {
+            --position; // The common case, equal priorities, never enters the loop
+        }
+        m_items.insert(position, Entry{ item, priority });
+    }
+
+    mutable QMutex m_mutex;     ///< Guards the members below.
+    QWaitCondition m_notEmpty;  ///< Signalled when an item is queued or the queue closes.
+    QWaitCondition m_notFull;   ///< Signalled when an item is removed or the queue closes.
+    QQueue<Entry> m_items;      ///< The queued items, in pop order.
+    const int m_capacity;       ///< Maximum number of queued items.
+    bool m_closed;              ///< True once close() has been called.
+};
+
+#endif // IMAGELOADERLIB_BOUNDEDQUEUE_H
@@ -0,0 +1,188 @@
+/**
+ * @file formatsniffer.cpp
+ * @brief Implementation of the FormatSniffer class.
+ */
+#include "formatsniffer.h"
+#include "rawpreviewextractor.h" // For the camera RAW extensions
+#include "svgrasterizer.h"       // For the SVG extensions
+#include <QFile>                 // For reading file heads
+#include <QFileInfo>             // For file extensions
+#include <QtEndian>              // For the BMP header fields
+#include <cstring>               // For std::memcmp and std::strlen
+
+namespace {
+/**
+ * @brief Tells whether the bytes at an offset match a signature.
+ *
+ * @param data The start of the file.
+ * @param size The number of bytes available.
+ * @param offset Where the signature must be.
+ * @param signature The signature.
+ * @param length The length of the signature.
+ * @return True on a match.
+ */
+bool matchesAt(const uchar* data, qint64 size, qint64 offset, const char* signature, int length) {
+    return size >= offset + length && std::memcmp(data + offset, signature, size_t(length)) == 0;
+}
+
+/**
+ * @brief Tells whether a BMP info header size is one of the known DIB header versions.
+ *
+ * "BM" alone is too common at the start of text files to be trusted.
+ *
+ * @param size The header size field, at offset 14.
+ * @return True for BITMAPCOREHEADER up to BITMAPV5HEADER.
+ */
+bool isDibHeaderSize(quint32 size) {
+    return size == 12 || size == 40 || size == 52 || size == 56 || size == 64 || size == 108 || size == 124;
+}
+
+/**
+ * @brief Tells whether a byte is XML white space.
+ *
+ * @param c The byte.
+ * @return True for space, tab, carriage return and line feed.
+ */
+bool isXmlSpace(uchar c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/**
+ * @brief Finds the end of a construct closed by a terminator.
+ *
+ * @param head The start of the file.
+ * @param from Where to start looking.
+ * @param terminator The closing characters.
+ * @return The position just past the terminator, or -1 if the head ends first.
+ */
+qsizetype skipPast(const QByteArray& head, qsizetype from, const char* terminator) {
+    const qsizetype end = head.indexOf(terminator, from);
+    return end < 0 ? -1 : end + qsizetype(std::strlen(terminator));
+}
+
+/**
+ * @brief Finds the end of a DOCTYPE declaration, internal subset included.
+ *
+ * @param head The start of the file.
+ * @param from The position just past `<!DOCTYPE`.
+ * @return The position just past the closing `>`, or -1 if the head ends first.
+ */
+qsizetype skipDoctype(const QByteArray& head, qsizetype from) {
+    for (qsizetype i = from; i < head.size(); ++i) {
+        if (head.at(i) == '>') {
+            return i + 1;
+        }
+        if (head.at(i) == '[') {
+            const qsizetype subsetEnd = head.indexOf(']', i + 1); // Entity declarations may contain '>'
+            return subsetEnd < 0 ? -1 : skipPast(head, subsetEnd + 1, ">");
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Tells whether text content has an SVG root element within the head.
+ *
+ * The byte order mark, white space, the XML declaration and other
+ * processing instructions, comments and the DOCTYPE may come before it;
+ * the first element must be `<svg`. A mere mention of `<svg` further on
+ * (an HTML page with inline SVG) does not count.
+ *
+ * @param data The start of the file.
+ * @param size The number of bytes available.
+ * @return True if the first element is an `svg` element.
+ */
+bool looksLikeSvg(const uchar* data, qint64 size) {
+    const QByteArray head = QByteArray::fromRawData(reinterpret_cast<const char*>(data), qsizetype(size));
+    qsizetype i = matchesAt(data, size, 0, "\xEF\xBB\xBF", 3) ? 3 : 0; // UTF-8 byte order mark
+    while (i >= 0 && i < head.size()) {
+        if (isXmlSpace(data[i])) {
+            ++i;
+        } else if (matchesAt(data, size, i, "<?", 2)) {
+            i = skipPast(head, i + 2, "?>");
+        } else if (matchesAt(data, size, i, "<!--", 4)) {
+            i = skipPast(head, i + 4, "-->");
+        } else if (matchesAt(data, size, i, "<!DOCTYPE", 9)) {
+            i = skipDoctype(head, i + 9);
+        } else {
+            return matchesAt(data, size, i, "<svg", 4) && i + 4 < size
+                   && (isXmlSpace(data[i + 4]) || data[i + 4] == '>' || data[i + 4] == '/');
+        }
+    }
+    return false; // Only the prolog fits in the head, or it is cut short
+}
+}
+
+/**
+ * @brief Names the format of an encoded image from its first bytes.
+ *
+ * @param data The start of the file.
+ * @param size The number of bytes available, up to HEAD_SIZE are used.
+ * @return "jpeg", "png", "gif", "bmp", "webp" or "svg"; an empty QByteArray if none matches.
+ */
+QByteArray FormatSniffer::sniff(const uchar* data, qint64 size) {
+    if (!data || size <= 0) {
+        return QByteArray();
+    }
+    size = qMin<qint64>(size, HEAD_SIZE);
+    if (matchesAt(data, size, 0, "\xFF\xD8\xFF", 3)) {
+        return QByteArrayLiteral("jpeg");
+    }
+    if (matchesAt(data, size, 0, "\x89PNG\r\n\x1A\n", 8)) {
+        return QByteArrayLiteral("png");
+    }
+    if (matchesAt(data, size, 0, "GIF87a", 6) || matchesAt(data, size, 0, "GIF89a", 6)) {
+        return QByteArrayLiteral("gif");
+    }
+    if (matchesAt(data, size, 0, "RIFF", 4) && matchesAt(data, size, 8, "WEBP", 4)) {
+        return QByteArrayLiteral("webp");
+    }
+    if (matchesAt(data, size, 0, "BM", 2) && size >= 18 && isDibHeaderSize(qFromLittleEndian<quint32>(data + 14))) {
+        return QByteArrayLiteral("bmp");
+    }
+    if (looksLikeSvg(data, size)) {
+        return QByteArrayLiteral("svg");
+    }
+    return QByteArray();
+}
+
+/**
+ * @brief Names the format of an encoded image from its first bytes.
+ *
+ * @param head The start of the file.
+ * @return The format name, or an empty QByteArray if none matches.
+ */
+QByteArray FormatSniffer::sniff(const QByteArray& head) {
+    return sniff(reinterpret_cast<const uchar*>(head.constData()), head.size());
+}
+
+/**
+ * @brief Reads the head of each file and names its format.
+ *
+ * One small read per file; meant for the probe workers, not the GUI thread.
+ *
+ * @param paths The files.
+ * @return The format names, parallel to `paths`; empty for unreadable files and other content.
+ */
+QVector<QByteArray> FormatSniffer::sniffFiles(const QStringList& paths) {
+    QVector<QByteArray> formats;
+    formats.reserve(paths.size());
+    for (const QString& path : paths) {
+        QFile file(path);
+        formats.append(file.open(QIODevice::ReadOnly) ? sniff(file.read(HEAD_SIZE)) : QByteArray());
+    }
+    return formats;
+}
+
+/**
+ * @brief Tells whether a file name has one of the extensions the gallery lists, in any letter case.
+ *
+ * @param path The file.
+ * @return True for image, camera RAW and SVG extensions.
+ */
+bool FormatSniffer::hasImageExtension(const QString& path) {
+    static const QStringList rasterExtensions = { "png", "jpg", "jpeg", "gif", "bmp", "webp" };
+    return rasterExtensions.contains(QFileInfo(path).suffix().toLower())
+           || RawPreviewExtractor::isRawFile(path)
+           || SvgRasterizer::isSvgFile(path);
+}
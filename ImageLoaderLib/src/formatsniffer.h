@@ -0,0 +1,79 @@
+/**
+ * @file formatsniffer.h
+ * @brief Declaration of the FormatSniffer class, which tells image formats from the first bytes of a file.
+ *
+ * This file defines the FormatSniffer class. File names are a weak hint:
+ * extensions may be missing, wrong, or in any letter case. The sniffer
+ * looks at the signature at the start of the content instead and names the
+ * format the way QImageReader does, so the result can be handed to the
+ * decoders as an explicit format, sparing Qt its probe of every plugin.
+ */
+#ifndef IMAGELOADERLIB_FORMATSNIFFER_H
+#define IMAGELOADERLIB_FORMATSNIFFER_H
+
+#include <QByteArray>  // For format names and file heads
+#include <QString>     // For file paths
+#include <QStringList> // For batches of files
+#include <QVector>     // For batch results
+
+/**
+ * @brief Recognises the image formats the gallery shows by their signature.
+ *
+ * Recognised: JPEG, PNG, GIF, BMP, WebP and uncompressed SVG. SVGZ and the
+ * camera RAW formats have no signature of their own (gzip and TIFF), so
+ * they are only ever recognised by extension.
+ *
+ * All methods are static and thread-safe.
+ */
+class FormatSniffer {
+public:
+    /**
+     * @brief Number of bytes at the start of a file that sniff() looks at.
+     *
+     * Binary signatures need 18 bytes at most; the rest leaves room for the
+     * XML prolog, comments and a DOCTYPE with an internal subset before an
+     * SVG root element, as editors like to write them. Still a single page.
+     */
+    static constexpr int HEAD_SIZE = 4096;
+
+    /**
+     * @brief Names the format of an encoded image from its first bytes.
+     *
+     * @param data The start of the file.
+     * @param size The number of bytes available, up to HEAD_SIZE are used.
+     * @return "jpeg", "png", "gif", "bmp", "webp" or "svg"; an empty QByteArray if none matches.
+     */
+    static QByteArray sniff(const uchar* data, qint64 size);
+
+    /**
+     * @brief Names the format of an encoded image from its first bytes.
+     *
+     * @param head The start of the file.
+     * @return The format name, or an empty QByteArray if none matches.
+     */
+    static QByteArray sniff(const QByteArray& head);
+
+    /**
+     * @brief Reads the head of each file and names its format.
+     *
+     * @param paths The files.
+     * @return The format names, parallel to `paths`; empty for unreadable files and other content.
+     */
+    static QVector<QByteArray> sniffFiles(const QStringList& paths);
+
+    /**
+     * @brief Tells whether a file name has one of the extensions the gallery lists, in any letter case.
+     *
+     * @param path The file.
+     * @return True for image, camera RAW and SVG extensions.
+     */
+    static bool hasImageExtension(const QString& path);
+
+private:
+    /**
+     * @brief Not instantiable: the sniffer is stateless.
+     */
+    FormatSniffer() = delete;
+};
+
+#endif // IMAGELOADERLIB_FORMATSNIFFER_H
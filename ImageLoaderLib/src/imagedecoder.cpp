@@ -0,0 +1,129 @@
+/**
+ * @file imagedecoder.cpp
+ * @brief Implementation of the ImageDecoder defaults and of the ImageDecoderRegistry class.
+ */
+#include "imagedecoder.h"
+#include "qtimagedecoder.h"        // For the fallback decoder
+#ifdef IMAGELOADER_HAVE_TURBOJPEG
+#include "turbojpegdecoder.h"      // For JPEG through libjpeg-turbo
+#endif
+#ifdef IMAGELOADER_HAVE_SPNG
+#include "spngdecoder.h"           // For PNG through libspng
+#endif
+#ifdef IMAGELOADER_HAVE_WEBP
+#include "webpdecoder.h"           // For WebP through libwebp
+#endif
+#include <QGlobalStatic>           // For the process-wide instance
+#include <QDebug>                  // For debugging output
+
+/**
+ * @brief Tells whether decoding at a reduced resolution also costs less CPU time.
+ *
+ * @param input The encoded image.
+ * @return supportsScaledDecode(): by default scaling while decoding is assumed to save work.
+ */
+bool ImageDecoder::cheapScaledDecode(const Input& input) const {
+    return supportsScaledDecode(input);
+}
+
+/**
+ * @brief Returns the size decode() actually produces when asked to fit a smaller size.
+ *
+ * @param fullSize The full-resolution dimensions.
+ * @param requested The wanted dimensions.
+ * @return `requested`: by default decoders scale to any size.
+ */
+QSize ImageDecoder::scaledDecodeSize(const QSize& fullSize, const QSize& requested) const {
+    Q_UNUSED(fullSize);
+    return requested;
+}
+
+Q_GLOBAL_STATIC(ImageDecoderRegistry, globalImageDecoderRegistry)
+
+/**
+ * @brief Returns the process-wide registry.
+ * @return The registry, or nullptr during static destruction at exit.
+ */
+ImageDecoderRegistry* ImageDecoderRegistry::instance() {
+    return globalImageDecoderRegistry.isDestroyed() ? nullptr : globalImageDecoderRegistry();
+}
+
+/**
+ * @brief Constructs a registry holding the native decoders this build was configured with.
+ */
+ImageDecoderRegistry::ImageDecoderRegistry()
+    : m_fallback(new QtImageDecoder())
+{
+#ifdef IMAGELOADER_HAVE_TURBOJPEG
+    registerDecoder(new TurboJpegDecoder());
+#endif
+#ifdef IMAGELOADER_HAVE_SPNG
+    registerDecoder(new SpngDecoder());
+#endif
+#ifdef IMAGELOADER_HAVE_WEBP
+    registerDecoder(new WebpDecoder());
+#endif
+}
+
+/**
+ * @brief Destroys the registry and its decoders.
+ */
+ImageDecoderRegistry::~ImageDecoderRegistry() {
+    qDeleteAll(m_decoders);
+}
+
+/**
+ * @brief Adds a decoder, tried before the ones registered earlier.
+ * @param decoder The decoder; the registry takes ownership.
+ */
+void ImageDecoderRegistry::registerDecoder(ImageDecoder* decoder) {
+    if (!decoder) {
+        return;
+    }
+    QWriteLocker locker(&m_lock);
+    m_decoders.prepend(decoder);
+    qDebug() << "Registered image decoder" << decoder->name();
+}
+
+/**
+ * @brief Picks the decoder for an encoded image and reads its header.
+ *
+ * Signatures are compared first, which costs a few byte comparisons per
+ * decoder; only a matching decoder parses the header. A decoder rejecting
+ * the header (CMYK JPEGs, animated WebP, ...) hands the file on to the
+ * next one and finally to Qt.
+ *
+ * @param input The encoded image.
+ * @param header Receives the header as read by the chosen decoder; an invalid size if even Qt cannot read it.
+ * @return The chosen decoder; never null.
+ */
+const ImageDecoder* ImageDecoderRegistry::decoderFor(const ImageDecoder::Input& input, ImageDecoder::Header* header) const {
+    {
+        QReadLocker locker(&m_lock);
+        for (const ImageDecoder* decoder : m_decoders) {
+            if (decoder->canDecode(input.data, input.size) && decoder->readHeader(input, header)) {
+                return decoder;
+            }
+        }
+    }
+    *header = ImageDecoder::Header();
+    m_fallback->readHeader(input, header);
+    return m_fallback.data();
+}
+
+/**
+ * @brief Returns the decoder built on Qt's image plugins, which handles every format Qt can read.
+ * @return The fallback decoder.
+ */
+const ImageDecoder* ImageDecoderRegistry::fallback() const {
+    return m_fallback.data();
+}
+
+/**
+ * @brief Returns the registered native decoders, in the order they are tried.
+ * @return The decoders, without the fallback.
+ */
+QVector<const ImageDecoder*> ImageDecoderRegistry::decoders() const {
+    QReadLocker locker(&m_lock);
+    return QVector<const ImageDecoder*>(m_decoders.cbegin(), m_decoders.cend());
+}
@@ -0,0 +1,192 @@
+/**
+ * @file imagedecoder.h
+ * @brief Declaration of the ImageDecoder interface and of the ImageDecoderRegistry, which picks a decoder by magic bytes.
+ *
+ * This file defines the interface every decoding backend implements, and the
+ * process-wide registry the decode stage asks for the backend of a file.
+ * Backends built on native codec libraries (libjpeg-turbo, libspng,
+ * libwebp) are compiled in when CMake finds the library; anything they do
+ * not claim, or whose header they reject, goes to Qt's image plugins.
+ */
+#ifndef IMAGELOADERLIB_IMAGEDECODER_H
+#define IMAGELOADERLIB_IMAGEDECODER_H
+
+#include <QByteArray>     // For format names
+#include <QImage>         // For the decoded pixels
+#include <QReadWriteLock> // For guarding the registered decoders
+#include <QScopedPointer> // For owning the fallback decoder
+#include <QSize>          // For image dimensions
+#include <QVector>        // For the registered decoders
+
+/**
+ * @brief A decoding backend for one or more encoded formats.
+ *
+ * Decoders work on encoded bytes already in memory (a mapping or a
+ * prefetched buffer) and keep no state between calls: one instance serves
+ * every worker thread at once, so all methods must be thread-safe.
+ *
+ * Orientation is not a decoder's business: pixels are returned as stored,
+ * and the scale stage applies the EXIF orientation.
+ */
+class ImageDecoder {
+public:
+    /**
+     * @brief The encoded image handed to a decoder.
+     */
+    struct Input {
+        const uchar* data = nullptr; ///< The encoded bytes.
+        qint64 size = 0;             ///< Number of encoded bytes.
+        QByteArray format;           ///< Format name as spelled by QImageReader, if known; only Qt's decoder uses it.
+    };
+
+    /**
+     * @brief What a decoder will produce for an input, read from its header.
+     */
+    struct Header {
+        QSize size;                                          ///< Full-resolution dimensions.
+        QImage::Format pixelFormat = QImage::Format_Invalid; ///< Format decode() produces.
+    };
+
+    /**
+     * @brief Destroys the decoder.
+     */
+    virtual ~ImageDecoder() = default;
+
+    /**
+     * @brief Returns the name of the backend, for logs and benchmarks.
+     * @return A short name such as "libjpeg-turbo".
+     */
+    virtual QByteArray name() const = 0;
+
+    /**
+     * @brief Tells whether the encoded bytes start with a signature this decoder handles.
+     *
+     * Only the first bytes are looked at; the header may still turn out to
+     * be unsupported, which readHeader() reports.
+     *
+     * @param data The encoded bytes.
+     * @param size The number of encoded bytes.
+     * @return True if the signature matches.
+     */
+    virtual bool canDecode(const uchar* data, qint64 size) const = 0;
+
+    /**
+     * @brief Parses the header without decoding pixels.
+     *
+     * @param input The encoded image.
+     * @param header Receives the dimensions and output format.
+     * @return False if the header is malformed or uses a feature this backend does not support.
+     */
+    virtual bool readHeader(const Input& input, Header* header) const = 0;
+
+    /**
+     * @brief Tells whether the decoder can produce a reduced resolution without a full-size buffer.
+     *
+     * @param input The encoded image.
+     * @return True if decode() at a smaller size needs less memory than decoding at full size.
+     */
+    virtual bool supportsScaledDecode(const Input& input) const = 0;
+
+    /**
+     * @brief Tells whether decoding at a reduced resolution also costs less CPU time.
+     *
+     * Some codecs (JPEG, through DCT scaling) skip work at smaller sizes;
+     * others decode every pixel and only scale the output rows. The default
+     * follows supportsScaledDecode().
+     *
+     * @param input The encoded image.
+     * @return True if decode() at a smaller size is faster than decoding at full size.
+     */
+    virtual bool cheapScaledDecode(const Input& input) const;
+
+    /**
+     * @brief Returns the size decode() actually produces when asked to fit a smaller size.
+     *
+     * The default is the requested size itself; decoders restricted to fixed
+     * reduction factors return the smallest size they can make that still
+     * covers the request.
+     *
+     * @param fullSize The full-resolution dimensions.
+     * @param requested The wanted dimensions.
+     * @return The dimensions to pass to decode().
+     */
+    virtual QSize scaledDecodeSize(const QSize& fullSize, const QSize& requested) const;
+
+    /**
+     * @brief Decodes the pixels.
+     *
+     * If `image` already has the size and the pixel format the decoder is
+     * about to produce, the pixels are written into it, so callers can hand
+     * in a pooled buffer; otherwise it is replaced by a new image. When
+     * decoding fails part way (a truncated file), whatever was decoded is
+     * left in the buffer.
+     *
+     * @param input The encoded image.
+     * @param size The full size, or a size returned by scaledDecodeSize().
+     * @param image In: an optional buffer to decode into. Out: the pixels.
+     * @return True on success, including truncated files the codec could decode with a warning.
+     */
+    virtual bool decode(const Input& input, const QSize& size, QImage* image) const = 0;
+};
+
+/**
+ * @brief The process-wide list of decoders, tried in order for every file.
+ *
+ * Decoders are only ever added, never removed, so the pointers handed out
+ * stay valid for the lifetime of the registry. All methods are thread-safe.
+ */
+class ImageDecoderRegistry {
+public:
+    /**
+     * @brief Returns the process-wide registry.
+     * @return The registry, or nullptr during static destruction at exit.
+     */
+    static ImageDecoderRegistry* instance();
+
+    /**
+     * @brief Constructs a registry holding the native decoders this build was configured with.
+     */
+    ImageDecoderRegistry();
+
+    /**
+     * @brief Destroys the registry and its decoders.
+     */
+    ~ImageDecoderRegistry();
+
+    /**
+     * @brief Adds a decoder, tried before the ones registered earlier.
+     * @param decoder The decoder; the registry takes ownership.
+     */
+    void registerDecoder(ImageDecoder* decoder);
+
+    /**
+     * @brief Picks the decoder for an encoded image and reads its header.
+     *
+     * The first decoder whose signature matches and which accepts the header
+     * wins; Qt's decoder is used when none does.
+     *
+     * @param input The encoded image.
+     * @param header Receives the header as read by the chosen decoder; an invalid size if even Qt cannot read it.
+     * @return The chosen decoder; never null.
+     */
+    const ImageDecoder* decoderFor(const ImageDecoder::Input& input, ImageDecoder::Header* header) const;
+
+    /**
+     * @brief Returns the decoder built on Qt's image plugins, which handles every format Qt can read.
+     * @return The fallback decoder.
+     */
+    const ImageDecoder* fallback() const;
+
+    /**
+     * @brief Returns the registered native decoders, in the order they are tried.
+     * @return The decoders, without the fallback.
+     */
+    QVector<const ImageDecoder*> decoders() const;
+
+private:
+    mutable QReadWriteLock m_lock;            ///< Guards `m_decoders`.
+    QVector<ImageDecoder*> m_decoders;        ///< Owned native decoders, most recently registered first.
+    QScopedPointer<ImageDecoder> m_fallback;  ///< Qt's decoder.
+};
+
+#endif // IMAGELOADERLIB_IMAGEDECODER_H
@@ -8,17 +8,407 @@
  * related to image loading status.
  */
 #include "imageloader.h"
+#include "memorybudget.h"    // For decode admission control
+#include "pixelbufferpool.h" // For recycled decode and preview buffers
+#include "mappedfiledevice.h" // For zero-copy decoder input
+#include "readaheadcache.h"  // For the I/O-only prefetch stage
+#include "loadjob.h"         // For the pipeline jobs
+#include "loadpipeline.h"    // For the staged I/O / decode / scale workers
+#include "mpscring.h"        // For the worker-to-GUI completion ring
+#include "placeholderrenderer.h" // For composing placeholder images
+#include "pixelkernels.h"    // For format conversion and downscale kernels
+#include "rawpreviewextractor.h" // For the JPEG previews of camera RAW files
+#include "svgrasterizer.h"   // For rasterizing SVG documents at preview size
+#include "imagedecoder.h"    // For the decoding backends
+#include "formatsniffer.h"   // For recognising formats by content
+#include <QBuffer>           // For reading the EXIF orientation from memory
 #include <QDir>              // For directory operations (listing files)
 #include <QFileInfo>         // For file information (checking if it's a file)
 #include <QImage>            // For image loading and manipulation
-#include <QPainter>          // For drawing text on placeholder images
+#include <QPainter>          // For enlarging small images
 #include <QDebug>            // For debugging output
 #include <QCoreApplication>  // For QCoreApplication::applicationDirPath() etc.
-#include <QTimer>            // To simulate asynchronous loading
+#include <QTimer>            // To debounce directory rescans
+#include <QFileSystemWatcher> // For live updates of the image index
+#include <QSet>              // For the watched-path bookkeeping
+#include <QImageReader>      // For header-only metadata probing and EXIF orientation
+#include <QThreadPool>       // For the parallel probe pass
+#include <QThread>           // For QThread::idealThreadCount()
+#include <QPromise>          // For requestImage() futures
+#include <QElapsedTimer>     // For the per-frame drain budget
+#include <numeric>           // For std::iota
+#include <utility>           // For handing decoded buffers over with std::move
 
 
 // Namespace ImageGallery::Loader rimosso
 
+namespace {
+/**
+ * @brief Default budget for memory held by in-flight decodes (512 MiB).
+ */
+constexpr qint64 DEFAULT_DECODE_MEMORY_BUDGET = 512ll * 1024 * 1024;
+
+/**
+ * @brief Default capacity of the readahead buffer for encoded bytes (64 MiB).
+ */
+constexpr qint64 DEFAULT_READAHEAD_CAPACITY = 64ll * 1024 * 1024;
+
+/**
+ * @brief Minimum interval between two `imagesLoaded` emissions: one frame at 60 Hz.
+ */
+constexpr int BATCH_DELIVERY_INTERVAL_MS = 16;
+
+/**
+ * @brief Interval of the frame timer draining the completion ring: one frame at 60 Hz.
+ */
+constexpr int FRAME_INTERVAL_MS = 16;
+
+/**
+ * @brief Time the loader's thread may spend publishing results per frame (4 ms).
+ *
+ * A quarter of a 60 Hz frame: the rest is left to input handling and painting.
+ */
+constexpr qint64 FRAME_DRAIN_BUDGET_NS = 4 * 1000 * 1000;
+
+/**
+ * @brief Number of slots of the completion ring.
+ *
+ * Far more than the pipeline can have in flight; if it ever fills up,
+ * results fall back to one queued call each.
+ */
+constexpr int COMPLETION_RING_CAPACITY = 1024;
+
+/**
+ * @brief Drafts are only worth decoding for images at least this many times the preview area.
+ */
+constexpr qint64 DRAFT_MIN_AREA_RATIO = 16;
+
+/**
+ * @brief Linear downscale factor of draft decodes (JPEG DCT scaling supports 1/8).
+ */
+constexpr int DRAFT_SCALE_DIVISOR = 8;
+
+/**
+ * @brief Quiet period after the last request before cached low-quality previews are upgraded (ms).
+ */
+constexpr int IDLE_UPGRADE_DELAY_MS = 1000;
+
+/**
+ * @brief Number of previews re-scaled per idle upgrade round.
+ */
+constexpr int IDLE_UPGRADE_BATCH = 4;
+
+/**
+ * @brief Number of recently loaded files watched individually for in-place writes.
+ *
+ * The directory watch does not report writes into existing files; watching
+ * every file would exhaust the per-user inotify watches on large folders.
+ */
+constexpr int MAX_WATCHED_FILES = 32;
+
+/**
+ * @brief Number of bytes at the end of a PNG file searched for its IEND chunk.
+ */
+constexpr qint64 TRAILER_SEARCH_WINDOW = 4096;
+
+/**
+ * @brief QImage text key marking previews scaled with the fast filter.
+ */
+const QString QUALITY_TEXT_KEY = QStringLiteral("ImageLoader.Quality");
+
+/**
+ * @brief Tells whether the primary image of a JPEG file reaches its EOI marker.
+ *
+ * The EOI is not necessarily near the end of the file: multi-picture files
+ * (MPF) and motion photos append further images or a whole video after it.
+ * The marker segments are walked up to the first scan, and the EOI is then
+ * searched for forwards: byte stuffing guarantees that FF D9 cannot occur
+ * inside entropy-coded data, while an EXIF thumbnail's EOI, which lives in
+ * an APP1 segment, is skipped along with its segment.
+ *
+ * @param data The encoded bytes, starting with SOI.
+ * @param size The number of encoded bytes.
+ * @return False if the file ends before the EOI of its first image; true otherwise, malformed headers included.
+ */
+bool jpegReachesEndOfImage(const uchar* data, qint64 size) {
+    qint64 pos = 2; // After SOI
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return true; // Not a marker: malformed, leave it to the decoder
+        }
+        const uchar marker = data[pos + 1];
+        if (marker == 0xFF) {
+            ++pos; // Fill byte
+            continue;
+        }
+        if (marker == 0xDA) { // SOS: entropy-coded data follows
+            const QByteArrayView rest(data + pos, size - pos);
+            return rest.indexOf(QByteArrayView("\xFF\xD9", 2)) >= 0;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            pos += 2; // Markers without a length
+            continue;
+        }
+        pos += 2 + ((qint64(data[pos + 2]) << 8) | data[pos + 3]);
+    }
+    return false; // Ended inside the header segments
+}
+
+/**
+ * @brief Heuristically tells whether an encoded file ends before its end marker.
+ *
+ * This is the case for files still being written into the watched
+ * directory, or cut short by a failed copy. Only formats with a trailer are
+ * recognised; others are assumed complete. Data appended after the end
+ * marker (MPF images and motion photo videos after a JPEG, a few KiB of
+ * metadata after a PNG) is not mistaken for truncation.
+ *
+ * @param format The format name, as reported by QImageReader.
+ * @param data The encoded bytes.
+ * @param size The number of encoded bytes.
+ * @return True if the file looks truncated.
+ */
+bool looksTruncated(const QByteArray& format, const uchar* data, qint64 size) {
+    if (!data || size <= 0) {
+        return false;
+    }
+    if (format == "jpeg" || format == "jpg") {
+        return !jpegReachesEndOfImage(data, size);
+    }
+    const QByteArray tail = QByteArray::fromRawData(reinterpret_cast<const char*>(data) + qMax<qint64>(0, size - TRAILER_SEARCH_WINDOW),
+                                                    int(qMin<qint64>(size, TRAILER_SEARCH_WINDOW)));
+    if (format == "png") {
+        return !tail.contains("IEND");
+    }
+    if (format == "gif") {
+        return tail.at(tail.size() - 1) != ';'; // GIF trailer byte 0x3B
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the encoded bytes the I/O stage left in a job, for a decoder.
+ *
+ * @param job The job; its mapping or prefetched buffer must be set.
+ * @return The input, with the probed or sniffed format as hint.
+ */
+ImageDecoder::Input encodedInput(const LoadJob& job) {
+    ImageDecoder::Input input;
+    if (job.mapped) {
+        input.data = job.mapped->data();
+        input.size = job.mapped->size();
+    } else {
+        input.data = reinterpret_cast<const uchar*>(job.encoded.constData());
+        input.size = job.encoded.size();
+    }
+    input.format = job.metadata.format;
+    if (input.format.isEmpty()) {
+        input.format = FormatSniffer::sniff(input.data, input.size); // Not probed yet: the bytes are in memory anyway
+    }
+    return input;
+}
+
+/**
+ * @brief Creates an image over pooled memory, or a plain image if the pool is gone.
+ */
+QImage createPooledImage(const QSize& size, QImage::Format format) {
+    PixelBufferPool* pool = PixelBufferPool::instance();
+    return pool ? pool->createImage(size, format) : QImage(size, format);
+}
+
+/**
+ * @brief Returns the format images are normalized to: the ones Qt blits and scales fastest.
+ *
+ * @param hasAlpha True if the image has an alpha channel.
+ * @return Format_ARGB32_Premultiplied with alpha, Format_RGB32 otherwise.
+ */
+QImage::Format fastBlitFormat(bool hasAlpha) {
+    return hasAlpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+}
+
+/**
+ * @brief Tells whether a decoded format must be converted to a fast-blit format.
+ *
+ * @param format The decoded format; Format_Invalid if unknown.
+ * @return True unless the format is already Format_RGB32 or Format_ARGB32_Premultiplied.
+ */
+bool needsNormalization(QImage::Format format) {
+    return format != QImage::Format_RGB32 && format != QImage::Format_ARGB32_Premultiplied;
+}
+
+/**
+ * @brief Converts a decoded image to its fast-blit format, once, right after decoding.
+ *
+ * Decoders return whatever the file stores (Indexed8, Grayscale8, RGB888,
+ * non-premultiplied ARGB32, RGBA64...); normalizing here means that scaling,
+ * caching and QPixmap::fromImage() never convert again on the hot path.
+ * Every format is written into a pooled buffer with the PixelKernels
+ * kernel for the decoded format, 32-bit ones included: decoded images live
+ * over pooled memory they do not own, which QImage::convertTo() would copy
+ * into a heap buffer of its own rather than rewrite in place. The few
+ * formats without a kernel (1-bit, 16-bit RGB, 30-bit) fall back to a 1:1
+ * source blit through QPainter. No conversion ever allocates outside the pool.
+ *
+ * @param image The decoded image.
+ * @return The image in Format_RGB32 or Format_ARGB32_Premultiplied, or a null image if no buffer could be had.
+ */
+QImage normalizePixelFormat(QImage image) {
+    if (image.isNull() || !needsNormalization(image.format())) {
+        return image;
+    }
+    QImage target = createPooledImage(image.size(), fastBlitFormat(image.hasAlphaChannel()));
+    if (target.isNull()) {
+        qDebug() << "No buffer to normalize a" << image.size() << "image into.";
+        return QImage();
+    }
+    if (PixelKernels::convert(image, target)) {
+        return target;
+    }
+    QPainter painter(&target);
+    painter.setCompositionMode(QPainter::CompositionMode_Source); // Every pixel is written, alpha included
+    painter.drawImage(0, 0, image);
+    return target;
+}
+
+/**
+ * @brief Returns the EXIF orientation recorded in an image's metadata.
+ */
+QImageIOHandler::Transformations orientationOf(const ImageData& metadata) {
+    return QImageIOHandler::Transformations(QFlag(metadata.transformation));
+}
+
+/**
+ * @brief Returns the size of an image once `orientation` is applied.
+ *
+ * Swapping the axes is its own inverse, so this also maps an oriented size
+ * back to the decoded one.
+ */
+QSize orientedSize(const QSize& size, QImageIOHandler::Transformations orientation) {
+    return orientation.testFlag(QImageIOHandler::TransformationRotate90) ? size.transposed() : size;
+}
+
+/**
+ * @brief Scales `source` to `targetSize` into a pooled 32-bit image, applying an EXIF orientation.
+ *
+ * Reductions use the box filter of PixelKernels, or the point filter if
+ * `fast` is set; the kernel writes the result already oriented, so rotated
+ * photos cost no extra pass. Enlargements of small images are rare and go
+ * through QPainter's bilinear filter, after orienting the source.
+ *
+ * @param source The decoded image.
+ * @param targetSize The oriented size of the result.
+ * @param fast True for the point filter.
+ * @param orientation The EXIF orientation of `source`.
+ */
+QImage scaleIntoPooledImage(const QImage& source, const QSize& targetSize, bool fast = false,
+                            QImageIOHandler::Transformations orientation = QImageIOHandler::TransformationNone) {
+    const QImage::Format targetFormat = fastBlitFormat(source.hasAlphaChannel());
+    QImage target = createPooledImage(targetSize, targetFormat);
+    if (target.isNull()) {
+        return QImage();
+    }
+
+    const QImage source32 = normalizePixelFormat(source); // A no-op for decoded images
+    const QSize decodedTargetSize = orientedSize(targetSize, orientation);
+    if (decodedTargetSize.width() <= source.width() && decodedTargetSize.height() <= source.height()) {
+        PixelKernels::downscale(source32, target, fast ? PixelKernels::PointFilter : PixelKernels::BoxFilter, orientation);
+    } else {
+        QImage oriented = source32;
+        if (orientation != QImageIOHandler::TransformationNone) {
+            // A 1:1 "reduction" with the point filter is an exact, oriented copy
+            oriented = createPooledImage(orientedSize(source.size(), orientation), targetFormat);
+            PixelKernels::downscale(source32, oriented, PixelKernels::PointFilter, orientation);
+        }
+        target.fill(Qt::transparent);
+        QPainter painter(&target);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.drawImage(target.rect(), oriented);
+    }
+    return target;
+}
+}
+
+/**
+ * @brief Returns the number of rows in the table.
+ * @return The number of rows.
+ */
+int ImageMetadataTable::size() const {
+    return sizes.size();
+}
+
+/**
+ * @brief Resizes every column to `rows` entries; new rows are unprobed.
+ * @param rows The new number of rows.
+ */
+void ImageMetadataTable::resize(int rows) {
+    names.resize(rows);
+    sizes.resize(rows);
+    formats.resize(rows);
+    pixelFormats.resize(rows, QImage::Format_Invalid);
+    transformations.resize(rows, 0);
+    probed.resize(rows, 0);
+}
+
+/**
+ * @brief Inserts an unprobed row at `id`, shifting the following rows up.
+ * @param id The position of the new row.
+ */
+void ImageMetadataTable::insertRow(int id) {
+    names.insert(id, QString());
+    sizes.insert(id, QSize());
+    formats.insert(id, QByteArray());
+    pixelFormats.insert(id, QImage::Format_Invalid);
+    transformations.insert(id, 0);
+    probed.insert(id, 0);
+}
+
+/**
+ * @brief Removes the row at `id`, shifting the following rows down.
+ * @param id The row to remove.
+ */
+void ImageMetadataTable::removeRow(int id) {
+    names.removeAt(id);
+    sizes.removeAt(id);
+    formats.removeAt(id);
+    pixelFormats.removeAt(id);
+    transformations.removeAt(id);
+    probed.removeAt(id);
+}
+
+/**
+ * @brief Stores the metadata of `data` in row `id`.
+ * @param id The row to write.
+ * @param data The metadata to store; `data.image` is ignored.
+ */
+void ImageMetadataTable::setRow(int id, const ImageData& data) {
+    names[id] = data.name;
+    sizes[id] = data.size;
+    formats[id] = data.format;
+    pixelFormats[id] = data.pixelFormat;
+    transformations[id] = data.transformation;
+    probed[id] = data.probed ? 1 : 0;
+}
+
+/**
+ * @brief Assembles the row `id` into an ImageData value (without pixels).
+ * @param id The row to read.
+ * @return The metadata of the row, or a default ImageData if `id` is out of range.
+ */
+ImageData ImageMetadataTable::row(int id) const {
+    ImageData data;
+    if (id < 0 || id >= size()) {
+        return data;
+    }
+    data.name = names.at(id);
+    data.size = sizes.at(id);
+    data.format = formats.at(id);
+    data.pixelFormat = pixelFormats.at(id);
+    data.transformation = transformations.at(id);
+    data.probed = probed.at(id) != 0;
+    return data;
+}
+
 /**
  * @brief Constructor for ImageLoader.
  *
@@ -38,12 +428,62 @@ ImageLoader::ImageLoader(const QString& imageDirPath, int maxImages, const QSize
     m_imageDirPath(imageDirPath),
     m_maxConfiguredImages(maxImages),
     m_maxPreviewSize(maxPreviewSize),
-    m_imageCache(cache) // Assign the provided cache instance
+    m_imageCache(cache), // Assign the provided cache instance
+    m_watcher(new QFileSystemWatcher(this)),
+    m_rescanTimer(new QTimer(this)),
+    m_probePool(new QThreadPool(this)),
+    m_pipeline(new LoadPipeline()),
+    m_publishPending(0),
+    m_completions(new MpscRing<LoadCompletion>(COMPLETION_RING_CAPACITY)),
+    m_drainScheduled(0),
+    m_frameTimer(new QTimer(this)),
+    m_decodeBudget(new MemoryBudget(DEFAULT_DECODE_MEMORY_BUDGET)),
+    m_readahead(new ReadaheadCache(DEFAULT_READAHEAD_CAPACITY)),
+    m_pageCacheBypassThreshold(0),
+    m_batchTimer(new QTimer(this)),
+    m_scaleQuality(HighQualityScaling),
+    m_idleUpgradeTimer(new QTimer(this)),
+    m_placeholders(new PlaceholderRenderer(maxPreviewSize)),
+    m_svg(new SvgRasterizer())
 {
     if (!m_imageCache) {
         qDebug() << "Warning: ImageCache pointer is null in ImageLoader constructor!";
     }
+
+    // Ingest tools often write a file in several chunks: wait for a short quiet
+    // period before re-listing the directory so one copy yields one delta.
+    m_rescanTimer->setSingleShot(true);
+    m_rescanTimer->setInterval(200);
+    connect(m_rescanTimer, &QTimer::timeout, this, &ImageLoader::applyDirectoryDelta);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &ImageLoader::onDirectoryChanged);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged, this, &ImageLoader::onFileChanged);
+
+    // Batch results are coalesced so that a contact sheet repaints once per frame, not once per image
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(BATCH_DELIVERY_INTERVAL_MS);
+    connect(m_batchTimer, &QTimer::timeout, this, &ImageLoader::flushBatchResults);
+
+    // Worker results are drained once per frame rather than posted one event each
+    m_frameTimer->setTimerType(Qt::PreciseTimer);
+    m_frameTimer->setInterval(FRAME_INTERVAL_MS);
+    connect(m_frameTimer, &QTimer::timeout, this, &ImageLoader::drainCompletions);
+
+    // Previews scaled cheaply during fast navigation are redone once things are quiet
+    m_idleUpgradeTimer->setSingleShot(true);
+    m_idleUpgradeTimer->setInterval(IDLE_UPGRADE_DELAY_MS);
+    connect(m_idleUpgradeTimer, &QTimer::timeout, this, &ImageLoader::upgradeCachedImages);
+
+    m_probePool->setMaxThreadCount(QThread::idealThreadCount());
+    setDecodeMemoryBudget(DEFAULT_DECODE_MEMORY_BUDGET);
+    startPipeline();
+    qDebug() << "ImageLoader pixel kernels use the" << PixelKernels::instructionSet() << "instruction set.";
+
     populateImagePaths(); // Discover available image files at initialization
+
+    // Read the headers of every real image in the background
+    QVector<int> allIds(m_imagePaths.size());
+    std::iota(allIds.begin(), allIds.end(), 0);
+    probeMetadataAsync(allIds);
     qDebug() << "ImageLoader initialized. Found" << m_imagePaths.size() << "actual images. Max configured images:" << m_maxConfiguredImages;
 }
 
@@ -53,135 +493,1504 @@ ImageLoader::ImageLoader(const QString& imageDirPath, int maxImages, const QSize
  * Cleans up any resources allocated by the ImageLoader.
  */
 ImageLoader::~ImageLoader() {
+    // Probe tasks and pipeline workers post their results back to this object: stop them first
+    m_probePool->clear();
+    m_decodeBudget->interrupt(); // Jobs still queued are parked rather than decoded
+    m_pipeline->stop();
+    m_probePool->waitForDone();
     qDebug() << "ImageLoader destroyed.";
 }
 
+/**
+ * @brief Lists the image files currently present in the image directory.
+ *
+ * Files with an image extension, in any letter case, are listed right
+ * away; the header probe checks their content later. Any other file is
+ * listed if its content was sniffed as an image format, and returned in
+ * `unsniffed` if it has not been sniffed since it last changed. The
+ * listing is sorted by name, which is what gives every file its ID.
+ *
+ * @param unsniffed Receives the files to sniff, if not null.
+ * @return The image files, sorted by name.
+ */
+QFileInfoList ImageLoader::listImageFiles(QFileInfoList* unsniffed) {
+    QDir imageDir(m_imageDirPath);
+    if (!imageDir.exists()) {
+        return QFileInfoList();
+    }
+
+    const QFileInfoList entries = imageDir.entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+    QFileInfoList images;
+    QSet<QString> present;
+    for (const QFileInfo& fileInfo : entries) {
+        const QString path = fileInfo.absoluteFilePath();
+        if (FormatSniffer::hasImageExtension(path)) {
+            images.append(fileInfo);
+            continue;
+        }
+        present.insert(path);
+        const auto sniffed = m_sniffedFormats.constFind(path);
+        if (sniffed != m_sniffedFormats.cend() && sniffed->stamp.size == fileInfo.size()
+            && sniffed->stamp.lastModified == fileInfo.lastModified()) {
+            if (!sniffed->format.isEmpty()) {
+                images.append(fileInfo); // No image extension, but image content
+            }
+        } else if (unsniffed) {
+            unsniffed->append(fileInfo);
+        }
+    }
+    for (auto it = m_sniffedFormats.begin(); it != m_sniffedFormats.end();) {
+        it = present.contains(it.key()) ? std::next(it) : m_sniffedFormats.erase(it); // Forget files that are gone
+    }
+    return images;
+}
+
+/**
+ * @brief Sniffs the content of files without an image extension on the probe pool.
+ *
+ * @param files The files to sniff.
+ */
+void ImageLoader::sniffFilesAsync(const QFileInfoList& files) {
+    if (files.isEmpty()) {
+        return;
+    }
+    QStringList paths;
+    QVector<FileStamp> stamps;
+    paths.reserve(files.size());
+    stamps.reserve(files.size());
+    for (const QFileInfo& fileInfo : files) {
+        paths.append(fileInfo.absoluteFilePath());
+        stamps.append(FileStamp{fileInfo.size(), fileInfo.lastModified()});
+    }
+    m_probePool->start([this, paths, stamps]() {
+        const QVector<QByteArray> formats = FormatSniffer::sniffFiles(paths); // One small read per file
+        QMetaObject::invokeMethod(this, [this, paths, stamps, formats]() {
+            applySniffResults(paths, stamps, formats);
+        }, Qt::QueuedConnection);
+    });
+    qDebug() << "Scheduled content sniffing for" << files.size() << "files without an image extension.";
+}
+
+/**
+ * @brief Records sniffed formats and adds the files recognised as images to the index.
+ *
+ * @param paths The sniffed files.
+ * @param stamps The size and modification time of each file when it was listed.
+ * @param formats The sniffed formats, empty for other content.
+ */
+void ImageLoader::applySniffResults(const QStringList& paths, const QVector<FileStamp>& stamps,
+                                    const QVector<QByteArray>& formats) {
+    bool foundImages = false;
+    for (int i = 0; i < paths.size(); ++i) {
+        m_sniffedFormats.insert(paths.at(i), SniffedFormat{stamps.at(i), formats.at(i)});
+        if (!formats.at(i).isEmpty()) {
+            qDebug() << "Recognised" << paths.at(i) << "as" << formats.at(i) << "by its content.";
+            foundImages = true;
+        }
+    }
+    if (foundImages) {
+        applyDirectoryDelta(); // Inserts them at their place in the index
+    }
+}
+
 /**
  * @brief Discovers image files in the specified directory and populates m_imagePaths.
  *
  * This method scans the `m_imageDirPath` for common image file extensions
- * and stores their absolute paths in `m_imagePaths`.
+ * and stores their absolute paths in `m_imagePaths`. The directory is
+ * registered with the file system watcher (or its nearest existing parent,
+ * until it is created) so that later changes are applied incrementally by
+ * `applyDirectoryDelta()`.
  */
 void ImageLoader::populateImagePaths() {
     QDir imageDir(m_imageDirPath);
+    watchImageDirectory();
     if (!imageDir.exists()) {
         qDebug() << "Image directory does not exist:" << m_imageDirPath;
         return;
     }
 
-    // Filter for common image file extensions
-    QStringList filters;
-    filters << "*.png" << "*.jpg" << "*.jpeg" << "*.gif" << "*.bmp" << "*.webp";
-    QFileInfoList fileList = imageDir.entryInfoList(filters, QDir::Files | QDir::NoDotAndDotDot);
+    QFileInfoList unsniffed;
+    const QFileInfoList fileList = listImageFiles(&unsniffed);
 
     m_imagePaths.clear();
+    m_fileStamps.clear();
     for (const QFileInfo& fileInfo : fileList) {
-        m_imagePaths.append(fileInfo.absoluteFilePath());
+        const QString path = fileInfo.absoluteFilePath();
+        m_imagePaths.append(path);
+        m_fileStamps.insert(path, FileStamp{fileInfo.size(), fileInfo.lastModified()});
     }
+    m_metadata = ImageMetadataTable();
+    m_metadata.resize(m_imagePaths.size());
+
     qDebug() << "Populated image paths. Found" << m_imagePaths.size() << "image files.";
+    sniffFilesAsync(unsniffed); // Files without an image extension join the index once recognised
 }
 
 /**
- * @brief Generates a placeholder image with the given ID and dimensions.
- *
- * This method creates a dark gray image and draws the image ID in white,
- * bold Arial font, centered within the image.
+ * @brief Watches the image directory, or its nearest existing parent while it does not exist.
  *
- * @param id The ID of the image for which to generate a placeholder.
- * @return A QImage representing the placeholder.
+ * A watch on the parent reports the creation of the directory, after which
+ * the next call moves the watch onto the directory itself. Called again
+ * after every delta, since the directory may also be deleted and re-created.
  */
-QImage ImageLoader::generatePlaceholderImage(int id) const {
-    // Creiamo un'immagine con uno sfondo grigio scuro per un look più moderno
-    QImage placeholder(m_maxPreviewSize, QImage::Format_RGB32);
-    placeholder.fill(QColor("#444444")); // Un bel grigio scuro
-
-    // QPainter è lo strumento per disegnare sull'immagine
-    QPainter painter(&placeholder);
-
-    // Migliora la qualità del rendering del testo (antialiasing)
-    painter.setRenderHint(QPainter::Antialiasing);
-
-    // Impostiamo il colore della penna su bianco per un buon contrasto
-    painter.setPen(Qt::white);
-
-    // Scegliamo un font grande, in grassetto e ben leggibile
-    QFont font("Arial", 72, QFont::Bold);
-    painter.setFont(font);
+void ImageLoader::watchImageDirectory() {
+    QString target = QDir(m_imageDirPath).absolutePath();
+    while (!QFileInfo(target).isDir()) {
+        const QString parent = QFileInfo(target).absolutePath();
+        if (parent == target) {
+            return; // Not even the root exists (a drive that went away)
+        }
+        target = parent;
+    }
+    const QStringList watched = m_watcher->directories();
+    if (watched.size() == 1 && watched.first() == target) {
+        return;
+    }
+    if (!watched.isEmpty()) {
+        m_watcher->removePaths(watched);
+    }
+    m_watcher->addPath(target);
+    if (target != QDir(m_imageDirPath).absolutePath()) {
+        qDebug() << "Waiting for the image directory to appear in" << target;
+    }
+}
 
-    // Disegniamo il numero dell'ID esattamente al centro del rettangolo dell'immagine
-    painter.drawText(placeholder.rect(), Qt::AlignCenter, QString::number(id));
+/**
+ * @brief Watches a loaded file for in-place writes, dropping the least recently loaded watch beyond the limit.
+ *
+ * Writes into an existing file do not touch its directory, so only files
+ * with a watch of their own (or a later directory change) bring them to
+ * light. The files just loaded are the ones that may be on screen.
+ *
+ * @param path The file.
+ */
+void ImageLoader::watchLoadedFile(const QString& path) {
+    if (!m_watchedFiles.isEmpty() && m_watchedFiles.last() == path) {
+        return; // The common case: the same image loaded again
+    }
+    m_watchedFiles.removeOne(path);
+    m_watchedFiles.append(path);
+    if (!m_watcher->files().contains(path)) {
+        m_watcher->addPath(path);
+    }
+    while (m_watchedFiles.size() > MAX_WATCHED_FILES) {
+        m_watcher->removePath(m_watchedFiles.takeFirst());
+    }
+}
 
-    qDebug() << "Generated placeholder for ID:" << id;
-    return placeholder;
+/**
+ * @brief Reacts to a change notification for the watched directory.
+ *
+ * @param path The path of the directory that changed.
+ */
+void ImageLoader::onDirectoryChanged(const QString& path) {
+    qDebug() << "Image directory changed:" << path;
+    m_rescanTimer->start(); // (Re)start the debounce window
 }
 
 /**
- * @brief Returns the total count of images available (real files + potential placeholders).
+ * @brief Reacts to a change notification for a watched image file.
  *
- * This method returns the maximum of either the number of actual image files found
- * or the maximum configured number of images.
+ * A file that is modified, replaced or deleted all end up here; the
+ * debounced directory delta compares the stamps to sort out which of the
+ * three it was.
  *
- * @return The total number of images that can be accessed via their ID.
+ * @param path The path of the file that changed.
  */
-int ImageLoader::imageCount() const {
-    return qMax(m_imagePaths.size(), m_maxConfiguredImages); // Max of actual files or configured max
+void ImageLoader::onFileChanged(const QString& path) {
+    qDebug() << "Image file changed:" << path;
+    m_rescanTimer->start();
 }
 
 /**
- * @brief Asynchronously loads and emits an image.
- *
- * This method attempts to load an image by its ID. It first checks the cache.
- * If not found, it loads from disk if a real file exists for the ID, or generates
- * a placeholder image otherwise. The `imageLoaded` signal is emitted upon
- * successful completion, or `loadingError` if any issue occurs.
+ * @brief Re-lists the directory and applies add, remove and modify deltas to the index.
  *
- * @param id The ID of the image to load.
+ * Removals are applied first, from the highest ID down, then insertions in
+ * ascending order. Because both the old index and the new listing are sorted
+ * by name, the surviving files form a subsequence of the new listing and every
+ * new file can be inserted directly at its final position. Cached previews of
+ * files whose ID moved are re-keyed; only the previews of removed or modified
+ * files, and of placeholder slots that became real files, are dropped.
  */
-void ImageLoader::loadImageAsync(int id) {
-    if (id < 0 || id >= imageCount()) {
-        emit loadingError(id, "Image ID out of bounds.");
-        return;
-    }
+void ImageLoader::applyDirectoryDelta() {
+    const int oldCount = imageCount();
+    QFileInfoList unsniffed;
+    const QFileInfoList fileList = listImageFiles(&unsniffed);
 
-    // 1. Check cache first
-    if (m_imageCache && m_imageCache->contains(id)) {
-        qDebug() << "Image with ID" << id << "found in cache.";
-        emit imageLoaded(id, m_imageCache->getImage(id));
-        return;
+    QStringList newPaths;
+    QHash<QString, FileStamp> newStamps;
+    for (const QFileInfo& fileInfo : fileList) {
+        const QString path = fileInfo.absoluteFilePath();
+        newPaths.append(path);
+        newStamps.insert(path, FileStamp{fileInfo.size(), fileInfo.lastModified()});
     }
 
-    // Simulate asynchronous loading using a single-shot timer
-    // In a real application, you'd use QThreadPool, QFuture, or a separate thread.
-    QTimer::singleShot(50, [this, id]() { // 50ms delay to simulate loading time
-        QImage loadedImage;
-        QString imagePath;
+    // 1. Removed files, highest ID first so the lower IDs stay valid while we go
+    for (int id = m_imagePaths.size() - 1; id >= 0; --id) {
+        const QString path = m_imagePaths.at(id);
+        if (newStamps.contains(path)) {
+            continue;
+        }
+        const int realCount = m_imagePaths.size();
+        m_imagePaths.removeAt(id);
+        m_fileStamps.remove(path);
+        m_upgradeAttempted.remove(path);
+        m_metadata.removeRow(id);
+        m_readahead->invalidate(path);
+        m_svg->forget(path); // A document recreated at the same path comes back through the insert branch
+        if (m_imageCache) {
+            if (m_imageCache->contains(id)) {
+                m_imageCache->removeImage(id);
+            }
+            m_imageCache->shiftImages(id + 1, realCount - 1, -1);
+        }
+        qDebug() << "Image removed from index:" << path << "ID:" << id;
+        emit imageRemoved(id);
+    }
 
-        // 2. Determine if it's a real image or needs a placeholder
-        if (id < m_imagePaths.size()) {
-            imagePath = m_imagePaths.at(id);
-            qDebug() << "Attempting to load image from disk:" << imagePath << "for ID:" << id;
-            loadedImage.load(imagePath); // Load image from file
+    // Files whose header has to be (re-)probed once the index is consistent again
+    QSet<QString> pathsToProbe;
 
-            if (loadedImage.isNull()) {
-                qDebug() << "Failed to load image from file:" << imagePath << ". Generating placeholder.";
-                loadedImage = generatePlaceholderImage(id); // Fallback to placeholder on failure
+    // 2. New files, inserted at their position in the sorted listing
+    for (int id = 0; id < newPaths.size(); ++id) {
+        const QString& path = newPaths.at(id);
+        if (m_fileStamps.contains(path)) {
+            continue;
+        }
+        const int realCount = m_imagePaths.size();
+        if (m_imageCache) {
+            // The first slot after the real files held a placeholder, which now becomes a real file
+            if (m_imageCache->contains(realCount)) {
+                m_imageCache->removeImage(realCount);
             }
-        } else {
-            // ID is beyond the number of actual images found, generate placeholder
-            loadedImage = generatePlaceholderImage(id);
+            m_imageCache->shiftImages(id, realCount - 1, 1);
         }
+        m_imagePaths.insert(id, path);
+        m_fileStamps.insert(path, newStamps.value(path));
+        m_metadata.insertRow(id);
+        pathsToProbe.insert(path);
+        qDebug() << "Image added to index:" << path << "ID:" << id;
+        emit imageInserted(id);
+    }
 
-        // 3. Scale the image to the max preview size
-        if (!loadedImage.isNull()) {
-            loadedImage = loadedImage.scaled(m_maxPreviewSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-            // 4. Add to cache if loading was successful
-            if (m_imageCache) {
-                m_imageCache->setImage(id, loadedImage);
-            }
-            emit imageLoaded(id, loadedImage); // Emit signal with the loaded/generated image
-        } else {
-            // This should ideally not happen if generatePlaceholderImage works as expected
-            emit loadingError(id, "Failed to load or generate image.");
+    // 3. Files whose size or modification time changed
+    for (int id = 0; id < m_imagePaths.size(); ++id) {
+        const QString& path = m_imagePaths.at(id);
+        const FileStamp& newStamp = newStamps[path];
+        FileStamp& oldStamp = m_fileStamps[path];
+        if (oldStamp == newStamp) {
+            continue;
         }
-    });
+        oldStamp = newStamp;
+        if (m_imageCache && m_imageCache->contains(id)) {
+            m_imageCache->removeImage(id);
+        }
+        m_metadata.setRow(id, ImageData());
+        m_readahead->invalidate(path);
+        m_svg->forget(path);
+        m_upgradeAttempted.remove(path);
+        pathsToProbe.insert(path);
+        qDebug() << "Image modified on disk:" << path << "ID:" << id;
+        emit imageModified(id);
+    }
+
+    // 4. Keep the watches in sync: the directory may have appeared or gone, and
+    // the OS drops the watch of a file replaced by a rename
+    watchImageDirectory();
+    const QStringList watchedFiles = m_watcher->files();
+    for (auto it = m_watchedFiles.begin(); it != m_watchedFiles.end();) {
+        if (!newStamps.contains(*it)) {
+            m_watcher->removePath(*it);
+            it = m_watchedFiles.erase(it);
+            continue;
+        }
+        if (!watchedFiles.contains(*it)) {
+            m_watcher->addPath(*it);
+        }
+        ++it;
+    }
+
+    QVector<int> idsToProbe;
+    for (int id = 0; id < m_imagePaths.size(); ++id) {
+        if (pathsToProbe.contains(m_imagePaths.at(id))) {
+            idsToProbe.append(id);
+        }
+    }
+    probeMetadataAsync(idsToProbe);
+    sniffFilesAsync(unsniffed);
+
+    if (imageCount() != oldCount) {
+        emit imageCountChanged(imageCount());
+    }
+}
+
+/**
+ * @brief Reads the header metadata of one file without decoding pixels.
+ *
+ * The format is sniffed from the first bytes, whatever the extension says,
+ * and handed to QImageReader explicitly, so it does not try every plugin
+ * in turn; the probed format then serves as the decoders' hint on every
+ * load. QImageReader only parses the header to answer size(),
+ * imageFormat() and transformation(); the latter reads the EXIF
+ * orientation tag for formats that carry one.
+ *
+ * @param path The absolute path of the file.
+ * @return The probed metadata.
+ */
+ImageData ImageLoader::probeFile(const QString& path) {
+    ImageData data;
+    data.name = QFileInfo(path).fileName();
+
+    if (RawPreviewExtractor::isRawFile(path)) {
+        // Only the TIFF directories and the preview's JPEG header are read
+        QFile file(path);
+        RawPreviewExtractor::Preview preview;
+        if (file.open(QIODevice::ReadOnly)) {
+            preview = RawPreviewExtractor::locate(&file);
+        }
+        data.size = preview.size;
+        data.format = preview.isValid() ? QByteArray("jpeg") : QByteArray();
+        data.pixelFormat = preview.isValid() ? (preview.grayscale ? QImage::Format_Grayscale8 : QImage::Format_RGB32)
+                                             : QImage::Format_Invalid;
+        data.transformation = static_cast<quint8>(int(preview.orientation));
+        data.probed = true;
+        if (!preview.isValid()) {
+            qDebug() << "No embedded JPEG preview found in RAW file" << path;
+        }
+        return data;
+    }
+
+    QFile file(path);
+    const QByteArray sniffed = file.open(QIODevice::ReadOnly) ? FormatSniffer::sniff(file.peek(FormatSniffer::HEAD_SIZE))
+                                                                : QByteArray();
+    QImageReader reader;
+    if (sniffed.isEmpty()) {
+        reader.setFileName(path); // No known signature (SVGZ, ...): let Qt go by extension and content
+    } else {
+        reader.setDevice(&file);
+        reader.setFormat(sniffed);
+    }
+    data.size = reader.size();
+    data.format = sniffed.isEmpty() ? reader.format() : sniffed;
+    data.pixelFormat = reader.imageFormat();
+    data.transformation = static_cast<quint8>(int(reader.transformation()));
+    data.probed = true;
+
+    if (!data.size.isValid()) {
+        qDebug() << "Header probe could not determine the size of" << path << ":" << reader.errorString();
+    }
+    return data;
+}
+
+/**
+ * @brief Probes the headers of the given images in parallel on the probe pool.
+ *
+ * The work is split into roughly four chunks per worker thread so the pool
+ * stays balanced when some headers are slower to read than others, while
+ * keeping the number of posted result events small.
+ *
+ * @param ids The IDs of the real images to probe.
+ */
+void ImageLoader::probeMetadataAsync(const QVector<int>& ids) {
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    const int threads = qMax(1, m_probePool->maxThreadCount());
+    const int chunkSize = qMax(16, int(ids.size() / (threads * 4)) + 1);
+    for (int first = 0; first < ids.size(); first += chunkSize) {
+        const QVector<int> chunkIds = ids.mid(first, chunkSize);
+        QVector<QString> chunkPaths;
+        QVector<FileStamp> chunkStamps;
+        chunkPaths.reserve(chunkIds.size());
+        chunkStamps.reserve(chunkIds.size());
+        for (int id : chunkIds) {
+            chunkPaths.append(m_imagePaths.at(id));
+            chunkStamps.append(m_fileStamps.value(chunkPaths.last()));
+        }
+
+        m_probePool->start([this, chunkIds, chunkPaths, chunkStamps]() {
+            QVector<ImageData> results;
+            results.reserve(chunkPaths.size());
+            for (const QString& path : chunkPaths) {
+                results.append(probeFile(path));
+            }
+            // Hand the results back to the loader's thread, which owns the table
+            QMetaObject::invokeMethod(this, [this, chunkIds, chunkPaths, chunkStamps, results]() {
+                applyProbeResults(chunkIds, chunkPaths, chunkStamps, results);
+            }, Qt::QueuedConnection);
+        });
+    }
+    qDebug() << "Scheduled header probe for" << ids.size() << "images.";
+}
+
+/**
+ * @brief Writes the results of one probe task into the metadata table.
+ *
+ * @param ids The IDs the task was asked to probe.
+ * @param paths The paths that were probed, parallel to `ids`.
+ * @param stamps The stamps of the files when the task was scheduled, parallel to `ids`.
+ * @param results The probed metadata, parallel to `ids`.
+ */
+void ImageLoader::applyProbeResults(const QVector<int>& ids, const QVector<QString>& paths,
+                                    const QVector<FileStamp>& stamps, const QVector<ImageData>& results) {
+    QVector<int> appliedIds;
+    appliedIds.reserve(ids.size());
+    for (int i = 0; i < ids.size(); ++i) {
+        int id = ids.at(i);
+        if (m_imagePaths.value(id) != paths.at(i)) {
+            id = m_imagePaths.indexOf(paths.at(i)); // The index changed while probing
+            if (id < 0) {
+                continue; // File removed in the meantime
+            }
+        }
+        if (!(m_fileStamps.value(paths.at(i)) == stamps.at(i))) {
+            continue; // Modified in the meantime: a newer probe is on its way
+        }
+        m_metadata.setRow(id, results.at(i));
+        appliedIds.append(id);
+    }
+    if (!appliedIds.isEmpty()) {
+        emit metadataProbed(appliedIds);
+    }
+}
+
+/**
+ * @brief Returns the header metadata of an image.
+ *
+ * @param id The ID of the image.
+ * @return The metadata of the image, without pixel data.
+ */
+ImageData ImageLoader::imageMetadata(int id) const {
+    return m_metadata.row(id);
+}
+
+/**
+ * @brief Returns the whole metadata table, indexed by image ID.
+ *
+ * @return A reference to the structure-of-arrays metadata table.
+ */
+const ImageMetadataTable& ImageLoader::metadataTable() const {
+    return m_metadata;
+}
+
+/**
+ * @brief Returns the file currently behind an ID.
+ *
+ * @param id The ID of the image.
+ * @return The absolute path, or an empty string for placeholders and out-of-range IDs.
+ */
+QString ImageLoader::imagePath(int id) const {
+    return m_imagePaths.value(id);
+}
+
+/**
+ * @brief Generates a placeholder image with the given ID and dimensions.
+ *
+ * The image is composed by the PlaceholderRenderer from its shared
+ * background and digit atlas, with the aspect ratio of a full preview.
+ *
+ * @param id The ID of the image for which to generate a placeholder.
+ * @param targetSize The bounding box of the image.
+ * @return A QImage representing the placeholder.
+ */
+QImage ImageLoader::generatePlaceholderImage(int id, const QSize& targetSize) const {
+    const QSize size = m_maxPreviewSize.scaled(targetSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    return m_placeholders->render(id, size);
+}
+
+/**
+ * @brief Returns the total count of images available (real files + potential placeholders).
+ *
+ * This method returns the maximum of either the number of actual image files found
+ * or the maximum configured number of images.
+ *
+ * @return The total number of images that can be accessed via their ID.
+ */
+int ImageLoader::imageCount() const {
+    return qMax(m_imagePaths.size(), m_maxConfiguredImages); // Max of actual files or configured max
+}
+
+/**
+ * @brief Returns true if an ID has no image file and shows a placeholder.
+ *
+ * @param id The image ID.
+ * @return True if `id` is in range and beyond the real image files.
+ */
+bool ImageLoader::isPlaceholder(int id) const {
+    return id >= m_imagePaths.size() && id < imageCount();
+}
+
+/**
+ * @brief Returns the renderer used for placeholder images.
+ *
+ * @return The renderer, owned by the loader.
+ */
+const PlaceholderRenderer* ImageLoader::placeholderRenderer() const {
+    return m_placeholders.data();
+}
+
+/**
+ * @brief Returns the rasterizer used for SVG documents.
+ *
+ * Views showing an SVG file should rasterize it at their own size with
+ * SvgRasterizer::requestRender() rather than scale the preview.
+ *
+ * @return The rasterizer, owned by the loader.
+ */
+SvgRasterizer* ImageLoader::svgRasterizer() const {
+    return m_svg.data();
+}
+
+/**
+ * @brief Asynchronously loads and emits an image.
+ *
+ * This method attempts to load an image by its ID. Placeholders are composed
+ * on the spot and emitted right away, without touching the cache. Otherwise
+ * it first checks the cache. If not found, a job is submitted to the pipeline:
+ * the I/O stage brings the file into memory, the decode stage decodes it and
+ * the scale stage produces the preview. The result is published back on the loader's thread, where the
+ * `imageLoaded` signal is emitted, or `loadingError` if any issue occurs.
+ * A request for an ID that is already in the pipeline is merged with it.
+ *
+ * @param id The ID of the image to load.
+ */
+void ImageLoader::loadImageAsync(int id) {
+    if (id < 0 || id >= imageCount()) {
+        emit loadingError(id, "Image ID out of bounds.");
+        return;
+    }
+    if (isPlaceholder(id)) {
+        // Cheaper to compose again than to keep: placeholders never take cache space
+        emit imageLoaded(id, generatePlaceholderImage(id, m_maxPreviewSize));
+        return;
+    }
+
+    const bool fast = (m_scaleQuality == FastScaling);
+    m_idleUpgradeTimer->start(); // Not idle: postpone background upgrades
+
+    // 1. Check cache first
+    if (m_imageCache && m_imageCache->contains(id)) {
+        qDebug() << "Image with ID" << id << "found in cache.";
+        const QImage cached = m_imageCache->getImage(id);
+        emit imageLoaded(id, cached);
+        if (fast || !isFastScaled(cached)) {
+            return;
+        }
+        // A quick preview is on screen now; the high-quality one follows
+    }
+
+    // 2. Join a job already loading this image, if any
+    QSharedPointer<LoadJob> job = findInFlight(id, m_maxPreviewSize, fast);
+    if (job && job->attachRequester(LoadJob::BroadcastRequester)) {
+        qDebug() << "Image with ID" << id << "is already being loaded.";
+        return;
+    }
+
+    // 3. Otherwise load it from disk
+    job = createJob(id, m_maxPreviewSize, 0, fast);
+    job->attachRequester(LoadJob::BroadcastRequester);
+    submitJob(job);
+}
+
+/**
+ * @brief Sets the filter used for loadImageAsync() and batch loads from now on.
+ *
+ * @param quality The new scaling quality.
+ */
+void ImageLoader::setScaleQuality(ScaleQuality quality) {
+    m_scaleQuality = quality;
+}
+
+/**
+ * @brief Returns the filter used for loadImageAsync() and batch loads.
+ *
+ * @return The current scaling quality.
+ */
+ImageLoader::ScaleQuality ImageLoader::scaleQuality() const {
+    return m_scaleQuality;
+}
+
+/**
+ * @brief Returns true if a preview was scaled with the fast filter.
+ *
+ * @param image The preview.
+ * @return True if it deserves a high-quality re-scale.
+ */
+bool ImageLoader::isFastScaled(const QImage& image) {
+    return !image.text(QUALITY_TEXT_KEY).isEmpty();
+}
+
+/**
+ * @brief Re-scales a few cached low-quality previews in high quality, if the loader is idle.
+ *
+ * Upgrades run at a negative priority, behind any real request, and only
+ * once the pipeline has nothing else in flight, a few at a time.
+ */
+void ImageLoader::upgradeCachedImages() {
+    if (!m_imageCache || m_scaleQuality == FastScaling) {
+        return; // Still flipping through: the next request re-arms the timer
+    }
+    if (!m_inFlight.isEmpty() || !m_overflow.isEmpty()) {
+        m_idleUpgradeTimer->start(); // Busy: try again later
+        return;
+    }
+
+    int started = 0;
+    const QList<int> cachedIds = m_imageCache->ids();
+    for (int id : cachedIds) {
+        if (started == IDLE_UPGRADE_BATCH) {
+            break;
+        }
+        const QString path = m_imagePaths.value(id);
+        if (path.isEmpty() || m_upgradeAttempted.contains(path) || !isFastScaled(m_imageCache->getImage(id))) {
+            continue;
+        }
+        m_upgradeAttempted.insert(path); // Once per low-quality preview: a failed upgrade is not retried
+        QSharedPointer<LoadJob> job = createJob(id, m_maxPreviewSize, -1, false);
+        job->attachRequester(LoadJob::UpgradeRequester);
+        submitJob(job);
+        ++started;
+    }
+    if (started > 0) {
+        qDebug() << "Upgrading" << started << "low-quality previews while idle.";
+    }
+}
+
+/**
+ * @brief Loads a contiguous range of images as one batch.
+ *
+ * @param first The first ID of the range.
+ * @param last The last ID of the range, inclusive.
+ * @param size The bounding box of the images; invalid for the maximum preview size.
+ */
+void ImageLoader::loadRange(int first, int last, const QSize& size) {
+    first = qMax(0, first);
+    last = qMin(last, imageCount() - 1);
+    QVector<int> ids;
+    ids.reserve(qMax(0, last - first + 1));
+    for (int id = first; id <= last; ++id) {
+        ids.append(id);
+    }
+    loadImages(ids, size);
+}
+
+/**
+ * @brief Loads an arbitrary set of images as one batch.
+ *
+ * Cache hits are queued for the next emission right away; the other IDs are
+ * submitted to the pipeline back to back, so they enter it as one group.
+ *
+ * @param ids The IDs to load, most urgent first.
+ * @param size The bounding box of the images; invalid for the maximum preview size.
+ */
+void ImageLoader::loadImages(const QVector<int>& ids, const QSize& size) {
+    const QSize targetSize = size.isValid() ? size : m_maxPreviewSize;
+    const bool previewSized = (targetSize == m_maxPreviewSize);
+    const bool fast = (m_scaleQuality == FastScaling);
+    m_idleUpgradeTimer->start(); // Not idle: postpone background upgrades
+    for (int id : ids) {
+        if (id < 0 || id >= imageCount()) {
+            continue;
+        }
+        if (isPlaceholder(id)) {
+            appendBatchResult(id, generatePlaceholderImage(id, targetSize));
+            continue;
+        }
+        if (previewSized && m_imageCache && m_imageCache->contains(id)) {
+            appendBatchResult(id, m_imageCache->getImage(id));
+            continue; // Low-quality previews are upgraded by the idle timer
+        }
+        QSharedPointer<LoadJob> job = findInFlight(id, targetSize, fast);
+        if (job && job->attachRequester(LoadJob::BatchRequester)) {
+            continue;
+        }
+        job = createJob(id, targetSize, 0, fast);
+        job->attachRequester(LoadJob::BatchRequester);
+        submitJob(job);
+    }
+}
+
+/**
+ * @brief Queues a batch result for the next `imagesLoaded` emission.
+ *
+ * @param id The image ID.
+ * @param image The loaded image.
+ */
+void ImageLoader::appendBatchResult(int id, const QImage& image) {
+    m_batchResults.append(qMakePair(id, image));
+    if (!m_batchTimer->isActive()) {
+        m_batchTimer->start();
+    }
+}
+
+/**
+ * @brief Emits `imagesLoaded` with the batch results collected since the last frame.
+ */
+void ImageLoader::flushBatchResults() {
+    if (m_batchResults.isEmpty()) {
+        return;
+    }
+    QVector<QPair<int, QImage>> results;
+    results.swap(m_batchResults);
+    emit imagesLoaded(results);
+}
+
+/**
+ * @brief Requests an image and returns a future for it.
+ *
+ * @param id The ID of the image to load.
+ * @param size The bounding box of the image; invalid for the maximum preview size.
+ * @param priority Requests with a higher priority are scheduled first.
+ * @return A future receiving the image.
+ */
+QFuture<QImage> ImageLoader::requestImage(int id, const QSize& size, int priority) {
+    auto promise = std::make_shared<QPromise<QImage>>();
+    QFuture<QImage> future = promise->future();
+    promise->start();
+
+    if (id < 0 || id >= imageCount()) {
+        future.cancel();
+        promise->finish();
+        return future;
+    }
+
+    const QSize targetSize = size.isValid() ? size : m_maxPreviewSize;
+    if (isPlaceholder(id)) {
+        promise->addResult(generatePlaceholderImage(id, targetSize));
+        promise->finish();
+        return future;
+    }
+    const bool previewSized = (targetSize == m_maxPreviewSize);
+    if (previewSized && m_imageCache && m_imageCache->contains(id) && !isFastScaled(m_imageCache->getImage(id))) {
+        promise->addResult(m_imageCache->getImage(id));
+        promise->finish();
+        return future;
+    }
+
+    QSharedPointer<LoadJob> job = findInFlight(id, targetSize, false);
+    if (job && job->attachPromise(promise)) {
+        return future;
+    }
+    job = createJob(id, targetSize, priority, false);
+    job->attachPromise(promise);
+    submitJob(job);
+    return future;
+}
+
+/**
+ * @brief Returns the in-flight job producing the given ID at the given size, if any.
+ *
+ * @param id The image ID.
+ * @param targetSize The bounding box of the requested image.
+ * @param acceptFast True if a job scaling with the fast filter will do.
+ * @return The job, or a null pointer if a new one must be created.
+ */
+QSharedPointer<LoadJob> ImageLoader::findInFlight(int id, const QSize& targetSize, bool acceptFast) const {
+    const QString imagePath = m_imagePaths.value(id);
+    for (auto it = m_inFlight.constFind(id); it != m_inFlight.cend() && it.key() == id; ++it) {
+        const QSharedPointer<LoadJob>& job = it.value();
+        if (job->path == imagePath && job->targetSize == targetSize && (acceptFast || !job->fastScale)) {
+            return job;
+        }
+    }
+    return QSharedPointer<LoadJob>();
+}
+
+/**
+ * @brief Creates a job for the current file of an ID and registers it as in flight.
+ *
+ * @param id The image ID.
+ * @param targetSize The bounding box of the image to produce.
+ * @param priority The queue priority of the job.
+ * @param fastScale True to scale with the fast filter.
+ * @return The new job.
+ */
+QSharedPointer<LoadJob> ImageLoader::createJob(int id, const QSize& targetSize, int priority, bool fastScale) {
+    // The path and metadata are captured now: the index may change while the job runs.
+    // An empty path means the ID is a placeholder.
+    auto job = QSharedPointer<LoadJob>::create();
+    job->id = id;
+    job->path = m_imagePaths.value(id);
+    job->metadata = m_metadata.row(id);
+    job->targetSize = targetSize;
+    job->priority = priority;
+    job->fastScale = fastScale;
+    m_inFlight.insert(id, job);
+    return job;
+}
+
+/**
+ * @brief Creates the pipeline workers for `m_pipelineConfig`.
+ *
+ * Defaulted thread counts are resolved here and written back, so that
+ * pipelineConfig() reports what is actually running.
+ */
+void ImageLoader::startPipeline() {
+    const int cores = qMax(1, QThread::idealThreadCount());
+    if (m_pipelineConfig.ioThreads <= 0) {
+        m_pipelineConfig.ioThreads = 2;
+    }
+    if (m_pipelineConfig.decodeThreads <= 0) {
+        m_pipelineConfig.decodeThreads = cores;
+    }
+    if (m_pipelineConfig.scaleThreads <= 0) {
+        m_pipelineConfig.scaleThreads = qMax(1, cores / 2);
+    }
+
+    m_pipeline->setStageFunction(LoadPipeline::IoStage, [this](const LoadJobPtr& job) { runIoStage(job); return true; });
+    m_pipeline->setStageFunction(LoadPipeline::DecodeStage, [this](const LoadJobPtr& job) { return runDecodeStage(job); });
+    m_pipeline->setStageFunction(LoadPipeline::ScaleStage, [this](const LoadJobPtr& job) { runScaleStage(job); return true; });
+    m_pipeline->setPublishFunction([this](const LoadJobPtr& job) {
+        if (!pushCompletion(LoadCompletion{ job, QImage() })) {
+            // Ring full: fall back to a queued call rather than stall the worker
+            m_publishPending.fetchAndAddRelaxed(1);
+            QMetaObject::invokeMethod(this, [this, job]() {
+                m_publishPending.fetchAndAddRelaxed(-1);
+                publishJob(job);
+                emit frameDelivered(1);
+            }, Qt::QueuedConnection);
+        }
+    });
+
+    m_pipeline->start({ m_pipelineConfig.ioThreads, m_pipelineConfig.decodeThreads, m_pipelineConfig.scaleThreads },
+                      { m_pipelineConfig.ioQueueCapacity, m_pipelineConfig.decodeQueueCapacity,
+                        m_pipelineConfig.scaleQueueCapacity });
+}
+
+/**
+ * @brief Pushes an entry into the completion ring and makes sure a drain is scheduled.
+ *
+ * @param completion The entry to push.
+ * @return True if pushed, false if the ring is full.
+ */
+bool ImageLoader::pushCompletion(const LoadCompletion& completion) {
+    if (!m_completions->tryPush(completion)) {
+        return false;
+    }
+    // Only the first completion after an idle period posts an event, to start the frame timer
+    if (m_drainScheduled.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, [this]() {
+            m_frameTimer->start();
+            drainCompletions(); // Deliver the first result without waiting for a frame
+        }, Qt::QueuedConnection);
+    }
+    return true;
+}
+
+/**
+ * @brief Publishes completed jobs from the completion ring, within the per-frame time budget.
+ *
+ * Whatever does not fit in this frame's budget stays in the ring for the
+ * next tick of the frame timer, so a burst of prefetch completions never
+ * holds the event loop for more than a fraction of a frame.
+ */
+void ImageLoader::drainCompletions() {
+    QElapsedTimer elapsed;
+    elapsed.start();
+    int delivered = 0;
+    LoadCompletion completion;
+    while (elapsed.nsecsElapsed() < FRAME_DRAIN_BUDGET_NS && m_completions->tryPop(&completion)) {
+        if (completion.draft.isNull()) {
+            publishJob(completion.job);
+        } else {
+            publishDraft(completion.job, completion.draft);
+        }
+        completion = LoadCompletion();
+        ++delivered;
+    }
+    if (delivered > 0) {
+        emit frameDelivered(delivered);
+    }
+
+    if (m_completions->size() == 0) {
+        m_frameTimer->stop();
+        m_drainScheduled.storeRelease(0);
+        // A worker may have pushed after the size check but before the reset,
+        // while its own wake-up was suppressed: keep draining in that case
+        if (m_completions->size() > 0 && m_drainScheduled.testAndSetOrdered(0, 1)) {
+            m_frameTimer->start();
+        }
+    }
+}
+
+/**
+ * @brief Hands a job to the I/O stage, or parks it if the I/O queue is full.
+ *
+ * @param job The job to submit.
+ */
+void ImageLoader::submitJob(const QSharedPointer<LoadJob>& job) {
+    // Keep submission order: once something is parked, later jobs queue up behind it
+    if (m_overflow.isEmpty() && m_pipeline->tryPush(job)) {
+        return;
+    }
+    qsizetype position = m_overflow.size();
+    while (position > 0 && m_overflow.at(position - 1)->priority < job->priority) {
+        --position;
+    }
+    m_overflow.insert(position, job);
+}
+
+/**
+ * @brief Moves parked jobs into the I/O queue while it has room.
+ */
+void ImageLoader::drainOverflow() {
+    while (!m_overflow.isEmpty() && m_pipeline->tryPush(m_overflow.head())) {
+        m_overflow.dequeue();
+    }
+}
+
+/**
+ * @brief I/O stage: brings the encoded bytes of the file into memory.
+ *
+ * Images not probed yet are sniffed here, so an SVG document is handed to
+ * the rasterizer whatever its name.
+ *
+ * @param job The job to process.
+ */
+void ImageLoader::runIoStage(const QSharedPointer<LoadJob>& job) const {
+    if (job->path.isEmpty() || job->isCancelled()) {
+        return; // Placeholder, or nobody wants it any more: nothing to read
+    }
+
+    if (SvgRasterizer::isSvgFormat(job->metadata.format)) {
+        return; // Parsed once by the rasterizer, which keeps the document
+    }
+
+    if (RawPreviewExtractor::isRawFile(job->path)) {
+        // Read only the embedded JPEG: the decode stage then handles it like any JPEG file
+        RawPreviewExtractor::Preview preview;
+        job->encoded = RawPreviewExtractor::read(job->path, &preview);
+        if (!job->metadata.probed && preview.isValid()) {
+            job->metadata.size = preview.size;
+            job->metadata.format = "jpeg";
+            job->metadata.pixelFormat = preview.grayscale ? QImage::Format_Grayscale8 : QImage::Format_RGB32;
+            job->metadata.transformation = static_cast<quint8>(int(preview.orientation));
+            job->metadata.probed = true;
+        }
+        return;
+    }
+
+    job->encoded = m_readahead->bytes(job->path);
+    if (!job->encoded.isNull()) {
+        // Prefetched earlier, already in memory
+        if (!job->metadata.probed) {
+            job->metadata.format = FormatSniffer::sniff(job->encoded); // Not probed yet: go by content, not by name
+        }
+        if (SvgRasterizer::isSvgFormat(job->metadata.format)) {
+            job->encoded.clear(); // Left to the rasterizer
+        }
+        return;
+    }
+
+    // Map the file rather than letting the decoder open and buffer it itself,
+    // and fault the pages in now so the decode stage never waits for the disk.
+    auto device = QSharedPointer<MappedFileDevice>::create(job->path);
+    if (!device->open(QIODevice::ReadOnly)) {
+        qDebug() << "Could not open" << job->path << ":" << device->errorString();
+        return;
+    }
+    // Large originals are only read once: let them leave the page cache as
+    // soon as the decode stage closes the mapping
+    const qint64 bypassThreshold = m_pageCacheBypassThreshold.loadRelaxed();
+    device->setDropCacheOnClose(bypassThreshold > 0 && device->size() >= bypassThreshold);
+    device->prefault();
+    if (!job->metadata.probed) {
+        job->metadata.format = FormatSniffer::sniff(device->data(), device->size()); // Not probed yet: go by content, not by name
+        if (SvgRasterizer::isSvgFormat(job->metadata.format)) {
+            return; // Left to the rasterizer
+        }
+    }
+    job->mapped = device;
+}
+
+/**
+ * @brief Decode stage: decodes the pixels under the memory budget.
+ *
+ * The peak footprint is predicted from the header as the full-resolution
+ * image plus the scaled preview, both of which are alive while scaling.
+ * If that does not fit in the whole budget, the decoder is asked for the
+ * preview resolution directly (JPEG, for instance, then decodes with DCT
+ * scaling and never materialises the full image); formats that cannot do
+ * this are rejected. Qt's decoder is held to the same rules against Qt's own
+ * allocation limit, which is left as configured. When the reservation does
+ * not fit in what is left of the budget the job is parked, and the worker
+ * moves on to the next job instead of waiting: the job is requeued as soon
+ * as another decode releases its memory.
+ *
+ * The decoder is picked by the file's magic bytes from the
+ * ImageDecoderRegistry: a native codec when this build has one for the
+ * format, Qt's image plugins otherwise.
+ *
+ * @param job The job to process.
+ */
+bool ImageLoader::runDecodeStage(const QSharedPointer<LoadJob>& job) {
+    if (job->isCancelled()) {
+        job->mapped.reset();
+        job->encoded.clear();
+        return true;
+    }
+    if (job->path.isEmpty()) {
+        // ID is beyond the number of actual images found, generate placeholder
+        job->image = generatePlaceholderImage(job->id, job->targetSize);
+        return true;
+    }
+    if (SvgRasterizer::isSvgFormat(job->metadata.format)) {
+        // Vector: draw straight at the preview size rather than at a default size, then scale
+        const QSize rasterSize = m_svg->fittedSize(job->path, job->targetSize);
+        if (rasterSize.isValid()) {
+            if (!reserveDecodeMemory(job, MemoryBudget::estimateImageBytes(rasterSize, QImage::Format_ARGB32_Premultiplied))) {
+                return false; // Parked until memory is released
+            }
+            job->decoded = m_svg->render(job->path, rasterSize);
+        }
+        return true;
+    }
+
+    if (job->mapped.isNull() && job->encoded.isNull()) {
+        return true; // The I/O stage could not read the file
+    }
+    if (job->mapped && !job->mapped->ensureIntact()) {
+        qDebug() << "Decoding the shorter contents of" << job->path << "after it was truncated.";
+    }
+    const ImageDecoder::Input input = encodedInput(*job);
+    const bool truncated = looksTruncated(input.format, input.data, input.size);
+    if (!job->metadata.probed) {
+        // Not probed yet: take the EXIF orientation from Qt's plugin, which parses it for every format
+        QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char*>(input.data), qsizetype(input.size));
+        QBuffer buffer(&bytes);
+        if (buffer.open(QIODevice::ReadOnly)) {
+            job->metadata.transformation = static_cast<quint8>(int(QImageReader(&buffer, input.format).transformation()));
+        }
+    }
+
+    // Pick the backend by magic bytes; its header tells what it will produce
+    ImageDecoderRegistry* registry = ImageDecoderRegistry::instance();
+    if (!registry) {
+        job->mapped.reset(); // Exiting
+        job->encoded.clear();
+        return true;
+    }
+    ImageDecoder::Header header;
+    const ImageDecoder* decoder = registry->decoderFor(input, &header);
+
+    // Show something right away for large images, then take the time for the full decode
+    postDraft(job, decoder);
+
+    {
+        const QImageIOHandler::Transformations orientation = orientationOf(job->metadata);
+        const QSize fullSize = header.size;
+        const QImage::Format pixelFormat = header.pixelFormat;
+        // The preview fits the target box once oriented; decoders want it in decoded orientation
+        const QSize previewSize = fullSize.isValid()
+                                      ? orientedSize(orientedSize(fullSize, orientation).scaled(job->targetSize, Qt::KeepAspectRatio),
+                                                     orientation)
+                                      : job->targetSize;
+        const qint64 previewBytes = MemoryBudget::estimateImageBytes(previewSize, QImage::Format_ARGB32);
+        QSize decodeSize = fullSize;
+        qint64 peakBytes = MemoryBudget::estimateImageBytes(fullSize, pixelFormat) + previewBytes;
+
+        // Qt's plugins refuse images above their own allocation limit (in MiB, 0 for none)
+        qint64 limit = m_decodeBudget->limit();
+        if (decoder == registry->fallback() && QImageReader::allocationLimit() > 0) {
+            limit = qMin(limit, qint64(QImageReader::allocationLimit()) * 1024 * 1024 + previewBytes);
+        }
+        if (peakBytes > limit) {
+            if (!fullSize.isValid() || !decoder->supportsScaledDecode(input)) {
+                qDebug() << "Rejected decode of" << job->path << ": predicted" << peakBytes
+                         << "bytes exceed the memory budget and the format has no reduced-resolution path.";
+                job->mapped.reset(); // Nothing will decode these bytes: do not hold them until publishing
+                job->encoded.clear();
+                return true;
+            }
+            decodeSize = decoder->scaledDecodeSize(fullSize, previewSize);
+            peakBytes = MemoryBudget::estimateImageBytes(decodeSize, pixelFormat) + previewBytes;
+            qDebug() << "Decoding" << job->path << "at reduced resolution" << decodeSize << "to stay within the memory budget.";
+        } else if (job->fastScale && fullSize.isValid() && previewSize != fullSize
+                   && decoder->supportsScaledDecode(input)) {
+            // Fast navigation: let the decoder skip the detail nobody will notice (JPEG DCT scaling)
+            decodeSize = decoder->scaledDecodeSize(fullSize, previewSize);
+            peakBytes = MemoryBudget::estimateImageBytes(decodeSize, pixelFormat) + previewBytes;
+        }
+
+        if (needsNormalization(pixelFormat)) {
+            // Held together with the decoded buffer while normalizing its format
+            peakBytes += MemoryBudget::estimateImageBytes(decodeSize, QImage::Format_ARGB32);
+        }
+
+        if (!reserveDecodeMemory(job, peakBytes)) {
+            return false; // Parked until memory is released; the worker moves on to other jobs
+        }
+
+        // Decode straight into a pooled buffer. Decoders reuse the image they are
+        // given when its size and format match what they are about to produce,
+        // which the header told us; otherwise they allocate as usual.
+        qDebug() << "Decoding image from disk:" << job->path << "for ID:" << job->id << "with" << decoder->name();
+        QImage decoded = createPooledImage(decodeSize, pixelFormat);
+        if (truncated && !decoded.isNull()) {
+            decoded.fill(Qt::gray); // Pooled memory is not cleared: give the missing part a neutral colour
+        }
+        if (decoder->decode(input, decodeSize, &decoded)) {
+            job->decoded = decoded; // Truncated JPEGs land here too, with the missing scans left blank
+        } else if (truncated && !decoded.isNull() && decoded.size() == decodeSize) {
+            // Row-by-row decoders (PNG, GIF) have written everything up to the cut:
+            // show that rather than a placeholder. The file watcher reloads it once complete.
+            qDebug() << "Showing partial content of truncated file" << job->path;
+            job->decoded = decoded;
+        } else {
+            qDebug() << "Decoder error for" << job->path;
+        }
+    }
+    // Convert once here, so that scaling, the cache and painting only ever see fast-blit formats
+    job->decoded = normalizePixelFormat(std::move(job->decoded));
+    job->mapped.reset(); // The encoded bytes are no longer needed
+    job->encoded.clear();
+    return true;
+}
+
+/**
+ * @brief Reserves decode memory for a job, or parks the job until memory is released.
+ *
+ * Checking the budget and parking happen under one lock with
+ * releaseDecodeMemory(), so a release cannot slip in between and leave the
+ * job parked with nothing left to wake it.
+ *
+ * @param job The job about to decode.
+ * @param bytes The predicted peak footprint.
+ * @return True if reserved (stored in the job); false if the job was parked.
+ */
+bool ImageLoader::reserveDecodeMemory(const QSharedPointer<LoadJob>& job, qint64 bytes) {
+    QMutexLocker locker(&m_awaitingMemoryMutex);
+    const qint64 reserved = m_decodeBudget->tryAcquire(bytes);
+    if (reserved < 0) {
+        m_awaitingMemory.append(job);
+        return false;
+    }
+    job->reservedBytes = reserved;
+    return true;
+}
+
+/**
+ * @brief Reserves decode memory for a decode outside the pipeline, blocking until it is available.
+ *
+ * @param bytes The predicted peak footprint.
+ * @return The number of bytes reserved; pass it to releaseDecodeMemory().
+ *         -1 if the pipeline is being stopped; nothing is reserved then.
+ */
+qint64 ImageLoader::acquireDecodeMemory(qint64 bytes) {
+    return m_decodeBudget->acquire(bytes);
+}
+
+/**
+ * @brief Returns a decode memory reservation and requeues the jobs parked for memory.
+ *
+ * Jobs that do not fit in the decode queue right now stay parked until the
+ * next release; the jobs filling the queue will release memory themselves.
+ *
+ * @param bytes The reservation to return, or 0 to only requeue.
+ */
+void ImageLoader::releaseDecodeMemory(qint64 bytes) const {
+    QVector<LoadJobPtr> parked;
+    {
+        QMutexLocker locker(&m_awaitingMemoryMutex);
+        m_decodeBudget->release(bytes);
+        parked.swap(m_awaitingMemory);
+    }
+    QVector<LoadJobPtr> stillParked;
+    for (const LoadJobPtr& job : std::as_const(parked)) {
+        if (!m_pipeline->requeue(LoadPipeline::DecodeStage, job)) {
+            stillParked.append(job);
+        }
+    }
+    if (!stillParked.isEmpty()) {
+        QMutexLocker locker(&m_awaitingMemoryMutex);
+        m_awaitingMemory += stillParked;
+    }
+}
+
+/**
+ * @brief Decodes and posts a 1/8-scale draft of a large image, if its decoder can.
+ *
+ * The draft is small (1/64 of the full pixels) and is not counted against
+ * the decode memory budget.
+ *
+ * @param job The job being decoded.
+ * @param decoder The decoder picked for the job's encoded bytes.
+ */
+void ImageLoader::postDraft(const QSharedPointer<LoadJob>& job, const ImageDecoder* decoder) {
+    const ImageData& metadata = job->metadata;
+    if (job->draftPosted || job->fastScale || !metadata.probed || !job->hasRequester(LoadJob::BroadcastRequester)) {
+        return; // Futures and batches only want the final image; fast jobs are drafts already
+    }
+    const QSize fullSize = metadata.size;
+    const qint64 fullArea = qint64(fullSize.width()) * fullSize.height();
+    const qint64 previewArea = qint64(job->targetSize.width()) * job->targetSize.height();
+    if (fullArea < DRAFT_MIN_AREA_RATIO * previewArea) {
+        return; // Small enough that the full decode is quick anyway
+    }
+
+    const ImageDecoder::Input input = encodedInput(*job);
+    if (!decoder->cheapScaledDecode(input)) {
+        return; // Would decode every pixel anyway: the draft would only double the work
+    }
+    const QSize draftSize((fullSize.width() + DRAFT_SCALE_DIVISOR - 1) / DRAFT_SCALE_DIVISOR,
+                          (fullSize.height() + DRAFT_SCALE_DIVISOR - 1) / DRAFT_SCALE_DIVISOR);
+    QImage draft;
+    if (!decoder->decode(input, decoder->scaledDecodeSize(fullSize, draftSize), &draft)) {
+        return;
+    }
+    draft = normalizePixelFormat(std::move(draft));
+    if (draft.isNull()) {
+        return;
+    }
+    const QImageIOHandler::Transformations orientation = orientationOf(metadata);
+    QSize draftTargetSize = orientedSize(draft.size(), orientation);
+    if (draftTargetSize.width() > job->targetSize.width() || draftTargetSize.height() > job->targetSize.height()) {
+        draftTargetSize = draftTargetSize.scaled(job->targetSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    }
+    if (draftTargetSize != draft.size() || orientation != QImageIOHandler::TransformationNone) {
+        draft = scaleIntoPooledImage(draft, draftTargetSize, true, orientation);
+    }
+    job->draftPosted = pushCompletion(LoadCompletion{ job, draft }); // If the ring is full, just skip the draft
+}
+
+/**
+ * @brief Scale stage: produces the preview and releases the decode memory.
+ *
+ * @param job The job to process.
+ */
+void ImageLoader::runScaleStage(const QSharedPointer<LoadJob>& job) const {
+    if (!job->decoded.isNull() && !job->isCancelled()) {
+        // 3. Scale the image to the requested size, again into a pooled buffer, and orient it
+        const QImageIOHandler::Transformations orientation = orientationOf(job->metadata);
+        const QSize targetSize = orientedSize(job->decoded.size(), orientation)
+                                     .scaled(job->targetSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+        if (targetSize == job->decoded.size() && orientation == QImageIOHandler::TransformationNone
+            && !needsNormalization(job->decoded.format())) {
+            // Decoded at the preview size already (SVG, DCT-scaled JPEG): no filter was
+            // applied, so there is nothing to upgrade and the shared image is left untagged
+            job->image = job->decoded;
+        } else {
+            job->image = scaleIntoPooledImage(job->decoded, targetSize, job->fastScale, orientation);
+            if (job->fastScale && !job->image.isNull()) {
+                job->image.setText(QUALITY_TEXT_KEY, QStringLiteral("fast")); // Not shared yet: no copy
+            }
+        }
+    }
+    job->decoded = QImage(); // Hand the full-resolution buffer back to the pool before releasing the budget
+    if (job->reservedBytes > 0) {
+        releaseDecodeMemory(job->reservedBytes);
+        job->reservedBytes = 0;
+    }
+
+    if (job->image.isNull() && !job->isCancelled()) {
+        qDebug() << "Failed to load image from file:" << job->path << ". Generating placeholder.";
+        job->image = generatePlaceholderImage(job->id, job->targetSize); // Fallback to placeholder on failure
+    }
+}
+
+/**
+ * @brief Publish stage: inserts the finished image in the cache and emits `imageLoaded`.
+ *
+ * @param job The finished job.
+ */
+void ImageLoader::publishJob(const QSharedPointer<LoadJob>& job) {
+    m_inFlight.remove(job->id, job);
+    drainOverflow();
+
+    if (job->isCancelled()) {
+        qDebug() << "Load of ID" << job->id << "was cancelled by every requester.";
+        return;
+    }
+    if (m_imagePaths.value(job->id) != job->path) {
+        // The index changed while loading; the imageInserted/imageRemoved signals
+        // already told the views to request the new contents of this ID.
+        qDebug() << "Discarding stale load result for ID" << job->id;
+        job->cancelRequests();
+        return;
+    }
+    if (job->image.isNull()) {
+        // This should ideally not happen if generatePlaceholderImage works as expected
+        job->cancelRequests();
+        if (job->hasRequester(LoadJob::BroadcastRequester) || job->hasRequester(LoadJob::BatchRequester)) {
+            emit loadingError(job->id, "Failed to load or generate image.");
+        }
+        return;
+    }
+    // 4. Add to cache if loading was successful and the image is a regular preview
+    if (m_imageCache && job->targetSize == m_maxPreviewSize) {
+        m_imageCache->setImage(job->id, job->image);
+        if (isFastScaled(job->image)) {
+            m_upgradeAttempted.remove(job->path); // A new low-quality preview deserves its own upgrade
+        }
+    }
+    if (!job->path.isEmpty()) {
+        watchLoadedFile(job->path);
+    }
+    job->fulfil(job->image); // Only the requesters of this job see requestImage() results
+    if (job->hasRequester(LoadJob::BatchRequester)) {
+        appendBatchResult(job->id, job->image);
+    }
+    if (job->hasRequester(LoadJob::BroadcastRequester) || job->hasRequester(LoadJob::UpgradeRequester)) {
+        emit imageLoaded(job->id, job->image); // Emit signal with the loaded/generated image
+    }
+    if (job->hasRequester(LoadJob::UpgradeRequester)) {
+        m_idleUpgradeTimer->start(); // Carry on with the next few, unless requests come in
+    }
+}
+
+/**
+ * @brief Emits `imageDraftLoaded` for a job still in progress, unless it went stale.
+ *
+ * @param job The job the draft belongs to.
+ * @param draft The draft image.
+ */
+void ImageLoader::publishDraft(const QSharedPointer<LoadJob>& job, const QImage& draft) {
+    if (job->isCancelled() || m_imagePaths.value(job->id) != job->path) {
+        return;
+    }
+    if (m_imageCache && job->targetSize == m_maxPreviewSize && m_imageCache->contains(job->id)) {
+        return; // The refined image is already available
+    }
+    emit imageDraftLoaded(job->id, draft);
+}
+
+/**
+ * @brief Changes the thread counts and queue capacities of the pipeline stages.
+ *
+ * @param config The new configuration.
+ */
+void ImageLoader::setPipelineConfig(const LoaderPipelineConfig& config) {
+    m_decodeBudget->interrupt();
+    QVector<LoadJobPtr> unfinished = m_pipeline->stop();
+    m_decodeBudget->resume();
+    {
+        QMutexLocker locker(&m_awaitingMemoryMutex);
+        unfinished += m_awaitingMemory; // Parked jobs hold no reservation
+        m_awaitingMemory.clear();
+    }
+
+    m_pipelineConfig = config;
+    startPipeline();
+
+    // Restart the interrupted jobs from scratch, ahead of the parked ones
+    QQueue<QSharedPointer<LoadJob>> parked;
+    parked.swap(m_overflow);
+    for (const LoadJobPtr& job : unfinished) {
+        if (job->reservedBytes > 0) {
+            m_decodeBudget->release(job->reservedBytes);
+        }
+        // Same job object, so its requesters and in-flight entry stay valid
+        job->encoded.clear();
+        job->mapped.reset();
+        job->decoded = QImage();
+        job->reservedBytes = 0;
+        job->image = QImage();
+        job->draftPosted = false;
+        submitJob(job);
+    }
+    for (const LoadJobPtr& job : std::as_const(parked)) {
+        submitJob(job);
+    }
+}
+
+/**
+ * @brief Returns the current configuration of the pipeline stages.
+ *
+ * @return The configuration, with defaulted thread counts resolved.
+ */
+LoaderPipelineConfig ImageLoader::pipelineConfig() const {
+    return m_pipelineConfig;
+}
+
+/**
+ * @brief Returns the current queue depths of the pipeline stages.
+ *
+ * @return A snapshot of the pipeline queues.
+ */
+LoaderPipelineStats ImageLoader::pipelineStats() const {
+    LoaderPipelineStats stats;
+    stats.ioQueueDepth = m_pipeline->queueDepth(LoadPipeline::IoStage);
+    stats.decodeQueueDepth = m_pipeline->queueDepth(LoadPipeline::DecodeStage);
+    stats.scaleQueueDepth = m_pipeline->queueDepth(LoadPipeline::ScaleStage);
+    stats.publishQueueDepth = m_completions->size() + m_publishPending.loadRelaxed();
+    stats.overflowDepth = int(m_overflow.size());
+    stats.decodeBytesInFlight = m_decodeBudget->inFlight();
+    return stats;
+}
+
+/**
+ * @brief Sets the global budget for memory held by in-flight decodes.
+ *
+ * Qt's allocation limit is process-wide and belongs to the application:
+ * it is not changed here. Decodes through Qt's plugins are checked against
+ * the lower of the two limits instead.
+ *
+ * @param bytes The budget in bytes.
+ */
+void ImageLoader::setDecodeMemoryBudget(qint64 bytes) {
+    m_decodeBudget->setLimit(bytes);
+    releaseDecodeMemory(0); // A larger budget may admit parked jobs
+    qDebug() << "Decode memory budget set to" << bytes << "bytes.";
+}
+
+/**
+ * @brief Returns the global budget for memory held by in-flight decodes.
+ *
+ * @return The budget in bytes.
+ */
+qint64 ImageLoader::decodeMemoryBudget() const {
+    return m_decodeBudget->limit();
+}
+
+/**
+ * @brief Prefetches the encoded bytes of the given images into RAM, without decoding them.
+ *
+ * @param ids The IDs to prefetch, most urgent first. Placeholder IDs are ignored.
+ */
+void ImageLoader::prefetchEncoded(const QVector<int>& ids) {
+    QStringList paths;
+    paths.reserve(ids.size());
+    for (int id : ids) {
+        if (id < 0 || id >= m_imagePaths.size()) {
+            continue;
+        }
+        if (m_imageCache && m_imageCache->contains(id)) {
+            continue; // Already decoded, the bytes would never be used
+        }
+        if (RawPreviewExtractor::isRawFile(m_imagePaths.at(id))) {
+            continue; // Only the embedded preview is read, by the I/O stage: never the whole file
+        }
+        paths.append(m_imagePaths.at(id));
+    }
+    m_readahead->prefetch(paths);
+}
+
+/**
+ * @brief Sets how many bytes of encoded files the readahead buffer may hold.
+ *
+ * @param bytes The capacity in bytes.
+ */
+void ImageLoader::setReadaheadCapacity(qint64 bytes) {
+    m_readahead->setCapacity(bytes);
+}
+
+/**
+ * @brief Sets the file size from which originals bypass the page cache.
+ *
+ * @param bytes The threshold in bytes; 0 disables bypassing.
+ */
+void ImageLoader::setPageCacheBypassThreshold(qint64 bytes) {
+    m_pageCacheBypassThreshold.storeRelaxed(qMax<qint64>(0, bytes));
+    m_readahead->setDropCacheThreshold(qMax<qint64>(0, bytes));
+}
+
+/**
+ * @brief Returns the file size from which originals bypass the page cache.
+ *
+ * @return The threshold in bytes; 0 if bypassing is disabled.
+ */
+qint64 ImageLoader::pageCacheBypassThreshold() const {
+    return m_pageCacheBypassThreshold.loadRelaxed();
 }
@@ -0,0 +1,175 @@
+/**
+ * @file loadjob.h
+ * @brief Declaration of the LoadJob structure, the unit of work of the ImageLoader pipeline.
+ *
+ * A LoadJob is created on the loader's thread for every image that is not in
+ * the cache, travels through the I/O, decode and scale stages, and is
+ * published back on the loader's thread. Each stage fills in the fields the
+ * next one needs and clears the ones that are no longer used.
+ *
+ * A job is wanted by the `imageLoaded` broadcast, by a loadRange() batch,
+ * by one or more requestImage() futures, or any combination. Once nobody
+ * wants it any more (every future cancelled and no signal requester) it is
+ * cancelled for good and the remaining stages skip their work.
+ */
+#ifndef IMAGELOADERLIB_LOADJOB_H
+#define IMAGELOADERLIB_LOADJOB_H
+
+#include "imageloader.h"      // For ImageData
+#include "mappedfiledevice.h" // For the mapped input
+
+#include <QByteArray>     // For prefetched encoded bytes
+#include <QImage>         // For the decoded and scaled pixels
+#include <QMutex>         // For guarding the requesters
+#include <QMutexLocker>   // For scoped locking
+#include <QPromise>       // For requestImage() futures
+#include <QSharedPointer> // For sharing the job and its input between stages
+#include <QSize>          // For the target size
+#include <QString>        // For the file path
+#include <QVector>        // For the list of requesters
+
+#include <memory>         // For std::shared_ptr
+
+/**
+ * @brief State of one image load as it moves through the pipeline stages.
+ */
+struct LoadJob {
+    /**
+     * @brief Signal-based requesters of a job; futures are tracked separately.
+     */
+    enum Requester {
+        BroadcastRequester = 0x1, ///< loadImageAsync(): emit `imageLoaded`.
+        BatchRequester = 0x2,     ///< loadRange()/loadImages(): deliver through `imagesLoaded`.
+        UpgradeRequester = 0x4    ///< Idle re-scale of a cached low-quality preview.
+    };
+
+    int id = -1;                                 ///< Requested image ID.
+    QString path;                                ///< File to load; empty for placeholder IDs.
+    ImageData metadata;                          ///< Probed header metadata, if available.
+    QSize targetSize;                            ///< Bounding box of the image to produce.
+    int priority = 0;                            ///< Queue priority; higher is served first.
+    bool fastScale = false;                      ///< Scale with a cheap filter (fast navigation).
+
+    // Output of the I/O stage
+    QByteArray encoded;                          ///< Encoded bytes taken from the readahead buffer.
+    QSharedPointer<MappedFileDevice> mapped;     ///< Mapped, prefaulted file when not prefetched.
+
+    // Output of the decode stage
+    QImage decoded;                              ///< Full (or reduced) resolution pixels.
+    qint64 reservedBytes = 0;                    ///< Memory budget held until the scale stage is done.
+
+    bool draftPosted = false;                    ///< True once a draft has been handed to the loader.
+
+    // Output of the scale stage
+    QImage image;                                ///< The finished, preview-sized image.
+
+    /**
+     * @brief Adds a future waiting for this job, unless the job is already cancelled.
+     * @param promise The promise behind the requester's future.
+     * @return True if attached, false if the caller must start a new job.
+     */
+    bool attachPromise(const std::shared_ptr<QPromise<QImage>>& promise) {
+        QMutexLocker locker(&requestersMutex);
+        if (isCancelledLocked()) {
+            return false;
+        }
+        promises.append(promise);
+        return true;
+    }
+
+    /**
+     * @brief Marks the result as wanted by a signal requester, unless the job is already cancelled.
+     * @param requester The requester to add.
+     * @return True if marked, false if the caller must start a new job.
+     */
+    bool attachRequester(Requester requester) {
+        QMutexLocker locker(&requestersMutex);
+        if (isCancelledLocked()) {
+            return false;
+        }
+        requesters |= requester;
+        return true;
+    }
+
+    /**
+     * @brief Returns true once no requester wants the result any more. Thread-safe.
+     * @return True if the job is cancelled; this never reverts to false.
+     */
+    bool isCancelled() const {
+        QMutexLocker locker(&requestersMutex);
+        return isCancelledLocked();
+    }
+
+    /**
+     * @brief Returns true if the result is wanted by the given signal requester. Thread-safe.
+     * @param requester The requester to test.
+     * @return True if that requester asked for this job.
+     */
+    bool hasRequester(Requester requester) const {
+        QMutexLocker locker(&requestersMutex);
+        return (requesters & requester) != 0;
+    }
+
+    /**
+     * @brief Hands the finished image to every future that has not been cancelled.
+     * @param result The image to deliver.
+     */
+    void fulfil(const QImage& result) {
+        QMutexLocker locker(&requestersMutex);
+        for (const auto& promise : std::as_const(promises)) {
+            if (!promise->isCanceled()) {
+                promise->addResult(result);
+            }
+            promise->finish();
+        }
+        promises.clear();
+    }
+
+    /**
+     * @brief Cancels every future waiting for this job, e.g. because its ID now refers to another file.
+     */
+    void cancelRequests() {
+        QMutexLocker locker(&requestersMutex);
+        for (const auto& promise : std::as_const(promises)) {
+            promise->future().cancel();
+            promise->finish();
+        }
+        promises.clear();
+    }
+
+private:
+    /**
+     * @brief isCancelled() for callers that hold `requestersMutex`.
+     * @return True if the job is cancelled.
+     */
+    bool isCancelledLocked() const {
+        if (requesters != 0) {
+            return false;
+        }
+        for (const auto& promise : promises) {
+            if (!promise->isCanceled()) {
+                return false;
+            }
+        }
+        return !promises.isEmpty();
+    }
+
+    mutable QMutex requestersMutex;                          ///< Guards the requesters below.
+    int requesters = 0;                                      ///< Requester flags of the signal APIs.
+    QVector<std::shared_ptr<QPromise<QImage>>> promises;     ///< Futures waiting for the result.
+};
+
+/**
+ * @brief Shared handle to a LoadJob, as passed between stages.
+ */
+using LoadJobPtr = QSharedPointer<LoadJob>;
+
+/**
+ * @brief An entry of the completion ring: a finished job, or a draft of one still in progress.
+ */
+struct LoadCompletion {
+    LoadJobPtr job; ///< The job the entry belongs to.
+    QImage draft;   ///< Low-quality preview posted before the job finishes; null for the final result.
+};
+
+#endif // IMAGELOADERLIB_LOADJOB_H
@@ -0,0 +1,171 @@
+/**
+ * @file loadpipeline.cpp
+ * @brief Implementation of the LoadPipeline class.
+ *
+ * This file provides the worker loop shared by all stages and the start and
+ * stop logic of the pipeline.
+ */
+#include "loadpipeline.h"
+#include <QMutexLocker> // For scoped locking
+#include <QDebug>       // For debugging output
+
+namespace {
+/**
+ * @brief Human-readable stage names, used for thread names and debug output.
+ */
+const char* const STAGE_NAMES[LoadPipeline::StageCount] = { "io", "decode", "scale" };
+}
+
+/**
+ * @brief Constructs a stopped pipeline.
+ */
+LoadPipeline::LoadPipeline() = default;
+
+/**
+ * @brief Stops the pipeline, dropping unfinished jobs.
+ */
+LoadPipeline::~LoadPipeline() {
+    stop();
+}
+
+/**
+ * @brief Sets the function run by a stage. Must be called before start().
+ * @param stage The stage.
+ * @param function The function to run on each job.
+ */
+void LoadPipeline::setStageFunction(Stage stage, StageFunction function) {
+    m_stageFunctions[stage] = std::move(function);
+}
+
+/**
+ * @brief Sets the function called with each job that has left the last stage.
+ * @param function The publish hook; runs on a worker thread.
+ */
+void LoadPipeline::setPublishFunction(PublishFunction function) {
+    m_publish = std::move(function);
+}
+
+/**
+ * @brief Creates the queues and starts the worker threads.
+ * @param threadCounts The number of workers per stage, indexed by Stage.
+ * @param queueCapacities The capacity of each stage's input queue, indexed by Stage.
+ */
+void LoadPipeline::start(const QVector<int>& threadCounts, const QVector<int>& queueCapacities) {
+    stop();
+    for (int stage = 0; stage < StageCount; ++stage) {
+        m_queues[stage].reset(new BoundedQueue<LoadJobPtr>(queueCapacities.value(stage, 1)));
+    }
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const int threads = qMax(1, threadCounts.value(stage, 1));
+        for (int i = 0; i < threads; ++i) {
+            QThread* worker = QThread::create([this, stage]() {
+                runWorker(Stage(stage));
+            });
+            worker->setObjectName(QString("ImageLoader %1 #%2").arg(QLatin1String(STAGE_NAMES[stage])).arg(i));
+            worker->start();
+            m_workers.append(worker);
+        }
+        qDebug() << "Pipeline stage" << STAGE_NAMES[stage] << "started with" << threads
+                 << "threads, queue capacity" << m_queues[stage]->capacity();
+    }
+}
+
+/**
+ * @brief Stops every worker and returns the jobs that did not reach the publish hook.
+ * @return The unfinished jobs, in no particular order.
+ */
+QVector<LoadJobPtr> LoadPipeline::stop() {
+    if (m_workers.isEmpty()) {
+        return QVector<LoadJobPtr>();
+    }
+    for (auto& queue : m_queues) {
+        queue->close();
+    }
+    for (QThread* worker : std::as_const(m_workers)) {
+        worker->wait();
+        delete worker;
+    }
+    m_workers.clear();
+
+    QVector<LoadJobPtr> unfinished;
+    {
+        QMutexLocker locker(&m_droppedMutex);
+        unfinished.swap(m_dropped);
+    }
+    for (auto& queue : m_queues) {
+        LoadJobPtr job;
+        while (queue->tryPop(&job)) {
+            unfinished.append(job);
+        }
+        queue.reset();
+    }
+    return unfinished;
+}
+
+/**
+ * @brief Queues a job for the I/O stage without blocking, ordered by its priority.
+ * @param job The job to queue.
+ * @return True if queued, false if the I/O queue is full or the pipeline is stopped.
+ */
+bool LoadPipeline::tryPush(const LoadJobPtr& job) {
+    return m_queues[IoStage] && m_queues[IoStage]->tryPush(job, job->priority);
+}
+
+/**
+ * @brief Puts a job parked by a stage back into that stage's queue without blocking.
+ * @param stage The stage that parked the job.
+ * @param job The job.
+ * @return True if queued, false if the queue is full or the pipeline is stopped.
+ */
+bool LoadPipeline::requeue(Stage stage, const LoadJobPtr& job) {
+    return m_queues[stage] && m_queues[stage]->tryPush(job, job->priority);
+}
+
+/**
+ * @brief Returns the number of jobs waiting in a stage's input queue.
+ * @param stage The stage.
+ * @return The queue depth, or 0 if the pipeline is stopped.
+ */
+int LoadPipeline::queueDepth(Stage stage) const {
+    return m_queues[stage] ? m_queues[stage]->size() : 0;
+}
+
+/**
+ * @brief Returns the capacity of a stage's input queue.
+ * @param stage The stage.
+ * @return The capacity, or 0 if the pipeline is stopped.
+ */
+int LoadPipeline::queueCapacity(Stage stage) const {
+    return m_queues[stage] ? m_queues[stage]->capacity() : 0;
+}
+
+/**
+ * @brief Body of a worker thread of the given stage.
+ *
+ * Pushing into the next stage's queue blocks while it is full: this is the
+ * backpressure that keeps, say, the I/O stage from running arbitrarily far
+ * ahead of a decode stage saturated by large images.
+ *
+ * @param stage The stage the worker belongs to.
+ */
+void LoadPipeline::runWorker(Stage stage) {
+    BoundedQueue<LoadJobPtr>& input = *m_queues[stage];
+    LoadJobPtr job;
+    while (input.pop(&job)) {
+        if (m_stageFunctions[stage] && !m_stageFunctions[stage](job)) {
+            job.reset(); // Parked by the stage, which requeues it later
+            continue;
+        }
+
+        const int next = stage + 1;
+        if (next < StageCount) {
+            if (!m_queues[next]->push(job, job->priority)) {
+                QMutexLocker locker(&m_droppedMutex); // Stopped while we were blocked
+                m_dropped.append(job);
+            }
+        } else if (m_publish) {
+            m_publish(job);
+        }
+        job.reset();
+    }
+}
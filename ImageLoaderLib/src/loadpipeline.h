@@ -0,0 +1,140 @@
+/**
+ * @file loadpipeline.h
+ * @brief Declaration of the LoadPipeline class, the staged worker pipeline behind ImageLoader.
+ *
+ * This file defines the LoadPipeline class, which runs the I/O, decode and
+ * scale stages of image loading on separate pools of worker threads
+ * connected by bounded queues. What each stage does is supplied by the
+ * ImageLoader; the pipeline only moves jobs along and owns the threads.
+ */
+#ifndef IMAGELOADERLIB_LOADPIPELINE_H
+#define IMAGELOADERLIB_LOADPIPELINE_H
+
+#include "boundedqueue.h" // For the inter-stage queues
+#include "loadjob.h"      // For LoadJob
+
+#include <QMutex>         // For the dropped-jobs list
+#include <QThread>        // For the worker threads
+#include <QVector>        // For thread and job lists
+
+#include <functional>     // For std::function
+#include <memory>         // For std::unique_ptr
+
+/**
+ * @brief A three-stage pipeline (I/O, decode, scale) followed by a publish hook.
+ *
+ * Every stage has its own input queue and thread count. A worker pops a job
+ * from its stage's queue, runs the stage function on it and pushes it into
+ * the next stage's queue, blocking while that queue is full. After the last
+ * stage the publish function is called on the worker thread; it is expected
+ * to hand the job over to another thread.
+ *
+ * A stage function that cannot run a job yet (the decode stage when the
+ * memory budget is exhausted) keeps the job and returns false; the worker
+ * moves on to the next one, and the job comes back through requeue().
+ */
+class LoadPipeline {
+public:
+    /**
+     * @brief The worker stages, in processing order.
+     */
+    enum Stage {
+        IoStage = 0,  ///< Brings the encoded bytes into memory.
+        DecodeStage,  ///< Decodes the pixels under the memory budget.
+        ScaleStage,   ///< Scales and converts to the preview.
+        StageCount    ///< Number of stages.
+    };
+
+    /**
+     * @brief Function run by a stage on each job.
+     *
+     * Returns false if it parked the job instead of processing it.
+     */
+    using StageFunction = std::function<bool(const LoadJobPtr&)>;
+
+    /**
+     * @brief Function called with each job that has left the last stage.
+     */
+    using PublishFunction = std::function<void(const LoadJobPtr&)>;
+
+    /**
+     * @brief Constructs a stopped pipeline.
+     */
+    LoadPipeline();
+
+    /**
+     * @brief Stops the pipeline, dropping unfinished jobs.
+     */
+    ~LoadPipeline();
+
+    /**
+     * @brief Sets the function run by a stage. Must be called before start().
+     * @param stage The stage.
+     * @param function The function to run on each job.
+     */
+    void setStageFunction(Stage stage, StageFunction function);
+
+    /**
+     * @brief Sets the function called with each job that has left the last stage.
+     * @param function The publish hook; runs on a worker thread.
+     */
+    void setPublishFunction(PublishFunction function);
+
+    /**
+     * @brief Creates the queues and starts the worker threads.
+     * @param threadCounts The number of workers per stage, indexed by Stage.
+     * @param queueCapacities The capacity of each stage's input queue, indexed by Stage.
+     */
+    void start(const QVector<int>& threadCounts, const QVector<int>& queueCapacities);
+
+    /**
+     * @brief Stops every worker and returns the jobs that did not reach the publish hook.
+     * @return The unfinished jobs, in no particular order.
+     */
+    QVector<LoadJobPtr> stop();
+
+    /**
+     * @brief Queues a job for the I/O stage without blocking, ordered by its priority.
+     * @param job The job to queue.
+     * @return True if queued, false if the I/O queue is full or the pipeline is stopped.
+     */
+    bool tryPush(const LoadJobPtr& job);
+
+    /**
+     * @brief Puts a job parked by a stage back into that stage's queue without blocking.
+     * @param stage The stage that parked the job.
+     * @param job The job.
+     * @return True if queued, false if the queue is full or the pipeline is stopped.
+     */
+    bool requeue(Stage stage, const LoadJobPtr& job);
+
+    /**
+     * @brief Returns the number of jobs waiting in a stage's input queue.
+     * @param stage The stage.
+     * @return The queue depth, or 0 if the pipeline is stopped.
+     */
+    int queueDepth(Stage stage) const;
+
+    /**
+     * @brief Returns the capacity of a stage's input queue.
+     * @param stage The stage.
+     * @return The capacity, or 0 if the pipeline is stopped.
+     */
+    int queueCapacity(Stage stage) const;
+
+private:
+    /**
+     * @brief Body of a worker thread of the given stage.
+     * @param stage The stage the worker belongs to.
+     */
+    void runWorker(Stage stage);
+
+    std::unique_ptr<BoundedQueue<LoadJobPtr>> m_queues[StageCount]; ///< Input queue of each stage.
+    StageFunction m_stageFunctions[StageCount];                     ///< Work done by each stage.
+    PublishFunction m_publish;                                      ///< Called after the last stage.
+    QVector<QThread*> m_workers;                                    ///< All worker threads.
+    QMutex m_droppedMutex;                                          ///< Guards m_dropped.
+    QVector<LoadJobPtr> m_dropped;                                  ///< Jobs caught in flight by stop().
+};
+
+#endif // IMAGELOADERLIB_LOADPIPELINE_H
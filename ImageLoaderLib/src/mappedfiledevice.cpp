@@ -0,0 +1,248 @@
+/**
+ * @file mappedfiledevice.cpp
+ * @brief Implementation of the MappedFileDevice class.
+ *
+ * This file provides the mapping, madvise hints and read path of the
+ * memory-mapped QIODevice used as decoder input.
+ */
+#include "mappedfiledevice.h"
+#include <QDateTime> // For telling recently written files
+#include <QDebug>    // For debugging output
+#include <QFileInfo> // For the modification time
+#include <cstring>   // For std::memcpy
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h> // For madvise
+#endif
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>    // For posix_fadvise
+#endif
+
+namespace {
+/**
+ * @brief Files at least this large are prefetched with MADV_WILLNEED (256 KiB).
+ *
+ * Smaller files are typically read by the kernel's default readahead window
+ * in one go anyway.
+ */
+constexpr qint64 WILLNEED_THRESHOLD = 256 * 1024;
+
+/**
+ * @brief Stride used to touch the mapping; no larger than any supported page size.
+ */
+constexpr qint64 PREFAULT_STRIDE = 4096;
+
+/**
+ * @brief Files modified less than this long ago are read rather than mapped (ms).
+ *
+ * A file still being written, or rewritten in place, may be truncated under
+ * the mapping. Copying tools and cameras writing to a watched directory are
+ * usually done within this time.
+ */
+constexpr qint64 RECENT_WRITE_WINDOW_MS = 5000;
+}
+
+/**
+ * @brief Constructs a device for the given file. The file is not opened yet.
+ * @param path The path of the file to map.
+ * @param parent Pointer to the parent QObject.
+ */
+MappedFileDevice::MappedFileDevice(const QString& path, QObject* parent)
+    : QIODevice(parent),
+    m_file(path),
+    m_map(nullptr),
+    m_data(nullptr),
+    m_size(0),
+    m_dropCache(false)
+{
+}
+
+/**
+ * @brief Destroys the device, unmapping the file if it is still open.
+ */
+MappedFileDevice::~MappedFileDevice() {
+    close();
+}
+
+/**
+ * @brief Opens and maps the file. Only QIODevice::ReadOnly is supported.
+ *
+ * The device itself is always opened unbuffered: buffering would only add
+ * a copy on top of the page cache.
+ *
+ * @param mode The open mode.
+ * @return True on success.
+ */
+bool MappedFileDevice::open(OpenMode mode) {
+    if ((mode & QIODevice::WriteOnly) || isOpen()) {
+        return false;
+    }
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        setErrorString(m_file.errorString());
+        return false;
+    }
+
+    m_size = m_file.size();
+    const QDateTime lastModified = QFileInfo(m_file).lastModified();
+    const bool recentlyWritten = lastModified.isValid()
+                                 && qAbs(lastModified.msecsTo(QDateTime::currentDateTime())) < RECENT_WRITE_WINDOW_MS;
+    m_map = (m_size > 0 && !recentlyWritten) ? m_file.map(0, m_size) : nullptr;
+    if (m_map) {
+        m_data = m_map;
+#if defined(Q_OS_UNIX)
+        // QFile::map() with offset 0 returns a page-aligned address, as madvise requires
+        madvise(m_map, size_t(m_size), MADV_SEQUENTIAL);
+        if (m_size >= WILLNEED_THRESHOLD) {
+            madvise(m_map, size_t(m_size), MADV_WILLNEED);
+        }
+#endif
+    } else {
+        if (!recentlyWritten) {
+            qDebug() << "Could not map" << m_file.fileName() << ", reading it into memory instead.";
+        }
+        readIntoMemory();
+    }
+
+    return QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+/**
+ * @brief Unmaps and closes the file.
+ */
+void MappedFileDevice::close() {
+    if (!isOpen()) {
+        return;
+    }
+    QIODevice::close();
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+#if defined(Q_OS_LINUX)
+    if (m_dropCache) {
+        // Only clean pages that are no longer mapped can be dropped, hence after unmap()
+        posix_fadvise(m_file.handle(), 0, 0, POSIX_FADV_DONTNEED);
+    }
+#endif
+    m_fallback.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_file.close();
+}
+
+/**
+ * @brief Returns false: the device supports random access.
+ * @return Always false.
+ */
+bool MappedFileDevice::isSequential() const {
+    return false;
+}
+
+/**
+ * @brief Returns the size of the mapped file.
+ * @return The size in bytes.
+ */
+qint64 MappedFileDevice::size() const {
+    return m_size;
+}
+
+/**
+ * @brief Returns the mapped bytes, for callers that can parse them in place.
+ * @return The start of the file contents, or nullptr if the device is not open.
+ */
+const uchar* MappedFileDevice::data() const {
+    return m_data;
+}
+
+/**
+ * @brief Returns true if the contents are served from a memory mapping.
+ * @return True if mapped, false if the in-memory fallback is used.
+ */
+bool MappedFileDevice::isMapped() const {
+    return m_map != nullptr;
+}
+
+/**
+ * @brief Replaces the mapping with a copy of the file's current contents.
+ */
+void MappedFileDevice::readIntoMemory() {
+    if (m_map) {
+        m_file.unmap(m_map);
+        m_map = nullptr;
+    }
+    m_file.seek(0);
+    m_fallback = m_file.readAll();
+    m_size = m_fallback.size();
+    m_data = reinterpret_cast<const uchar*>(m_fallback.constData());
+}
+
+/**
+ * @brief Re-checks the size of a mapped file, falling back to a copy if it shrank.
+ *
+ * QFile::size() of an open file is an fstat() of its descriptor, so this
+ * sees the file that is mapped even if its name now points elsewhere.
+ *
+ * @return True if the contents are unchanged in size; false if the device switched to the shorter copy.
+ */
+bool MappedFileDevice::ensureIntact() {
+    if (!m_map || m_file.size() >= m_size) {
+        return true;
+    }
+    qDebug() << "File" << m_file.fileName() << "shrank from" << m_size << "to" << m_file.size()
+             << "bytes while mapped; reading what is left instead.";
+    readIntoMemory();
+    if (pos() > m_size) {
+        seek(m_size);
+    }
+    return false;
+}
+
+/**
+ * @brief Touches every page of the mapping so that it is resident.
+ *
+ * The size is checked first: touching pages past the end of a file
+ * truncated since open() would raise SIGBUS.
+ */
+void MappedFileDevice::prefault() {
+    if (!ensureIntact() || !m_map) {
+        return; // The fallback buffer is already in memory
+    }
+    volatile uchar sink = 0;
+    for (qint64 offset = 0; offset < m_size; offset += PREFAULT_STRIDE) {
+        sink = sink ^ m_map[offset];
+    }
+    sink = sink ^ m_map[m_size - 1];
+}
+
+/**
+ * @brief Asks the kernel to drop the file from the page cache when the device is closed.
+ * @param drop True to drop the cached pages on close().
+ */
+void MappedFileDevice::setDropCacheOnClose(bool drop) {
+    m_dropCache = drop;
+}
+
+/**
+ * @brief Copies up to `maxSize` bytes from the current position.
+ * @param data The destination buffer.
+ * @param maxSize The maximum number of bytes to copy.
+ * @return The number of bytes copied.
+ */
+qint64 MappedFileDevice::readData(char* data, qint64 maxSize) {
+    const qint64 position = pos();
+    const qint64 count = qBound<qint64>(0, m_size - position, maxSize);
+    if (count > 0) {
+        std::memcpy(data, m_data + position, size_t(count));
+    }
+    return count;
+}
+
+/**
+ * @brief Always fails: the device is read-only.
+ * @return Always -1.
+ */
+qint64 MappedFileDevice::writeData(const char* data, qint64 maxSize) {
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
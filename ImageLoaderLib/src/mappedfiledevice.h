@@ -0,0 +1,151 @@
+/**
+ * @file mappedfiledevice.h
+ * @brief Declaration of the MappedFileDevice class, a read-only QIODevice over a memory-mapped file.
+ *
+ * This file defines the MappedFileDevice class, which lets QImageReader pull
+ * the encoded bytes of an image straight out of the page cache: the file is
+ * mapped with QFile::map() and every read() is a single copy from the mapping
+ * into the decoder's buffer, without the intermediate buffering QFile does.
+ */
+#ifndef IMAGELOADERLIB_MAPPEDFILEDEVICE_H
+#define IMAGELOADERLIB_MAPPEDFILEDEVICE_H
+
+#include <QByteArray> // For the fallback when mapping is not possible
+#include <QFile>      // For the underlying file and its mapping
+#include <QIODevice>  // Base class
+
+/**
+ * @brief A random-access, read-only QIODevice backed by a memory-mapped file.
+ *
+ * The device is opened unbuffered, so QIODevice::read() calls readData()
+ * directly and no second copy of the encoded bytes is made. On Unix the
+ * mapping is advised as sequential, and large files are additionally
+ * prefetched with MADV_WILLNEED so the kernel reads ahead while the decoder
+ * starts working on the header.
+ *
+ * If the file cannot be mapped (empty files, some network file systems) its
+ * contents are read into memory instead and served the same way. Files
+ * modified within the last few seconds are read into memory too: they may
+ * still be being written.
+ *
+ * @warning Touching a page of a mapping beyond the end of a file that was
+ * truncated after mapping raises SIGBUS, which kills the process. Files are
+ * replaced atomically by most tools, which is harmless (the mapping keeps
+ * the old inode), but a program may also rewrite a file in place. The
+ * device cannot rule this out; it narrows the window: recent files are not
+ * mapped, and prefault() and ensureIntact() re-check the size of the file
+ * and switch to a copy of what is left if it shrank. Callers reading data()
+ * must call ensureIntact() right before they start.
+ */
+class MappedFileDevice : public QIODevice {
+public:
+    /**
+     * @brief Constructs a device for the given file. The file is not opened yet.
+     * @param path The path of the file to map.
+     * @param parent Pointer to the parent QObject.
+     */
+    explicit MappedFileDevice(const QString& path, QObject* parent = nullptr);
+
+    /**
+     * @brief Destroys the device, unmapping the file if it is still open.
+     */
+    ~MappedFileDevice() override;
+
+    /**
+     * @brief Opens and maps the file. Only QIODevice::ReadOnly is supported.
+     * @param mode The open mode.
+     * @return True on success.
+     */
+    bool open(OpenMode mode) override;
+
+    /**
+     * @brief Unmaps and closes the file.
+     */
+    void close() override;
+
+    /**
+     * @brief Returns false: the device supports random access.
+     * @return Always false.
+     */
+    bool isSequential() const override;
+
+    /**
+     * @brief Returns the size of the mapped file.
+     * @return The size in bytes.
+     */
+    qint64 size() const override;
+
+    /**
+     * @brief Returns the mapped bytes, for callers that can parse them in place.
+     * @return The start of the file contents, or nullptr if the device is not open.
+     */
+    const uchar* data() const;
+
+    /**
+     * @brief Returns true if the contents are served from a memory mapping.
+     * @return True if mapped, false if the in-memory fallback is used.
+     */
+    bool isMapped() const;
+
+    /**
+     * @brief Touches every page of the mapping so that it is resident.
+     *
+     * Called by the I/O stage of the loader pipeline, so that the disk wait
+     * happens there and the decoder only ever reads from memory. Calls
+     * ensureIntact() first.
+     */
+    void prefault();
+
+    /**
+     * @brief Re-checks the size of a mapped file, falling back to a copy if it shrank.
+     *
+     * Call right before parsing data(): pages beyond the new end of a
+     * truncated file must not be touched. If the file shrank, the mapping is
+     * dropped and what is left of the file is read into memory, so data()
+     * and size() change.
+     *
+     * @return True if the contents are unchanged in size; false if the device switched to the shorter copy.
+     */
+    bool ensureIntact();
+
+    /**
+     * @brief Asks the kernel to drop the file from the page cache when the device is closed.
+     *
+     * Meant for large originals that are read once to build a preview: they
+     * would otherwise push small, frequently used files out of the cache.
+     * Only has an effect on Linux.
+     *
+     * @param drop True to drop the cached pages on close().
+     */
+    void setDropCacheOnClose(bool drop);
+
+protected:
+    /**
+     * @brief Copies up to `maxSize` bytes from the current position.
+     * @param data The destination buffer.
+     * @param maxSize The maximum number of bytes to copy.
+     * @return The number of bytes copied.
+     */
+    qint64 readData(char* data, qint64 maxSize) override;
+
+    /**
+     * @brief Always fails: the device is read-only.
+     * @return Always -1.
+     */
+    qint64 writeData(const char* data, qint64 maxSize) override;
+
+private:
+    /**
+     * @brief Replaces the mapping with a copy of the file's current contents.
+     */
+    void readIntoMemory();
+
+    QFile m_file;          ///< The underlying file; kept open while mapped.
+    uchar* m_map;          ///< The mapping, or nullptr when using the fallback.
+    QByteArray m_fallback; ///< File contents when mapping is not possible.
+    const uchar* m_data;   ///< Start of the contents (mapping or fallback).
+    qint64 m_size;         ///< Size of the contents in bytes.
+    bool m_dropCache;      ///< If true, close() evicts the file from the page cache.
+};
+
+#endif // IMAGELOADERLIB_MAPPEDFILEDEVICE_H
@@ -0,0 +1,130 @@
+/**
+ * @file memorybudget.cpp
+ * @brief Implementation of the MemoryBudget class.
+ *
+ * This file provides the blocking reservation logic used by the decode
+ * workers, and the helper that predicts the memory footprint of a decode
+ * from the image header.
+ */
+#include "memorybudget.h"
+#include <QMutexLocker> // For scoped locking
+
+/**
+ * @brief Constructs a budget with the given limit.
+ * @param limitBytes The maximum number of bytes that may be in flight at once.
+ */
+MemoryBudget::MemoryBudget(qint64 limitBytes)
+    : m_limit(qMax<qint64>(1, limitBytes)),
+    m_inFlight(0),
+    m_interrupted(false)
+{
+}
+
+/**
+ * @brief Changes the limit. Waiting workers are re-evaluated immediately.
+ * @param limitBytes The new limit in bytes.
+ */
+void MemoryBudget::setLimit(qint64 limitBytes) {
+    QMutexLocker locker(&m_mutex);
+    m_limit = qMax<qint64>(1, limitBytes);
+    m_released.wakeAll();
+}
+
+/**
+ * @brief Returns the current limit.
+ * @return The limit in bytes.
+ */
+qint64 MemoryBudget::limit() const {
+    QMutexLocker locker(&m_mutex);
+    return m_limit;
+}
+
+/**
+ * @brief Returns the number of bytes currently reserved.
+ * @return The reserved bytes.
+ */
+qint64 MemoryBudget::inFlight() const {
+    QMutexLocker locker(&m_mutex);
+    return m_inFlight;
+}
+
+/**
+ * @brief Reserves `bytes`, blocking until they are available.
+ *
+ * @param bytes The number of bytes to reserve.
+ * @return The number of bytes actually reserved, or -1 if interrupted.
+ */
+qint64 MemoryBudget::acquire(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    bytes = qBound<qint64>(0, bytes, m_limit);
+    while (!m_interrupted && m_inFlight + bytes > m_limit) {
+        m_released.wait(&m_mutex);
+        bytes = qMin(bytes, m_limit); // The limit may have shrunk while we were waiting
+    }
+    if (m_interrupted) {
+        return -1;
+    }
+    m_inFlight += bytes;
+    return bytes;
+}
+
+/**
+ * @brief Reserves `bytes` if they are available right now.
+ *
+ * @param bytes The number of bytes to reserve.
+ * @return The number of bytes actually reserved, or -1 if not available or interrupted.
+ */
+qint64 MemoryBudget::tryAcquire(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    bytes = qBound<qint64>(0, bytes, m_limit);
+    if (m_interrupted || m_inFlight + bytes > m_limit) {
+        return -1;
+    }
+    m_inFlight += bytes;
+    return bytes;
+}
+
+/**
+ * @brief Makes every blocked and future acquire() return -1 until resume() is called.
+ */
+void MemoryBudget::interrupt() {
+    QMutexLocker locker(&m_mutex);
+    m_interrupted = true;
+    m_released.wakeAll();
+}
+
+/**
+ * @brief Lets acquire() reserve memory again after interrupt().
+ */
+void MemoryBudget::resume() {
+    QMutexLocker locker(&m_mutex);
+    m_interrupted = false;
+}
+
+/**
+ * @brief Returns a reservation made with acquire() or tryAcquire().
+ * @param bytes The value returned by acquire() or tryAcquire().
+ */
+void MemoryBudget::release(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    m_inFlight = qMax<qint64>(0, m_inFlight - bytes);
+    m_released.wakeAll();
+}
+
+/**
+ * @brief Predicts the number of bytes a QImage of the given size and format occupies.
+ *
+ * @param size The image dimensions.
+ * @param format The pixel format, or QImage::Format_Invalid if unknown.
+ * @return The predicted size in bytes, or 0 if `size` is invalid.
+ */
+qint64 MemoryBudget::estimateImageBytes(const QSize& size, QImage::Format format) {
+    if (!size.isValid() || size.isEmpty()) {
+        return 0;
+    }
+    const int bitsPerPixel = (format != QImage::Format_Invalid)
+                                 ? QImage::toPixelFormat(format).bitsPerPixel()
+                                 : 32;
+    const qint64 bytesPerLine = ((qint64(size.width()) * bitsPerPixel + 31) / 32) * 4; // 32-bit aligned scanlines
+    return bytesPerLine * size.height();
+}
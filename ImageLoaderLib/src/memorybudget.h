@@ -0,0 +1,118 @@
+/**
+ * @file memorybudget.h
+ * @brief Declaration of the MemoryBudget class, the admission control for in-flight decodes.
+ *
+ * This file defines the MemoryBudget class, a byte-counting semaphore shared by
+ * all decode workers of an ImageLoader. A worker reserves the predicted peak
+ * footprint of its decode before allocating anything and gives it back once the
+ * full-resolution pixels have been freed.
+ */
+#ifndef IMAGELOADERLIB_MEMORYBUDGET_H
+#define IMAGELOADERLIB_MEMORYBUDGET_H
+
+#include <QImage>         // For QImage::Format
+#include <QMutex>         // For guarding the counters
+#include <QSize>          // For image dimensions
+#include <QWaitCondition> // For blocking until memory is released
+
+/**
+ * @brief A global in-flight memory budget for image decodes.
+ *
+ * The budget is expressed in bytes. Reservations that fit in the remaining
+ * budget are granted immediately; others block until enough memory has been
+ * released by other workers. A reservation larger than the whole budget is
+ * granted exclusively, i.e. only once nothing else is in flight.
+ *
+ * All methods are thread-safe.
+ */
+class MemoryBudget {
+public:
+    /**
+     * @brief Constructs a budget with the given limit.
+     * @param limitBytes The maximum number of bytes that may be in flight at once.
+     */
+    explicit MemoryBudget(qint64 limitBytes);
+
+    /**
+     * @brief Changes the limit. Waiting workers are re-evaluated immediately.
+     * @param limitBytes The new limit in bytes.
+     */
+    void setLimit(qint64 limitBytes);
+
+    /**
+     * @brief Returns the current limit.
+     * @return The limit in bytes.
+     */
+    qint64 limit() const;
+
+    /**
+     * @brief Returns the number of bytes currently reserved.
+     * @return The reserved bytes.
+     */
+    qint64 inFlight() const;
+
+    /**
+     * @brief Reserves `bytes`, blocking until they are available.
+     *
+     * A request larger than the limit is clamped to the limit, which makes it
+     * wait until it can run alone.
+     *
+     * @param bytes The number of bytes to reserve.
+     * @return The number of bytes actually reserved; pass it to release().
+     *         -1 if the wait was cut short by interrupt(); nothing is reserved then.
+     */
+    qint64 acquire(qint64 bytes);
+
+    /**
+     * @brief Reserves `bytes` if they are available right now.
+     *
+     * The non-blocking counterpart of acquire(), for workers that have
+     * other jobs to run in the meantime. A request larger than the limit is
+     * clamped to the limit, so it succeeds once nothing else is in flight.
+     *
+     * @param bytes The number of bytes to reserve.
+     * @return The number of bytes actually reserved; pass it to release().
+     *         -1 if they are not available or after interrupt(); nothing is reserved then.
+     */
+    qint64 tryAcquire(qint64 bytes);
+
+    /**
+     * @brief Makes every blocked and future acquire() return -1 until resume() is called.
+     *
+     * Used when the workers are being stopped: the reservations they wait
+     * for may be held by jobs that will never finish.
+     */
+    void interrupt();
+
+    /**
+     * @brief Lets acquire() reserve memory again after interrupt().
+     */
+    void resume();
+
+    /**
+     * @brief Returns a reservation made with acquire() or tryAcquire().
+     * @param bytes The value returned by acquire() or tryAcquire().
+     */
+    void release(qint64 bytes);
+
+    /**
+     * @brief Predicts the number of bytes a QImage of the given size and format occupies.
+     *
+     * Accounts for QImage's 32-bit scanline alignment. Unknown formats are
+     * assumed to be 32 bits per pixel.
+     *
+     * @param size The image dimensions.
+     * @param format The pixel format, or QImage::Format_Invalid if unknown.
+     * @return The predicted size in bytes, or 0 if `size` is invalid.
+     */
+    static qint64 estimateImageBytes(const QSize& size, QImage::Format format);
+
+private:
+    mutable QMutex m_mutex;       ///< Guards the counters below.
+    QWaitCondition m_released;    ///< Signalled whenever memory is released or the limit changes.
+    qint64 m_limit;               ///< Maximum bytes in flight.
+    qint64 m_inFlight;            ///< Bytes currently reserved.
+    bool m_interrupted;           ///< True between interrupt() and resume().
+};
+
+#endif // IMAGELOADERLIB_MEMORYBUDGET_H
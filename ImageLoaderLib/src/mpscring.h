@@ -0,0 +1,147 @@
+/**
+ * @file mpscring.h
+ * @brief Declaration and implementation of the MpscRing class template.
+ *
+ * This file defines MpscRing, a bounded, lock-free ring buffer with many
+ * producers and a single consumer. Pipeline workers push finished jobs into
+ * it and the loader's thread drains it once per frame, instead of every
+ * completion posting its own event to the GUI event loop.
+ */
+#ifndef IMAGELOADERLIB_MPSCRING_H
+#define IMAGELOADERLIB_MPSCRING_H
+
+#include <QtGlobal>  // For qMax
+
+#include <atomic>    // For the slot sequence numbers and cursors
+#include <cstddef>   // For size_t
+#include <memory>    // For std::unique_ptr
+#include <utility>   // For std::move
+
+/**
+ * @brief A bounded multi-producer, single-consumer lock-free ring buffer.
+ *
+ * Every slot carries a sequence number telling whether it is free for the
+ * producer at a given position or holds an item for the consumer at that
+ * position (D. Vyukov's bounded queue). Producers claim positions with a
+ * compare-and-swap on the write cursor; the single consumer owns the read
+ * cursor and needs no atomic read-modify-write at all.
+ *
+ * tryPush() may be called from any thread; tryPop() from one thread only.
+ *
+ * @tparam T The item type; must be default-constructible and movable.
+ */
+template <typename T>
+class MpscRing {
+public:
+    /**
+     * @brief Constructs an empty ring.
+     * @param capacity The minimum number of slots; rounded up to a power of two.
+     */
+    explicit MpscRing(int capacity)
+        : m_mask(roundUpToPowerOfTwo(size_t(qMax(2, capacity))) - 1),
+        m_slots(new Slot[m_mask + 1]),
+        m_writePos(0),
+        m_readPos(0)
+    {
+        for (size_t i = 0; i <= m_mask; ++i) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * @brief Appends an item without blocking. Any thread.
+     * @param item The item to append.
+     * @return True if appended, false if the ring is full.
+     */
+    bool tryPush(T item) {
+        size_t position = m_writePos.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+        forever {
+            slot = &m_slots[position & m_mask];
+            const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t difference = std::ptrdiff_t(sequence) - std::ptrdiff_t(position);
+            if (difference == 0) {
+                // The slot is free for this position: try to claim it
+                if (m_writePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false; // The consumer has not freed this slot yet: full
+            } else {
+                position = m_writePos.load(std::memory_order_relaxed); // Another producer got it
+            }
+        }
+        slot->value = std::move(item);
+        slot->sequence.store(position + 1, std::memory_order_release); // Publish to the consumer
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item without blocking. Consumer thread only.
+     * @param item Receives the removed item.
+     * @return True if an item was removed, false if the ring is empty or the
+     *         oldest item is still being written.
+     */
+    bool tryPop(T* item) {
+        const size_t position = m_readPos.load(std::memory_order_relaxed);
+        Slot& slot = m_slots[position & m_mask];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            return false;
+        }
+        *item = std::move(slot.value);
+        slot.value = T(); // Do not keep the item alive in the ring
+        slot.sequence.store(position + m_mask + 1, std::memory_order_release); // Free for the next lap
+        m_readPos.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of claimed slots, including items still being written. Any thread.
+     * @return An approximate number of items; exact when no producer is active.
+     */
+    int size() const {
+        const size_t read = m_readPos.load(std::memory_order_acquire);
+        const size_t write = m_writePos.load(std::memory_order_acquire);
+        return int(write - read);
+    }
+
+    /**
+     * @brief Returns the number of slots.
+     * @return The capacity of the ring.
+     */
+    int capacity() const {
+        return int(m_mask + 1);
+    }
+
+private:
+    /**
+     * @brief A ring slot and its sequence number.
+     */
+    struct Slot {
+        std::atomic<size_t> sequence; ///< Position this slot is ready for.
+        T value;                      ///< The stored item.
+    };
+
+    /**
+     * @brief Returns the smallest power of two not below `value`.
+     * @param value The value to round up.
+     * @return The rounded value.
+     */
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t m_mask;                   ///< Capacity minus one.
+    std::unique_ptr<Slot[]> m_slots;       ///< The ring storage.
+    alignas(64) std::atomic<size_t> m_writePos; ///< Next position to claim; shared by producers.
+    alignas(64) std::atomic<size_t> m_readPos;  ///< Next position to pop; owned by the consumer.
+};
+
+#endif // IMAGELOADERLIB_MPSCRING_H
@@ -0,0 +1,234 @@
+/**
+ * @file pixelbufferpool.cpp
+ * @brief Implementation of the PixelBufferPool class.
+ *
+ * Every block starts with a small header that records its size class, followed
+ * by the 64-byte aligned pixel data handed to QImage. The header lets the QImage
+ * cleanup function return the block to the right free list without any lookup.
+ */
+#include "pixelbufferpool.h"
+#include <QGlobalStatic>  // For the process-wide instance
+#include <QMutexLocker>   // For scoped locking
+#include <QtMath>         // For qNextPowerOfTwo
+#include <new>            // For aligned operator new/delete
+
+namespace {
+/**
+ * @brief Alignment of every block, and size of the header that precedes the pixels.
+ */
+constexpr std::size_t BLOCK_ALIGNMENT = 64;
+/**
+ * @brief Smallest size class; tiny requests are not worth pooling separately.
+ */
+constexpr qint64 MIN_SIZE_CLASS = 64 * 1024;
+/**
+ * @brief Default bound for the memory kept in the free lists (256 MiB).
+ */
+constexpr qint64 DEFAULT_MAX_CACHED_BYTES = 256ll * 1024 * 1024;
+
+/**
+ * @brief Header stored in the first BLOCK_ALIGNMENT bytes of every block.
+ */
+struct BlockHeader {
+    qint64 capacity; ///< Size class of the block (pixel data only).
+};
+
+/**
+ * @brief Allocates a block with room for the header and `capacity` bytes of pixels.
+ *
+ * Uses the non-throwing allocation: the pool runs on worker threads, where
+ * an exception would terminate the application.
+ *
+ * @return The block, or nullptr if the system is out of memory.
+ */
+uchar* allocateBlock(qint64 capacity) {
+    auto* block = static_cast<uchar*>(::operator new(BLOCK_ALIGNMENT + std::size_t(capacity),
+                                                     std::align_val_t(BLOCK_ALIGNMENT), std::nothrow));
+    if (block) {
+        reinterpret_cast<BlockHeader*>(block)->capacity = capacity;
+    }
+    return block;
+}
+
+/**
+ * @brief Returns a block to the system.
+ */
+void freeBlock(uchar* block) {
+    ::operator delete(block, std::align_val_t(BLOCK_ALIGNMENT), std::nothrow);
+}
+} // namespace
+
+Q_GLOBAL_STATIC(PixelBufferPool, globalPixelBufferPool)
+
+/**
+ * @brief Returns the process-wide pool.
+ * @return The pool, or nullptr during static destruction at exit.
+ */
+PixelBufferPool* PixelBufferPool::instance() {
+    return globalPixelBufferPool.isDestroyed() ? nullptr : globalPixelBufferPool();
+}
+
+/**
+ * @brief Constructs an empty pool.
+ */
+PixelBufferPool::PixelBufferPool()
+    : m_cachedBytes(0),
+    m_maxCachedBytes(DEFAULT_MAX_CACHED_BYTES)
+{
+}
+
+/**
+ * @brief Destroys the pool and frees every cached block.
+ */
+PixelBufferPool::~PixelBufferPool() {
+    trim();
+}
+
+/**
+ * @brief Creates an uninitialised image whose pixels live in a pooled block.
+ *
+ * @param size The image dimensions.
+ * @param format The pixel format.
+ * @return The image, or a null QImage if `size` or `format` is invalid or no memory is left.
+ */
+QImage PixelBufferPool::createImage(const QSize& size, QImage::Format format) {
+    if (size.isEmpty() || format == QImage::Format_Invalid) {
+        return QImage();
+    }
+    const int bitsPerPixel = QImage::toPixelFormat(format).bitsPerPixel();
+    const qint64 bytesPerLine = ((qint64(size.width()) * bitsPerPixel + 31) / 32) * 4; // 32-bit aligned scanlines
+    uchar* block = acquireBlock(bytesPerLine * size.height());
+    if (!block) {
+        return QImage(); // Out of memory: callers handle a null image
+    }
+    return QImage(block + BLOCK_ALIGNMENT, size.width(), size.height(), bytesPerLine, format,
+                  &PixelBufferPool::releaseImageBuffer, block);
+}
+
+/**
+ * @brief Sets how many bytes of released blocks the pool may keep for reuse.
+ *
+ * Shrinking the bound below the current content empties the free lists.
+ *
+ * @param bytes The maximum number of cached bytes.
+ */
+void PixelBufferPool::setMaxCachedBytes(qint64 bytes) {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxCachedBytes = qMax<qint64>(0, bytes);
+        if (m_cachedBytes <= m_maxCachedBytes) {
+            return;
+        }
+    }
+    trim();
+}
+
+/**
+ * @brief Returns how many bytes of released blocks the pool may keep for reuse.
+ * @return The maximum number of cached bytes.
+ */
+qint64 PixelBufferPool::maxCachedBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_maxCachedBytes;
+}
+
+/**
+ * @brief Returns how many bytes are currently held in the free lists.
+ * @return The cached bytes.
+ */
+qint64 PixelBufferPool::cachedBytes() const {
+    QMutexLocker locker(&m_mutex);
+    return m_cachedBytes;
+}
+
+/**
+ * @brief Frees every block held in the free lists.
+ */
+void PixelBufferPool::trim() {
+    QHash<qint64, QVector<uchar*>> freeLists;
+    {
+        QMutexLocker locker(&m_mutex);
+        freeLists.swap(m_freeLists);
+        m_cachedBytes = 0;
+    }
+    for (const QVector<uchar*>& blocks : std::as_const(freeLists)) {
+        for (uchar* block : blocks) {
+            freeBlock(block);
+        }
+    }
+}
+
+/**
+ * @brief Rounds a request up to its size class.
+ *
+ * The classes between two powers of two P/2 and P are spaced P/8 apart.
+ *
+ * @param bytes The requested number of bytes.
+ * @return The capacity of the size class.
+ */
+qint64 PixelBufferPool::sizeClassFor(qint64 bytes) {
+    if (bytes <= MIN_SIZE_CLASS) {
+        return MIN_SIZE_CLASS;
+    }
+    const qint64 powerOfTwo = qint64(qNextPowerOfTwo(quint64(bytes - 1))); // Smallest power of two >= bytes
+    const qint64 step = powerOfTwo / 8;
+    return ((bytes + step - 1) / step) * step;
+}
+
+/**
+ * @brief Takes a block of at least `bytes` from the free lists or the system.
+ * @param bytes The requested number of bytes (pixel data only).
+ * @return The start of the block (header included), or nullptr if the system is out of memory.
+ */
+uchar* PixelBufferPool::acquireBlock(qint64 bytes) {
+    const qint64 capacity = sizeClassFor(bytes);
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_freeLists.find(capacity);
+        if (it != m_freeLists.end() && !it->isEmpty()) {
+            uchar* block = it->takeLast();
+            m_cachedBytes -= capacity;
+            return block;
+        }
+    }
+    uchar* block = allocateBlock(capacity);
+    if (!block && cachedBytes() > 0) {
+        trim(); // Blocks of other size classes may be what stands in the way
+        block = allocateBlock(capacity);
+    }
+    return block;
+}
+
+/**
+ * @brief Returns a block to its free list, or to the system if the pool is full.
+ * @param block The start of the block (header included).
+ */
+void PixelBufferPool::releaseBlock(uchar* block) {
+    const qint64 capacity = reinterpret_cast<const BlockHeader*>(block)->capacity;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_cachedBytes + capacity <= m_maxCachedBytes) {
+            m_freeLists[capacity].append(block);
+            m_cachedBytes += capacity;
+            return;
+        }
+    }
+    freeBlock(block);
+}
+
+/**
+ * @brief QImage cleanup function: recycles the block passed as `info`.
+ *
+ * Images can outlive the pool at application exit; their blocks are then
+ * freed directly.
+ *
+ * @param info The start of the block (header included).
+ */
+void PixelBufferPool::releaseImageBuffer(void* info) {
+    uchar* block = static_cast<uchar*>(info);
+    if (PixelBufferPool* pool = instance()) {
+        pool->releaseBlock(block);
+    } else {
+        freeBlock(block);
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * @file pixelbufferpool.h
+ * @brief Declaration of the PixelBufferPool class, a size-classed pool of pixel buffers.
+ *
+ * This file defines the PixelBufferPool class, which hands out QImage objects
+ * whose pixel memory comes from a pool of recycled blocks instead of a fresh
+ * allocation. When the last copy of such an image is destroyed (for example
+ * when it is evicted from the ImageCache), its block goes back to the pool.
+ */
+#ifndef IMAGELOADERLIB_PIXELBUFFERPOOL_H
+#define IMAGELOADERLIB_PIXELBUFFERPOOL_H
+
+#include <QHash>   // For the per-size-class free lists
+#include <QImage>  // For the images built over pooled memory
+#include <QMutex>  // For thread-safe access from the decode workers
+#include <QSize>   // For image dimensions
+#include <QVector> // For the free lists
+
+/**
+ * @brief A process-wide pool of reusable, 64-byte aligned pixel buffers.
+ *
+ * Requests are rounded up to a size class; classes are spaced at one eighth
+ * of the enclosing power of two, so at most 12.5% of a block is wasted.
+ * Released blocks are kept in a free list per class up to a total of
+ * `maxCachedBytes()`; anything beyond that is returned to the system.
+ *
+ * All methods are thread-safe.
+ */
+class PixelBufferPool {
+public:
+    /**
+     * @brief Returns the process-wide pool.
+     * @return The pool, or nullptr during static destruction at exit.
+     */
+    static PixelBufferPool* instance();
+
+    /**
+     * @brief Constructs an empty pool.
+     */
+    PixelBufferPool();
+
+    /**
+     * @brief Destroys the pool and frees every cached block.
+     */
+    ~PixelBufferPool();
+
+    /**
+     * @brief Creates an uninitialised image whose pixels live in a pooled block.
+     *
+     * The returned QImage owns the block through a cleanup function: once the
+     * last shallow copy is destroyed the block is recycled. A deep copy made by
+     * QImage's copy-on-write uses ordinary memory.
+     *
+     * @param size The image dimensions.
+     * @param format The pixel format.
+     * @return The image, or a null QImage if `size` or `format` is invalid or no memory is left.
+     */
+    QImage createImage(const QSize& size, QImage::Format format);
+
+    /**
+     * @brief Sets how many bytes of released blocks the pool may keep for reuse.
+     * @param bytes The maximum number of cached bytes.
+     */
+    void setMaxCachedBytes(qint64 bytes);
+
+    /**
+     * @brief Returns how many bytes of released blocks the pool may keep for reuse.
+     * @return The maximum number of cached bytes.
+     */
+    qint64 maxCachedBytes() const;
+
+    /**
+     * @brief Returns how many bytes are currently held in the free lists.
+     * @return The cached bytes.
+     */
+    qint64 cachedBytes() const;
+
+    /**
+     * @brief Frees every block held in the free lists.
+     */
+    void trim();
+
+private:
+    /**
+     * @brief Rounds a request up to its size class.
+     * @param bytes The requested number of bytes.
+     * @return The capacity of the size class.
+     */
+    static qint64 sizeClassFor(qint64 bytes);
+
+    /**
+     * @brief Takes a block of at least `bytes` from the free lists or the system.
+     * @param bytes The requested number of bytes (pixel data only).
+     * @return The start of the block (header included), or nullptr if the system is out of memory.
+     */
+    uchar* acquireBlock(qint64 bytes);
+
+    /**
+     * @brief Returns a block to its free list, or to the system if the pool is full.
+     * @param block The start of the block (header included).
+     */
+    void releaseBlock(uchar* block);
+
+    /**
+     * @brief QImage cleanup function: recycles the block passed as `info`.
+     * @param info The start of the block (header included).
+     */
+    static void releaseImageBuffer(void* info);
+
+    mutable QMutex m_mutex;                     ///< Guards the free lists and counters.
+    QHash<qint64, QVector<uchar*>> m_freeLists; ///< Free blocks keyed by size-class capacity.
+    qint64 m_cachedBytes;                       ///< Bytes currently held in the free lists.
+    qint64 m_maxCachedBytes;                    ///< Upper bound for m_cachedBytes.
+};
+
+#endif // IMAGELOADERLIB_PIXELBUFFERPOOL_H
@@ -0,0 +1,540 @@
+/**
+ * @file pixelkernels.cpp
+ * @brief Implementation of the PixelKernels class.
+ *
+ * The kernels are written once, as templates over the source format, the
+ * destination format and the filter, and instantiated by an "ISA" struct
+ * per instruction set. The ISA structs only differ in the target attribute
+ * of their member templates, so the compiler vectorises the same loops for
+ * SSE4.1 and AVX2; a table of function pointers for the running CPU is
+ * built on first use.
+ */
+#include "pixelkernels.h"
+#include <QRgba64> // For the 16-bit-per-channel sources
+#include <QVector> // For the per-column lookup tables
+#include <algorithm> // For std::fill
+#include <limits>    // For the range of the column sums
+#include <utility>   // For std::integer_sequence
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define PIXELKERNELS_X86_DISPATCH 1
+#else
+#  define PIXELKERNELS_X86_DISPATCH 0
+#endif
+
+namespace {
+/**
+ * @brief Divides a 16-bit channel value by 257 with rounding, giving its 8-bit value.
+ */
+Q_ALWAYS_INLINE quint32 div257(quint32 value) {
+    return (value + 128 - ((value + 128) >> 8)) >> 8;
+}
+
+/**
+ * @brief Packs 8-bit channels into an ARGB32 value.
+ */
+Q_ALWAYS_INLINE QRgb packArgb(quint32 a, quint32 r, quint32 g, quint32 b) {
+    return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+/**
+ * @brief Reads pixel `x` of a scanline in format `Src` as premultiplied ARGB32.
+ *
+ * Opaque formats return fully opaque pixels, for which premultiplied and
+ * straight values are the same. `palette` is only used by Format_Indexed8,
+ * and must then hold 256 premultiplied entries.
+ */
+template <QImage::Format Src>
+struct SourcePixel;
+
+template <>
+struct SourcePixel<QImage::Format_Grayscale8> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return 0xff000000u | (quint32(line[x]) * 0x010101u);
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_Grayscale16> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return 0xff000000u | (div257(reinterpret_cast<const quint16*>(line)[x]) * 0x010101u);
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_Indexed8> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb* palette) {
+        return palette[line[x]];
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGB888> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        const uchar* p = line + 3 * x;
+        return packArgb(0xff, p[0], p[1], p[2]);
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_BGR888> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        const uchar* p = line + 3 * x;
+        return packArgb(0xff, p[2], p[1], p[0]);
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGB32> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return reinterpret_cast<const QRgb*>(line)[x] | 0xff000000u;
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_ARGB32> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return qPremultiply(reinterpret_cast<const QRgb*>(line)[x]); // Branch-free in Qt
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_ARGB32_Premultiplied> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return reinterpret_cast<const QRgb*>(line)[x];
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGBX8888> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        const uchar* p = line + 4 * x; // Byte order R, G, B, X on every platform
+        return packArgb(0xff, p[0], p[1], p[2]);
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGBA8888> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        const uchar* p = line + 4 * x;
+        return qPremultiply(packArgb(p[3], p[0], p[1], p[2]));
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGBA8888_Premultiplied> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        const uchar* p = line + 4 * x;
+        return packArgb(p[3], p[0], p[1], p[2]);
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGBX64> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return reinterpret_cast<const QRgba64*>(line)[x].toArgb32() | 0xff000000u;
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGBA64> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return qPremultiply(reinterpret_cast<const QRgba64*>(line)[x].toArgb32());
+    }
+};
+
+template <>
+struct SourcePixel<QImage::Format_RGBA64_Premultiplied> {
+    static Q_ALWAYS_INLINE QRgb load(const uchar* line, int x, const QRgb*) {
+        return reinterpret_cast<const QRgba64*>(line)[x].toArgb32();
+    }
+};
+
+/**
+ * @brief Turns a premultiplied ARGB32 value into a pixel of format `Dst`.
+ */
+template <QImage::Format Dst>
+struct DestinationPixel;
+
+template <>
+struct DestinationPixel<QImage::Format_RGB32> {
+    static Q_ALWAYS_INLINE QRgb store(QRgb pixel) {
+        return pixel | 0xff000000u; // Format_RGB32 requires the unused byte to be 0xff
+    }
+};
+
+template <>
+struct DestinationPixel<QImage::Format_ARGB32_Premultiplied> {
+    static Q_ALWAYS_INLINE QRgb store(QRgb pixel) {
+        return pixel;
+    }
+};
+
+/**
+ * @brief Converts one scanline from `Src` to `Dst`.
+ */
+template <QImage::Format Src, QImage::Format Dst>
+Q_ALWAYS_INLINE void convertRowImpl(const uchar* source, QRgb* target, int width, const QRgb* palette) {
+    for (int x = 0; x < width; ++x) {
+        target[x] = DestinationPixel<Dst>::store(SourcePixel<Src>::load(source, x, palette));
+    }
+}
+
+/**
+ * @brief Number of EXIF orientations, i.e. of QImageIOHandler::Transformations values.
+ */
+constexpr int ORIENTATION_COUNT = 8;
+
+/**
+ * @brief Where the pixels of a reduced image land in its oriented target.
+ *
+ * Pixel (x, y) of the result in decoded orientation is written at
+ * `row(y)[x * xStep()]`. Mirroring and flipping reverse a direction;
+ * rotating by 90 degrees transposes the addressing, so consecutive `x` go
+ * down a column of the target. Qt's order is kept: mirror and flip first,
+ * then rotate clockwise.
+ */
+template <int Orientation>
+struct OutputAddressing {
+    static constexpr bool Mirror = (Orientation & QImageIOHandler::TransformationMirror) != 0;
+    static constexpr bool Flip = (Orientation & QImageIOHandler::TransformationFlip) != 0;
+    static constexpr bool Rotate = (Orientation & QImageIOHandler::TransformationRotate90) != 0;
+
+    /**
+     * @brief Sets up the addressing of `target`, whose size is the oriented one.
+     */
+    explicit OutputAddressing(QImage& target)
+        : width(Rotate ? target.height() : target.width()),
+        height(Rotate ? target.width() : target.height())
+    {
+        const qptrdiff stride = target.bytesPerLine() / qptrdiff(sizeof(QRgb));
+        QRgb* base = reinterpret_cast<QRgb*>(target.bits());
+        if (Rotate) {
+            origin = base + (Mirror ? (width - 1) * stride : 0) + (Flip ? 0 : height - 1);
+            columnStep = Mirror ? -stride : stride;
+            rowStep = Flip ? 1 : -1;
+        } else {
+            origin = base + (Flip ? (height - 1) * stride : 0) + (Mirror ? width - 1 : 0);
+            columnStep = Mirror ? -1 : 1;
+            rowStep = Flip ? -stride : stride;
+        }
+    }
+
+    /**
+     * @brief Returns the address of pixel (0, y) in decoded orientation.
+     */
+    Q_ALWAYS_INLINE QRgb* row(int y) const {
+        return origin + y * rowStep;
+    }
+
+    /**
+     * @brief Returns the distance between pixels (x, y) and (x + 1, y); a constant unless rotating.
+     */
+    Q_ALWAYS_INLINE qptrdiff xStep() const {
+        return Rotate ? columnStep : (Mirror ? -1 : 1);
+    }
+
+    int width;          ///< Width of the result in decoded orientation.
+    int height;         ///< Height of the result in decoded orientation.
+    QRgb* origin;       ///< Address of pixel (0, 0).
+    qptrdiff columnStep; ///< Distance between horizontally adjacent pixels.
+    qptrdiff rowStep;   ///< Distance between vertically adjacent pixels.
+};
+
+/**
+ * @brief Downscales a 32-bit image with filter `F`, writing it in the given orientation.
+ */
+template <PixelKernels::Filter F>
+struct Downscaler;
+
+/**
+ * @brief Nearest neighbour: reads the source pixel at the centre of the covered block.
+ *
+ * A fraction of the cost of the box filter on large reductions, at the price of aliasing.
+ */
+template <>
+struct Downscaler<PixelKernels::PointFilter> {
+    template <int Orientation>
+    static Q_ALWAYS_INLINE void run(const QImage& source, QImage& target) {
+        const OutputAddressing<Orientation> output(target);
+        const int sw = source.width();
+        const int sh = source.height();
+        const int dw = output.width;
+        const int dh = output.height;
+        const qptrdiff step = output.xStep();
+
+        QVector<int> column(dw);
+        for (int x = 0; x < dw; ++x) {
+            column[x] = int((qint64(x) * 2 + 1) * sw / (2 * qint64(dw))); // Centre of the covered block
+        }
+        const int* columns = column.constData();
+        for (int y = 0; y < dh; ++y) {
+            const int sy = int((qint64(y) * 2 + 1) * sh / (2 * qint64(dh)));
+            const QRgb* sourceLine = reinterpret_cast<const QRgb*>(source.constScanLine(sy));
+            QRgb* targetLine = output.row(y);
+            for (int x = 0; x < dw; ++x) {
+                targetLine[x * step] = sourceLine[columns[x]];
+            }
+        }
+    }
+};
+
+/**
+ * @brief Area average: every destination pixel is the mean of the source pixels it covers.
+ *
+ * A plain average in gamma-encoded space, without sharpening; it is not
+ * meant to match QImage::scaled() pixel for pixel. Source rows are first
+ * summed per source column, in a loop the compiler vectorises, and then per
+ * destination column.
+ *
+ * The column sums are 32-bit, which keeps that loop fast, as long as a band
+ * has few enough rows for 255 times their number to fit; taller bands (a
+ * reduction by more than 16 million rows) switch to 64-bit column sums.
+ * The per-destination sums are always 64-bit: a pixel may cover the whole
+ * source.
+ */
+template <>
+struct Downscaler<PixelKernels::BoxFilter> {
+    template <int Orientation>
+    static Q_ALWAYS_INLINE void run(const QImage& source, QImage& target) {
+        const int bands = OutputAddressing<Orientation>::Rotate ? target.width() : target.height(); // Rows in decoded orientation
+        const qint64 maxBandRows = (qint64(source.height()) + bands - 1) / qMax(1, bands) + 1;
+        if (maxBandRows <= qint64(std::numeric_limits<quint32>::max() / 255)) {
+            runWith<quint32, Orientation>(source, target);
+        } else {
+            runWith<quint64, Orientation>(source, target);
+        }
+    }
+
+    template <typename ColumnSum, int Orientation>
+    static Q_ALWAYS_INLINE void runWith(const QImage& source, QImage& target) {
+        const OutputAddressing<Orientation> output(target);
+        const int sw = source.width();
+        const int sh = source.height();
+        const int dw = output.width;
+        const int dh = output.height;
+        const qptrdiff step = output.xStep();
+
+        QVector<int> columnStart(dw + 1);
+        for (int x = 0; x <= dw; ++x) {
+            columnStart[x] = int(qint64(x) * sw / dw);
+        }
+        // Channel sums of the current band of rows, one set per source column
+        QVector<ColumnSum> columnSums(qsizetype(sw) * 4);
+        ColumnSum* sums = columnSums.data();
+
+        for (int y = 0; y < dh; ++y) {
+            const int y0 = int(qint64(y) * sh / dh);
+            const int y1 = qMax(y0 + 1, int(qint64(y + 1) * sh / dh));
+            std::fill(columnSums.begin(), columnSums.end(), ColumnSum(0));
+
+            for (int sy = y0; sy < y1; ++sy) {
+                const QRgb* sourceLine = reinterpret_cast<const QRgb*>(source.constScanLine(sy));
+                for (int sx = 0; sx < sw; ++sx) {
+                    const QRgb pixel = sourceLine[sx];
+                    sums[4 * sx + 0] += pixel >> 24;
+                    sums[4 * sx + 1] += (pixel >> 16) & 0xff;
+                    sums[4 * sx + 2] += (pixel >> 8) & 0xff;
+                    sums[4 * sx + 3] += pixel & 0xff;
+                }
+            }
+
+            QRgb* targetLine = output.row(y);
+            for (int x = 0; x < dw; ++x) {
+                const int x0 = columnStart[x];
+                const int x1 = qMax(x0 + 1, columnStart[x + 1]);
+                quint64 a = 0, r = 0, g = 0, b = 0;
+                for (int sx = x0; sx < x1; ++sx) {
+                    a += sums[4 * sx + 0];
+                    r += sums[4 * sx + 1];
+                    g += sums[4 * sx + 2];
+                    b += sums[4 * sx + 3];
+                }
+                const quint64 count = quint64(y1 - y0) * quint64(x1 - x0);
+                targetLine[x * step] = packArgb(quint32(a / count), quint32(r / count), quint32(g / count), quint32(b / count));
+            }
+        }
+    }
+};
+
+/**
+ * @brief Instantiates every kernel with the given function attributes.
+ *
+ * The kernels are always inlined into these entry points, so they are
+ * compiled (and vectorised) for the entry point's instruction set.
+ */
+#define PIXELKERNELS_DEFINE_ISA(Name, Attributes) \
+    struct Name { \
+        template <QImage::Format Src, QImage::Format Dst> \
+        Attributes static void convertRow(const uchar* source, QRgb* target, int width, const QRgb* palette) { \
+            convertRowImpl<Src, Dst>(source, target, width, palette); \
+        } \
+        template <PixelKernels::Filter F, int Orientation> \
+        Attributes static void downscale(const QImage& source, QImage& target) { \
+            Downscaler<F>::template run<Orientation>(source, target); \
+        } \
+    };
+
+PIXELKERNELS_DEFINE_ISA(BaselineIsa, )
+#if PIXELKERNELS_X86_DISPATCH
+PIXELKERNELS_DEFINE_ISA(Sse41Isa, __attribute__((target("sse4.1"))))
+PIXELKERNELS_DEFINE_ISA(Avx2Isa, __attribute__((target("avx2"))))
+#endif
+
+/**
+ * @brief Converts one scanline; the palette is only read for Indexed8 sources.
+ */
+using ConvertRowFunction = void (*)(const uchar* source, QRgb* target, int width, const QRgb* palette);
+
+/**
+ * @brief Downscales a whole image.
+ */
+using DownscaleFunction = void (*)(const QImage& source, QImage& target);
+
+/**
+ * @brief The kernels of one instruction set, indexed by source format, filter and orientation.
+ */
+struct KernelTable {
+    const char* name;                                                   ///< Name of the instruction set.
+    ConvertRowFunction toRgb32[QImage::NImageFormats];                  ///< Kernels to Format_RGB32, or nullptr.
+    ConvertRowFunction toArgb32Premultiplied[QImage::NImageFormats];    ///< Kernels to Format_ARGB32_Premultiplied, or nullptr.
+    DownscaleFunction downscale[PixelKernels::FilterCount][ORIENTATION_COUNT]; ///< Kernels per filter and orientation.
+};
+
+/**
+ * @brief Registers the conversions from `Src` to both destination formats.
+ */
+template <typename Isa, QImage::Format Src>
+void registerSource(KernelTable& table) {
+    table.toRgb32[Src] = &Isa::template convertRow<Src, QImage::Format_RGB32>;
+    table.toArgb32Premultiplied[Src] = &Isa::template convertRow<Src, QImage::Format_ARGB32_Premultiplied>;
+}
+
+/**
+ * @brief Registers the downscales with filter `F` for every orientation.
+ */
+template <typename Isa, PixelKernels::Filter F, int... Orientations>
+void registerFilter(KernelTable& table, std::integer_sequence<int, Orientations...>) {
+    ((table.downscale[F][Orientations] = &Isa::template downscale<F, Orientations>), ...);
+}
+
+/**
+ * @brief Builds the kernel table of an instruction set.
+ */
+template <typename Isa>
+KernelTable makeKernelTable(const char* name) {
+    KernelTable table = {};
+    table.name = name;
+    registerSource<Isa, QImage::Format_Grayscale8>(table);
+    registerSource<Isa, QImage::Format_Grayscale16>(table);
+    registerSource<Isa, QImage::Format_Indexed8>(table);
+    registerSource<Isa, QImage::Format_RGB888>(table);
+    registerSource<Isa, QImage::Format_BGR888>(table);
+    registerSource<Isa, QImage::Format_RGB32>(table);
+    registerSource<Isa, QImage::Format_ARGB32>(table);
+    registerSource<Isa, QImage::Format_ARGB32_Premultiplied>(table);
+    registerSource<Isa, QImage::Format_RGBX8888>(table);
+    registerSource<Isa, QImage::Format_RGBA8888>(table);
+    registerSource<Isa, QImage::Format_RGBA8888_Premultiplied>(table);
+    registerSource<Isa, QImage::Format_RGBX64>(table);
+    registerSource<Isa, QImage::Format_RGBA64>(table);
+    registerSource<Isa, QImage::Format_RGBA64_Premultiplied>(table);
+    registerFilter<Isa, PixelKernels::PointFilter>(table, std::make_integer_sequence<int, ORIENTATION_COUNT>());
+    registerFilter<Isa, PixelKernels::BoxFilter>(table, std::make_integer_sequence<int, ORIENTATION_COUNT>());
+    return table;
+}
+
+/**
+ * @brief Picks the best kernel table for the running CPU.
+ */
+KernelTable selectKernelTable() {
+#if PIXELKERNELS_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return makeKernelTable<Avx2Isa>("avx2");
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return makeKernelTable<Sse41Isa>("sse4.1");
+    }
+#endif
+    return makeKernelTable<BaselineIsa>("baseline");
+}
+
+/**
+ * @brief Returns the kernel table of the running CPU, selected on first use.
+ */
+const KernelTable& kernelTable() {
+    static const KernelTable table = selectKernelTable(); // Thread-safe initialisation
+    return table;
+}
+}
+
+/**
+ * @brief Tells whether a format can be converted by convert().
+ *
+ * @param format The source format.
+ * @return True if a kernel exists for it.
+ */
+bool PixelKernels::canConvert(QImage::Format format) {
+    return format > QImage::Format_Invalid && format < QImage::NImageFormats
+           && kernelTable().toRgb32[format] != nullptr;
+}
+
+/**
+ * @brief Converts `source` into `target`, which must have the same size.
+ *
+ * @param source The image to convert, in a format accepted by canConvert().
+ * @param target The destination, in Format_RGB32 or Format_ARGB32_Premultiplied.
+ * @return False, leaving `target` untouched, if no kernel handles the pair of formats.
+ */
+bool PixelKernels::convert(const QImage& source, QImage& target) {
+    if (source.isNull() || source.size() != target.size() || !canConvert(source.format())) {
+        return false;
+    }
+    const KernelTable& table = kernelTable();
+    ConvertRowFunction convertRow = nullptr;
+    if (target.format() == QImage::Format_RGB32) {
+        convertRow = table.toRgb32[source.format()];
+    } else if (target.format() == QImage::Format_ARGB32_Premultiplied) {
+        convertRow = table.toArgb32Premultiplied[source.format()];
+    } else {
+        return false;
+    }
+
+    // Indexed images: premultiply the colour table once, padded so any index is valid
+    QRgb palette[256];
+    if (source.format() == QImage::Format_Indexed8) {
+        const QList<QRgb> colors = source.colorTable();
+        for (int i = 0; i < 256; ++i) {
+            palette[i] = i < colors.size() ? qPremultiply(colors.at(i)) : 0xff000000u;
+        }
+    }
+
+    const int width = source.width();
+    for (int y = 0; y < source.height(); ++y) {
+        convertRow(source.constScanLine(y), reinterpret_cast<QRgb*>(target.scanLine(y)), width, palette);
+    }
+    return true;
+}
+
+/**
+ * @brief Downscales `source` into `target`, applying an EXIF orientation on the way.
+ *
+ * @param source The image to reduce, as decoded.
+ * @param target The destination; its size is the oriented size of the result.
+ * @param filter The filter to reduce with.
+ * @param orientation The orientation to apply.
+ */
+void PixelKernels::downscale(const QImage& source, QImage& target, Filter filter,
+                             QImageIOHandler::Transformations orientation) {
+    kernelTable().downscale[filter][int(orientation) & (ORIENTATION_COUNT - 1)](source, target);
+}
+
+/**
+ * @brief Returns the name of the instruction set the kernels run with.
+ *
+ * @return "avx2", "sse4.1" or "baseline".
+ */
+const char* PixelKernels::instructionSet() {
+    return kernelTable().name;
+}
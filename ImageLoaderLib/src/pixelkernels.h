@@ -0,0 +1,96 @@
+/**
+ * @file pixelkernels.h
+ * @brief Declaration of the PixelKernels class, the pixel loops of the decode and scale stages.
+ *
+ * This file defines the PixelKernels class, which converts decoded images to
+ * the fast-blit formats and downscales them. Every kernel is a template
+ * instantiated per source format, destination format and filter, so that its
+ * inner loop has no per-pixel branch on any of them; downscales also take the
+ * EXIF orientation as a template parameter. Each kernel is compiled
+ * for several instruction sets and the best one for the running CPU is picked
+ * once, at first use.
+ */
+#ifndef IMAGELOADERLIB_PIXELKERNELS_H
+#define IMAGELOADERLIB_PIXELKERNELS_H
+
+#include <QImage>          // For the images the kernels work on
+#include <QImageIOHandler> // For EXIF orientations
+
+/**
+ * @brief Format conversion and downscale kernels with runtime instruction set dispatch.
+ *
+ * Supported sources are the formats Qt's decoders produce: Grayscale8,
+ * Grayscale16, Indexed8, RGB888, BGR888, RGB32, ARGB32, ARGB32_Premultiplied,
+ * RGBX8888, RGBA8888, RGBA8888_Premultiplied, RGBX64, RGBA64 and
+ * RGBA64_Premultiplied. Destinations are Format_RGB32 and
+ * Format_ARGB32_Premultiplied.
+ *
+ * On x86 with GCC or Clang, kernels are built for the baseline instruction
+ * set, SSE4.1 and AVX2; elsewhere only the baseline is built.
+ *
+ * All methods are thread-safe.
+ */
+class PixelKernels {
+public:
+    /**
+     * @brief The downscale filters.
+     */
+    enum Filter {
+        PointFilter, ///< Nearest neighbour: one source pixel per destination pixel.
+        BoxFilter,   ///< Area average over the block of source pixels each destination pixel covers.
+        FilterCount  ///< Number of filters.
+    };
+
+    /**
+     * @brief Tells whether a format can be converted by convert().
+     *
+     * @param format The source format.
+     * @return True if a kernel exists for it.
+     */
+    static bool canConvert(QImage::Format format);
+
+    /**
+     * @brief Converts `source` into `target`, which must have the same size.
+     *
+     * @param source The image to convert, in a format accepted by canConvert().
+     * @param target The destination, in Format_RGB32 or Format_ARGB32_Premultiplied.
+     * @return False, leaving `target` untouched, if no kernel handles the pair of formats.
+     */
+    static bool convert(const QImage& source, QImage& target);
+
+    /**
+     * @brief Downscales `source` into `target`, applying an EXIF orientation on the way.
+     *
+     * Both images must be in the same format, Format_RGB32 or
+     * Format_ARGB32_Premultiplied. Averaging is done on premultiplied (or
+     * opaque) values, so it is correct for alpha too.
+     *
+     * The orientation costs nothing extra: the kernel writes each result
+     * pixel straight to its oriented position. `target` therefore has the
+     * oriented size (width and height swapped for 90 and 270 degree
+     * rotations) and, once un-rotated, must not be larger than `source` in
+     * either dimension.
+     *
+     * @param source The image to reduce, as decoded.
+     * @param target The destination; its size is the oriented size of the result.
+     * @param filter The filter to reduce with.
+     * @param orientation The orientation to apply, as read from the file.
+     */
+    static void downscale(const QImage& source, QImage& target, Filter filter,
+                          QImageIOHandler::Transformations orientation = QImageIOHandler::TransformationNone);
+
+    /**
+     * @brief Returns the name of the instruction set the kernels run with.
+     *
+     * @return "avx2", "sse4.1" or "baseline".
+     */
+    static const char* instructionSet();
+
+private:
+    /**
+     * @brief Not instantiable: the kernels are static.
+     */
+    PixelKernels() = delete;
+};
+
+#endif // IMAGELOADERLIB_PIXELKERNELS_H
@@ -0,0 +1,126 @@
+/**
+ * @file placeholderrenderer.cpp
+ * @brief Implementation of the PlaceholderRenderer class.
+ */
+#include "placeholderrenderer.h"
+#include "pixelbufferpool.h" // For the images returned by render()
+#include <QFont>             // For the digit font
+#include <QFontMetrics>      // For the glyph advances
+#include <QPainter>          // For rasterizing the atlas and composing placeholders
+#include <QRectF>            // For the scaled glyph rectangles
+
+namespace {
+/**
+ * @brief Number of distinct glyphs in the atlas: the decimal digits.
+ */
+constexpr int DIGIT_COUNT = 10;
+}
+
+/**
+ * @brief Constructs the renderer and rasterizes the glyph atlas.
+ *
+ * The digits use the look placeholders always had: white, bold 72 pt Arial,
+ * antialiased, over a dark gray background.
+ *
+ * @param previewSize The size of a full placeholder; glyphs are scaled relative to it.
+ */
+PlaceholderRenderer::PlaceholderRenderer(const QSize& previewSize)
+    : m_previewSize(previewSize),
+    m_background(QStringLiteral("#444444")), // Un bel grigio scuro
+    m_cellWidth(0)
+{
+    const QFont font("Arial", 72, QFont::Bold);
+    const QImage probe(1, 1, QImage::Format_ARGB32_Premultiplied);
+    const QFontMetrics metrics(font, &probe); // Metrics for an image, not for the screen
+
+    for (int digit = 0; digit < DIGIT_COUNT; ++digit) {
+        m_advances[digit] = metrics.horizontalAdvance(QChar('0' + digit));
+        m_cellWidth = qMax(m_cellWidth, metrics.boundingRect(QChar('0' + digit)).right() + 1);
+        m_cellWidth = qMax(m_cellWidth, m_advances[digit]);
+    }
+
+    m_atlas = QImage(m_cellWidth * DIGIT_COUNT, metrics.height(), QImage::Format_ARGB32_Premultiplied);
+    m_atlas.fill(Qt::transparent);
+    QPainter painter(&m_atlas);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::white);
+    painter.setFont(font);
+    for (int digit = 0; digit < DIGIT_COUNT; ++digit) {
+        painter.drawText(QPoint(digit * m_cellWidth, metrics.ascent()), QString(QChar('0' + digit)));
+    }
+}
+
+/**
+ * @brief Returns the size of a full placeholder.
+ * @return The reference preview size.
+ */
+QSize PlaceholderRenderer::previewSize() const {
+    return m_previewSize;
+}
+
+/**
+ * @brief Returns the background colour of the placeholders.
+ * @return The shared background colour.
+ */
+QColor PlaceholderRenderer::background() const {
+    return m_background;
+}
+
+/**
+ * @brief Paints the placeholder for an ID into a rectangle.
+ *
+ * @param painter The painter to draw with.
+ * @param target The rectangle covered by the placeholder.
+ * @param id The ID whose number is drawn.
+ */
+void PlaceholderRenderer::paint(QPainter* painter, const QRect& target, int id) const {
+    painter->fillRect(target, m_background);
+    if (id < 0 || target.isEmpty() || m_atlas.isNull()) {
+        return;
+    }
+
+    // Glyphs keep the proportion they have on a full placeholder
+    qreal scale = 1.0;
+    if (!m_previewSize.isEmpty()) {
+        scale = qMin(qreal(target.width()) / m_previewSize.width(), qreal(target.height()) / m_previewSize.height());
+    }
+
+    const QByteArray digits = QByteArray::number(id);
+    int textWidth = 0;
+    for (char digit : digits) {
+        textWidth += m_advances[digit - '0'];
+    }
+
+    const qreal glyphHeight = m_atlas.height() * scale;
+    qreal x = target.x() + (target.width() - textWidth * scale) / 2;
+    const qreal y = target.y() + (target.height() - glyphHeight) / 2;
+
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, !qFuzzyCompare(scale, 1.0));
+    for (char digit : digits) {
+        const int index = digit - '0';
+        const QRectF source(index * m_cellWidth, 0, m_cellWidth, m_atlas.height());
+        painter->drawImage(QRectF(x, y, m_cellWidth * scale, glyphHeight), m_atlas, source);
+        x += m_advances[index] * scale;
+    }
+    painter->restore();
+}
+
+/**
+ * @brief Renders the placeholder for an ID into a new image.
+ *
+ * @param id The ID whose number is drawn.
+ * @param size The size of the image; invalid for `previewSize()`.
+ * @return The placeholder image.
+ */
+QImage PlaceholderRenderer::render(int id, const QSize& size) const {
+    const QSize imageSize = size.isValid() ? size : m_previewSize;
+    PixelBufferPool* pool = PixelBufferPool::instance();
+    QImage image = pool ? pool->createImage(imageSize, QImage::Format_RGB32) : QImage(imageSize, QImage::Format_RGB32);
+    if (image.isNull()) {
+        return image;
+    }
+    QPainter painter(&image);
+    paint(&painter, image.rect(), id);
+    return image;
+}
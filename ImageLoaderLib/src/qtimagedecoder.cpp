@@ -0,0 +1,105 @@
+/**
+ * @file qtimagedecoder.cpp
+ * @brief Implementation of the QtImageDecoder class.
+ */
+#include "qtimagedecoder.h"
+#include <QBuffer>      // For reading from memory
+#include <QImageReader> // For Qt's image plugins
+#include <QDebug>       // For debugging output
+
+namespace {
+/**
+ * @brief Wraps the encoded bytes without copying them.
+ *
+ * @param input The encoded image.
+ * @return A QByteArray over the input's memory.
+ */
+QByteArray rawBytes(const ImageDecoder::Input& input) {
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(input.data), qsizetype(input.size));
+}
+}
+
+/**
+ * @brief Returns "Qt".
+ * @return The backend name.
+ */
+QByteArray QtImageDecoder::name() const {
+    return QByteArrayLiteral("Qt");
+}
+
+/**
+ * @brief Returns true: Qt's plugins are asked for anything.
+ *
+ * @param data The encoded bytes.
+ * @param size The number of encoded bytes.
+ * @return True.
+ */
+bool QtImageDecoder::canDecode(const uchar* data, qint64 size) const {
+    Q_UNUSED(data);
+    Q_UNUSED(size);
+    return true;
+}
+
+/**
+ * @brief Parses the header with QImageReader.
+ *
+ * @param input The encoded image.
+ * @param header Receives the dimensions and output format.
+ * @return False if no plugin can read the header.
+ */
+bool QtImageDecoder::readHeader(const Input& input, Header* header) const {
+    QByteArray bytes = rawBytes(input);
+    QBuffer buffer(&bytes);
+    if (!buffer.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QImageReader reader(&buffer, input.format);
+    header->size = reader.size();
+    header->pixelFormat = reader.imageFormat();
+    return header->size.isValid();
+}
+
+/**
+ * @brief Tells whether the plugin for the input scales while decoding (JPEG DCT scaling).
+ *
+ * @param input The encoded image.
+ * @return True if the plugin supports QImageIOHandler::ScaledSize.
+ */
+bool QtImageDecoder::supportsScaledDecode(const Input& input) const {
+    QByteArray bytes = rawBytes(input);
+    QBuffer buffer(&bytes);
+    if (!buffer.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    return QImageReader(&buffer, input.format).supportsOption(QImageIOHandler::ScaledSize);
+}
+
+/**
+ * @brief Decodes the pixels with QImageReader.
+ *
+ * Qt's plugins reuse the image passed to read() when its size and format
+ * match what they are about to produce, so a pooled buffer is filled in
+ * place.
+ *
+ * @param input The encoded image.
+ * @param size The size to decode at.
+ * @param image In: an optional buffer to decode into. Out: the pixels.
+ * @return True on success.
+ */
+bool QtImageDecoder::decode(const Input& input, const QSize& size, QImage* image) const {
+    QByteArray bytes = rawBytes(input);
+    QBuffer buffer(&bytes);
+    if (!buffer.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QImageReader reader(&buffer, input.format);
+    reader.setAutoTransform(false); // The scale stage applies the EXIF orientation for free
+    if (size.isValid() && size != reader.size()) {
+        reader.setScaledSize(size);
+    }
+    if (!reader.read(image)) {
+        qDebug() << "Qt decoder error:" << reader.errorString();
+        return false;
+    }
+    return true;
+}
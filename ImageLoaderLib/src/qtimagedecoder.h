@@ -0,0 +1,62 @@
+/**
+ * @file qtimagedecoder.h
+ * @brief Declaration of the QtImageDecoder class, the decoder built on Qt's image plugins.
+ */
+#ifndef IMAGELOADERLIB_QTIMAGEDECODER_H
+#define IMAGELOADERLIB_QTIMAGEDECODER_H
+
+#include "imagedecoder.h"
+
+/**
+ * @brief Decodes through QImageReader: every format Qt has a plugin for.
+ *
+ * This is the registry's fallback. The format name of the input is passed
+ * to QImageReader so it does not have to probe every plugin; without one it
+ * detects the format from the content.
+ */
+class QtImageDecoder : public ImageDecoder {
+public:
+    /**
+     * @brief Returns "Qt".
+     * @return The backend name.
+     */
+    QByteArray name() const override;
+
+    /**
+     * @brief Returns true: Qt's plugins are asked for anything.
+     *
+     * @param data The encoded bytes.
+     * @param size The number of encoded bytes.
+     * @return True.
+     */
+    bool canDecode(const uchar* data, qint64 size) const override;
+
+    /**
+     * @brief Parses the header with QImageReader.
+     *
+     * @param input The encoded image.
+     * @param header Receives the dimensions and output format.
+     * @return False if no plugin can read the header.
+     */
+    bool readHeader(const Input& input, Header* header) const override;
+
+    /**
+     * @brief Tells whether the plugin for the input scales while decoding (JPEG DCT scaling).
+     *
+     * @param input The encoded image.
+     * @return True if the plugin supports QImageIOHandler::ScaledSize.
+     */
+    bool supportsScaledDecode(const Input& input) const override;
+
+    /**
+     * @brief Decodes the pixels with QImageReader.
+     *
+     * @param input The encoded image.
+     * @param size The size to decode at.
+     * @param image In: an optional buffer to decode into. Out: the pixels.
+     * @return True on success.
+     */
+    bool decode(const Input& input, const QSize& size, QImage* image) const override;
+};
+
+#endif // IMAGELOADERLIB_QTIMAGEDECODER_H
@@ -0,0 +1,347 @@
+/**
+ * @file rawpreviewextractor.cpp
+ * @brief Implementation of the RawPreviewExtractor class.
+ */
+#include "rawpreviewextractor.h"
+#include <QFile>      // For reading RAW files
+#include <QFileInfo>  // For file extensions
+#include <QIODevice>  // For random access to the file
+#include <QSet>       // For the IFDs already visited
+#include <QVector>    // For the IFDs still to visit
+#include <QDebug>     // For debugging output
+
+namespace {
+/**
+ * @brief TIFF tags the extractor reads.
+ */
+enum TiffTag : quint16 {
+    TagCompression = 0x0103,       ///< 6 (old-style JPEG) or 7 (JPEG) for JPEG strips.
+    TagStripOffsets = 0x0111,      ///< Position of the image data.
+    TagOrientation = 0x0112,       ///< EXIF orientation, 1 to 8.
+    TagStripByteCounts = 0x0117,   ///< Length of the image data.
+    TagSubIfds = 0x014A,           ///< Child IFDs (NEF and DNG previews live there).
+    TagJpegOffset = 0x0201,        ///< JPEGInterchangeFormat: position of a JPEG stream.
+    TagJpegLength = 0x0202         ///< JPEGInterchangeFormatLength: its length.
+};
+
+/**
+ * @brief Largest number of IFDs visited in one file; guards against loops in corrupt files.
+ */
+constexpr int MAX_IFDS = 32;
+
+/**
+ * @brief Largest number of entries accepted in one IFD.
+ */
+constexpr int MAX_IFD_ENTRIES = 1024;
+
+/**
+ * @brief Largest number of JPEG markers skipped while looking for the frame header.
+ */
+constexpr int MAX_JPEG_SEGMENTS = 64;
+
+/**
+ * @brief Reads integers of either byte order at given positions of a device.
+ */
+class TiffReader {
+public:
+    /**
+     * @brief Constructs a reader; call readHeader() before anything else.
+     */
+    explicit TiffReader(QIODevice* device)
+        : m_device(device),
+        m_bigEndian(false)
+    {
+    }
+
+    /**
+     * @brief Reads the TIFF header.
+     *
+     * @param firstIfd Receives the offset of IFD0.
+     * @return False if the file is not a TIFF container.
+     */
+    bool readHeader(quint32* firstIfd) {
+        const QByteArray header = bytes(0, 8);
+        if (header.size() != 8) {
+            return false;
+        }
+        if (header.startsWith("II")) {
+            m_bigEndian = false;
+        } else if (header.startsWith("MM")) {
+            m_bigEndian = true;
+        } else {
+            return false;
+        }
+        // 42 for TIFF, CR2 and DNG; Panasonic and Olympus use other magic numbers, not supported here
+        if (u16(header, 2) != 42) {
+            return false;
+        }
+        *firstIfd = u32(header, 4);
+        return true;
+    }
+
+    /**
+     * @brief Reads `length` bytes at `offset`; fewer at the end of the file.
+     */
+    QByteArray bytes(qint64 offset, qint64 length) const {
+        if (offset < 0 || !m_device->seek(offset)) {
+            return QByteArray();
+        }
+        return m_device->read(length);
+    }
+
+    /**
+     * @brief Decodes a 16-bit integer of the file's byte order from a buffer.
+     */
+    quint16 u16(const QByteArray& data, int at) const {
+        const uchar* p = reinterpret_cast<const uchar*>(data.constData()) + at;
+        return m_bigEndian ? quint16((p[0] << 8) | p[1]) : quint16((p[1] << 8) | p[0]);
+    }
+
+    /**
+     * @brief Decodes a 32-bit integer of the file's byte order from a buffer.
+     */
+    quint32 u32(const QByteArray& data, int at) const {
+        const uchar* p = reinterpret_cast<const uchar*>(data.constData()) + at;
+        return m_bigEndian ? (quint32(p[0]) << 24) | (quint32(p[1]) << 16) | (quint32(p[2]) << 8) | p[3]
+                           : (quint32(p[3]) << 24) | (quint32(p[2]) << 16) | (quint32(p[1]) << 8) | p[0];
+    }
+
+    /**
+     * @brief Returns the first value of an IFD entry of type SHORT or LONG.
+     *
+     * @param entry The 12 bytes of the entry.
+     */
+    quint32 value(const QByteArray& entry, int at) const {
+        const quint16 type = u16(entry, at + 2);
+        return type == 3 ? u16(entry, at + 8) : u32(entry, at + 8); // 3 is SHORT, 4 LONG and 13 IFD
+    }
+
+    /**
+     * @brief Returns every value of an IFD entry of type LONG or IFD, inline or not.
+     */
+    QVector<quint32> values(const QByteArray& entry, int at) const {
+        const quint32 count = u32(entry, at + 4);
+        QVector<quint32> result;
+        if (count == 0 || count > MAX_IFDS) {
+            return result;
+        }
+        if (count == 1) {
+            result.append(value(entry, at));
+            return result;
+        }
+        const QByteArray array = bytes(u32(entry, at + 8), qint64(count) * 4);
+        for (int i = 0; i + 4 <= array.size(); i += 4) {
+            result.append(u32(array, i));
+        }
+        return result;
+    }
+
+private:
+    QIODevice* m_device; ///< The file.
+    bool m_bigEndian;    ///< True for "MM" files.
+};
+
+/**
+ * @brief Reads the frame header of a JPEG stream.
+ *
+ * @param device The file.
+ * @param offset Position of the stream.
+ * @param length Length of the stream.
+ * @param preview Receives the size and component count.
+ * @return True if the stream is a baseline, extended or progressive JPEG.
+ */
+bool readJpegFrame(QIODevice* device, qint64 offset, qint64 length, RawPreviewExtractor::Preview* preview) {
+    if (!device->seek(offset) || device->read(2) != QByteArray("\xFF\xD8", 2)) {
+        return false; // No SOI marker
+    }
+    qint64 position = offset + 2;
+    for (int segment = 0; segment < MAX_JPEG_SEGMENTS && position + 4 <= offset + length; ++segment) {
+        if (!device->seek(position)) {
+            return false;
+        }
+        const QByteArray header = device->read(4);
+        if (header.size() != 4 || uchar(header.at(0)) != 0xFF) {
+            return false;
+        }
+        const uchar marker = uchar(header.at(1));
+        const int segmentLength = (uchar(header.at(2)) << 8) | uchar(header.at(3));
+        if (marker == 0xC0 || marker == 0xC1 || marker == 0xC2) {
+            const QByteArray frame = device->read(6); // Precision, height, width, components
+            if (frame.size() != 6) {
+                return false;
+            }
+            const int height = (uchar(frame.at(1)) << 8) | uchar(frame.at(2));
+            const int width = (uchar(frame.at(3)) << 8) | uchar(frame.at(4));
+            preview->size = QSize(width, height);
+            preview->grayscale = uchar(frame.at(5)) == 1;
+            return width > 0 && height > 0;
+        }
+        if ((marker >= 0xC3 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) || marker == 0xDA) {
+            return false; // Lossless or arithmetic-coded frame, or scan data before any frame
+        }
+        position += 2 + segmentLength;
+    }
+    return false;
+}
+
+/**
+ * @brief Maps an EXIF orientation value to Qt's transformations.
+ */
+QImageIOHandler::Transformations transformationFromExif(quint32 orientation) {
+    switch (orientation) {
+    case 2: return QImageIOHandler::TransformationMirror;
+    case 3: return QImageIOHandler::TransformationRotate180;
+    case 4: return QImageIOHandler::TransformationFlip;
+    case 5: return QImageIOHandler::TransformationFlipAndRotate90;
+    case 6: return QImageIOHandler::TransformationRotate90;
+    case 7: return QImageIOHandler::TransformationMirrorAndRotate90;
+    case 8: return QImageIOHandler::TransformationRotate270;
+    default: return QImageIOHandler::TransformationNone;
+    }
+}
+}
+
+/**
+ * @brief Tells whether a file is a supported RAW format, by its extension.
+ *
+ * @param path The file.
+ * @return True for .cr2, .nef, .arw and .dng files.
+ */
+bool RawPreviewExtractor::isRawFile(const QString& path) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    return suffix == QLatin1String("cr2") || suffix == QLatin1String("nef")
+           || suffix == QLatin1String("arw") || suffix == QLatin1String("dng");
+}
+
+/**
+ * @brief Finds the largest embedded JPEG preview.
+ *
+ * Visits IFD0, the IFDs chained after it and their SubIFDs, breadth first.
+ * Only the directories and the first bytes of each candidate are read.
+ *
+ * @param device The RAW file, open for reading and seekable.
+ * @return The preview; invalid if the file has none or is not a TIFF container.
+ */
+RawPreviewExtractor::Preview RawPreviewExtractor::locate(QIODevice* device) {
+    Preview best;
+    TiffReader tiff(device);
+    quint32 firstIfd = 0;
+    if (!device || !tiff.readHeader(&firstIfd)) {
+        return best;
+    }
+    const qint64 fileSize = device->size();
+
+    QVector<quint32> pending{ firstIfd };
+    QSet<quint32> visited;
+    QImageIOHandler::Transformations orientation = QImageIOHandler::TransformationNone;
+    while (!pending.isEmpty() && visited.size() < MAX_IFDS) {
+        const quint32 ifd = pending.takeFirst();
+        if (ifd == 0 || ifd >= fileSize || visited.contains(ifd)) {
+            continue;
+        }
+        visited.insert(ifd);
+
+        const QByteArray countBytes = tiff.bytes(ifd, 2);
+        if (countBytes.size() != 2) {
+            continue;
+        }
+        const int count = tiff.u16(countBytes, 0);
+        if (count == 0 || count > MAX_IFD_ENTRIES) {
+            continue;
+        }
+        const QByteArray entries = tiff.bytes(ifd + 2, qint64(count) * 12 + 4); // Entries, then the next IFD offset
+        if (entries.size() != count * 12 + 4) {
+            continue;
+        }
+
+        quint32 compression = 0;
+        quint32 jpegOffset = 0;
+        quint32 jpegLength = 0;
+        quint32 stripOffset = 0;
+        quint32 stripLength = 0;
+        bool singleStrip = false;
+        for (int i = 0; i < count; ++i) {
+            const int at = i * 12;
+            switch (tiff.u16(entries, at)) {
+            case TagCompression:
+                compression = tiff.value(entries, at);
+                break;
+            case TagStripOffsets:
+                singleStrip = tiff.u32(entries, at + 4) == 1;
+                stripOffset = tiff.value(entries, at);
+                break;
+            case TagStripByteCounts:
+                stripLength = tiff.value(entries, at);
+                break;
+            case TagOrientation:
+                if (visited.size() == 1) {
+                    orientation = transformationFromExif(tiff.value(entries, at)); // IFD0 describes the shot
+                }
+                break;
+            case TagSubIfds:
+                pending.append(tiff.values(entries, at));
+                break;
+            case TagJpegOffset:
+                jpegOffset = tiff.value(entries, at);
+                break;
+            case TagJpegLength:
+                jpegLength = tiff.value(entries, at);
+                break;
+            default:
+                break;
+            }
+        }
+        pending.append(tiff.u32(entries, count * 12)); // Next IFD in the chain
+
+        // Up to two candidates per IFD: a JPEG interchange stream and a single JPEG strip
+        const qint64 candidates[2][2] = {
+            { jpegOffset, jpegLength },
+            { (singleStrip && (compression == 6 || compression == 7)) ? stripOffset : 0, stripLength }
+        };
+        for (const auto& candidate : candidates) {
+            const qint64 offset = candidate[0];
+            const qint64 length = candidate[1];
+            if (offset <= 0 || length <= 0 || offset + length > fileSize) {
+                continue;
+            }
+            Preview preview;
+            if (!readJpegFrame(device, offset, length, &preview)) {
+                continue;
+            }
+            const qint64 area = qint64(preview.size.width()) * preview.size.height();
+            if (!best.isValid() || area > qint64(best.size.width()) * best.size.height()) {
+                preview.offset = offset;
+                preview.length = length;
+                best = preview;
+            }
+        }
+    }
+    best.orientation = orientation;
+    return best;
+}
+
+/**
+ * @brief Finds the largest embedded JPEG preview of a file and reads it.
+ *
+ * @param path The RAW file.
+ * @param preview Receives the preview description, if not null.
+ * @return The JPEG bytes, or a null QByteArray if there is no preview.
+ */
+QByteArray RawPreviewExtractor::read(const QString& path, Preview* preview) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qDebug() << "Could not open RAW file" << path << ":" << file.errorString();
+        return QByteArray();
+    }
+    const Preview found = locate(&file);
+    if (preview) {
+        *preview = found;
+    }
+    if (!found.isValid()) {
+        qDebug() << "No embedded JPEG preview found in" << path;
+        return QByteArray();
+    }
+    file.seek(found.offset);
+    QByteArray bytes = file.read(found.length);
+    return bytes.size() == found.length ? bytes : QByteArray();
+}
@@ -0,0 +1,84 @@
+/**
+ * @file rawpreviewextractor.h
+ * @brief Declaration of the RawPreviewExtractor class, which finds the JPEG previews embedded in camera RAW files.
+ *
+ * This file defines the RawPreviewExtractor class. Canon CR2, Nikon NEF,
+ * Sony ARW and Adobe DNG files are TIFF containers which, next to the
+ * sensor data, carry one or more JPEG renderings made by the camera. The
+ * extractor walks only the TIFF directory structure to locate the largest
+ * of them, so a RAW file can be shown by decoding that JPEG alone, without
+ * demosaicing and with a few hundred kilobytes of I/O.
+ */
+#ifndef IMAGELOADERLIB_RAWPREVIEWEXTRACTOR_H
+#define IMAGELOADERLIB_RAWPREVIEWEXTRACTOR_H
+
+#include <QByteArray>      // For the preview bytes
+#include <QImageIOHandler> // For EXIF orientations
+#include <QSize>           // For the preview dimensions
+#include <QString>         // For file paths
+
+class QIODevice;
+
+/**
+ * @brief Locates and reads the largest embedded JPEG preview of a camera RAW file.
+ *
+ * Candidates are the JPEG streams referenced by the JPEGInterchangeFormat
+ * tags and the single-strip JPEG images of every IFD, including the
+ * SubIFDs. Each is validated by reading its JPEG header up to the frame
+ * marker: only baseline, extended and progressive JPEGs are accepted, which
+ * rules out the lossless JPEG that holds the sensor data of CR2 and many
+ * DNG files.
+ *
+ * All methods are static and thread-safe.
+ */
+class RawPreviewExtractor {
+public:
+    /**
+     * @brief Where an embedded preview is and what it looks like.
+     */
+    struct Preview {
+        qint64 offset = -1;  ///< Position of the JPEG stream in the file.
+        qint64 length = 0;   ///< Length of the JPEG stream, in bytes.
+        QSize size;          ///< Dimensions of the JPEG.
+        bool grayscale = false; ///< True for single-component JPEGs.
+        QImageIOHandler::Transformations orientation; ///< The orientation tag of the RAW file.
+
+        /**
+         * @brief Tells whether a preview was found.
+         */
+        bool isValid() const { return offset >= 0 && length > 0; }
+    };
+
+    /**
+     * @brief Tells whether a file is a supported RAW format, by its extension.
+     *
+     * @param path The file.
+     * @return True for .cr2, .nef, .arw and .dng files.
+     */
+    static bool isRawFile(const QString& path);
+
+    /**
+     * @brief Finds the largest embedded JPEG preview.
+     *
+     * @param device The RAW file, open for reading and seekable.
+     * @return The preview; invalid if the file has none or is not a TIFF container.
+     */
+    static Preview locate(QIODevice* device);
+
+    /**
+     * @brief Finds the largest embedded JPEG preview of a file and reads it.
+     *
+     * @param path The RAW file.
+     * @param preview Receives the preview description, if not null.
+     * @return The JPEG bytes, or a null QByteArray if there is no preview.
+     */
+    static QByteArray read(const QString& path, Preview* preview = nullptr);
+
+private:
+    /**
+     * @brief Not instantiable: the extractor is stateless.
+     */
+    RawPreviewExtractor() = delete;
+};
+
+#endif // IMAGELOADERLIB_RAWPREVIEWEXTRACTOR_H
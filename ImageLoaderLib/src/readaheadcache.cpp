@@ -0,0 +1,316 @@
+/**
+ * @file readaheadcache.cpp
+ * @brief Implementation of the ReadaheadCache class.
+ *
+ * This file provides the batched, kernel-hinted reads of the readahead stage
+ * and the LRU buffer that holds their results.
+ */
+#include "readaheadcache.h"
+#include <QFile>         // For reading the files
+#include <QMutexLocker>  // For scoped locking
+#include <QDebug>        // For debugging output
+#include <algorithm>     // For std::sort, std::rotate
+#include <memory>        // For std::unique_ptr
+#include <vector>        // For the open files of a batch
+
+#if defined(Q_OS_UNIX)
+#include <sys/stat.h>    // For fstat (inode numbers)
+#endif
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>       // For posix_fadvise
+#include <sys/ioctl.h>   // For ioctl
+#include <linux/fs.h>    // For FS_IOC_FIEMAP
+#include <linux/fiemap.h> // For struct fiemap
+#endif
+
+namespace {
+
+/**
+ * @brief An open file of a batch, with where it lives on disk.
+ */
+struct BatchFile {
+    std::unique_ptr<QFile> file; ///< The open file.
+    int priority = 0;            ///< Position in the requested batch; 0 is the most urgent.
+    quint64 physical = 0;        ///< Physical byte offset of the first extent, if known.
+    bool hasPhysical = false;    ///< True if `physical` is valid.
+    quint64 inode = 0;           ///< Inode number, the fallback layout key.
+};
+
+/**
+ * @brief Looks up the on-disk position of an open file.
+ *
+ * The physical offset of the first extent comes from the FIEMAP ioctl
+ * (Linux, most local file systems). Where that is not available the inode
+ * number is used instead: file systems of the ext family allocate the data
+ * of inodes that are close together in nearby block groups, so it is still
+ * a good approximation of the layout.
+ *
+ * @param entry The file to look up; its layout fields are filled in.
+ */
+void lookUpPhysicalLayout(BatchFile& entry) {
+#if defined(Q_OS_UNIX)
+    const int fd = entry.file->handle();
+    struct stat status;
+    if (fstat(fd, &status) == 0) {
+        entry.inode = quint64(status.st_ino);
+    }
+#if defined(Q_OS_LINUX)
+    alignas(struct fiemap) char request[sizeof(struct fiemap) + sizeof(struct fiemap_extent)] = {};
+    auto* map = reinterpret_cast<struct fiemap*>(request);
+    map->fm_start = 0;
+    map->fm_length = FIEMAP_MAX_OFFSET;
+    map->fm_extent_count = 1; // The first extent is where the read head has to go
+    if (ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0) {
+        const struct fiemap_extent& extent = map->fm_extents[0];
+        if (!(extent.fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC))) {
+            entry.physical = extent.fe_physical;
+            entry.hasPhysical = true;
+        }
+    }
+#endif
+#else
+    Q_UNUSED(entry);
+#endif
+}
+
+/**
+ * @brief Orders a batch for a single sweep of the disk head.
+ *
+ * The most urgent file keeps its place at the front. The others are sorted
+ * by physical offset (or by inode if any offset is unknown, since the two
+ * cannot be compared) and visited like an elevator: first those laid out
+ * after the urgent file, then, wrapping around, those before it.
+ *
+ * @param files The batch, in priority order; reordered in place.
+ */
+void sortByPhysicalLayout(std::vector<BatchFile>& files) {
+    if (files.size() < 3) {
+        return; // Nothing to reorder behind the urgent file
+    }
+    const bool usePhysical = std::all_of(files.cbegin(), files.cend(),
+                                         [](const BatchFile& entry) { return entry.hasPhysical; });
+    auto key = [usePhysical](const BatchFile& entry) {
+        return usePhysical ? entry.physical : entry.inode;
+    };
+
+    const quint64 headKey = key(files.front());
+    auto rest = files.begin() + 1;
+    std::sort(rest, files.end(), [&key](const BatchFile& a, const BatchFile& b) {
+        return key(a) != key(b) ? key(a) < key(b) : a.priority < b.priority;
+    });
+    auto wrap = std::find_if(rest, files.end(), [&key, headKey](const BatchFile& entry) {
+        return key(entry) >= headKey;
+    });
+    std::rotate(rest, wrap, files.end());
+}
+
+} // namespace
+
+/**
+ * @brief Constructs an empty buffer with the given capacity.
+ * @param capacityBytes The maximum number of encoded bytes kept in memory.
+ */
+ReadaheadCache::ReadaheadCache(qint64 capacityBytes)
+    : m_buffers(qMax<qint64>(1, capacityBytes)),
+    m_workerRunning(false),
+    m_stopping(false),
+    m_dropCacheThreshold(0)
+{
+    m_ioPool.setMaxThreadCount(1); // One reader: parallel reads of the same disk only add seeks
+}
+
+/**
+ * @brief Stops the I/O thread, dropping batches that have not started.
+ */
+ReadaheadCache::~ReadaheadCache() {
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_pending.clear();
+    }
+    m_ioPool.waitForDone();
+}
+
+/**
+ * @brief Schedules the given files to be read into the buffer, in order.
+ *
+ * Only looks at the buffer: the files are not touched on the caller's
+ * thread, their sizes are checked by the I/O thread once opened. Files of
+ * the batch being read are scheduled again, since that batch is abandoned
+ * in favour of this one; the I/O thread skips those it has buffered by then.
+ *
+ * @param paths The files to prefetch, most urgent first.
+ */
+void ReadaheadCache::prefetch(const QStringList& paths) {
+    QMutexLocker locker(&m_mutex);
+    QStringList batch;
+    for (const QString& path : paths) {
+        if (!m_buffers.contains(path)) {
+            batch.append(path);
+        }
+    }
+
+    m_pending = batch; // Supersedes a batch that has not been read yet
+    if (!m_workerRunning && !m_pending.isEmpty() && !m_stopping) {
+        m_workerRunning = true;
+        m_ioPool.start([this]() {
+            runWorker();
+        });
+    }
+}
+
+/**
+ * @brief Body of the I/O thread: reads pending batches until there are none left.
+ */
+void ReadaheadCache::runWorker() {
+    forever {
+        QStringList batch;
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_pending.isEmpty() || m_stopping) {
+                m_workerRunning = false;
+                return;
+            }
+            batch.swap(m_pending);
+            m_inFlight = QSet<QString>(batch.cbegin(), batch.cend());
+        }
+        readBatch(batch);
+    }
+}
+
+/**
+ * @brief Returns the buffered bytes of a file.
+ * @param path The path of the file.
+ * @return The encoded bytes, or a null QByteArray if the file is not buffered.
+ */
+QByteArray ReadaheadCache::bytes(const QString& path) const {
+    QMutexLocker locker(&m_mutex);
+    const QByteArray* buffer = m_buffers.object(path);
+    return buffer ? *buffer : QByteArray();
+}
+
+/**
+ * @brief Drops the buffered bytes of a file that changed or disappeared.
+ * @param path The path of the file.
+ */
+void ReadaheadCache::invalidate(const QString& path) {
+    QMutexLocker locker(&m_mutex);
+    m_buffers.remove(path);
+    m_inFlight.remove(path);
+}
+
+/**
+ * @brief Changes the capacity, evicting the least recently used files if needed.
+ * @param capacityBytes The maximum number of encoded bytes kept in memory.
+ */
+void ReadaheadCache::setCapacity(qint64 capacityBytes) {
+    QMutexLocker locker(&m_mutex);
+    m_buffers.setMaxCost(qMax<qint64>(1, capacityBytes));
+}
+
+/**
+ * @brief Returns the capacity.
+ * @return The maximum number of encoded bytes kept in memory.
+ */
+qint64 ReadaheadCache::capacity() const {
+    QMutexLocker locker(&m_mutex);
+    return m_buffers.maxCost();
+}
+
+/**
+ * @brief Sets the size from which files are dropped from the page cache once buffered.
+ * @param bytes The threshold in bytes; 0 disables dropping.
+ */
+void ReadaheadCache::setDropCacheThreshold(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    m_dropCacheThreshold = qMax<qint64>(0, bytes);
+}
+
+/**
+ * @brief Reads one batch of files on the I/O thread.
+ * @param paths The files of the batch.
+ */
+void ReadaheadCache::readBatch(const QStringList& paths) {
+    qint64 maxFileSize = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        maxFileSize = m_buffers.maxCost() / 4;
+    }
+
+    // 1. Open everything and find out where each file lives on disk
+    std::vector<BatchFile> files;
+    files.reserve(size_t(paths.size()));
+    for (int i = 0; i < paths.size(); ++i) {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_buffers.contains(paths.at(i))) {
+                m_inFlight.remove(paths.at(i)); // Read by the batch this one superseded
+                continue;
+            }
+        }
+        BatchFile entry;
+        entry.file = std::make_unique<QFile>(paths.at(i));
+        if (!entry.file->open(QIODevice::ReadOnly) || entry.file->size() > maxFileSize) {
+            // Unreadable, or so large it would push most of the other files out of the buffer
+            QMutexLocker locker(&m_mutex);
+            m_inFlight.remove(paths.at(i));
+            continue;
+        }
+        entry.priority = i;
+        lookUpPhysicalLayout(entry);
+        files.push_back(std::move(entry));
+    }
+
+    // 2. Reorder the batch so that, on rotating media, the reads become one
+    //    sweep across the disk instead of a seek per file, and tell the kernel
+    //    we will need all of it, in that order
+    sortByPhysicalLayout(files);
+#if defined(Q_OS_LINUX)
+    for (const BatchFile& entry : files) {
+        posix_fadvise(entry.file->handle(), 0, 0, POSIX_FADV_WILLNEED);
+    }
+#endif
+
+    // 3. Pull the bytes in, most urgent file first and then in disk order
+    for (const BatchFile& entry : files) {
+        QFile* file = entry.file.get();
+        const QString path = file->fileName();
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_pending.isEmpty() || m_stopping) {
+                m_inFlight.clear(); // A newer batch is waiting: it is more urgent than the rest of this one
+                return;
+            }
+            if (!m_inFlight.contains(path)) {
+                continue; // Invalidated while we were reading the others
+            }
+        }
+        QByteArray* buffer = new QByteArray(file->readAll());
+#if defined(Q_OS_LINUX)
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_dropCacheThreshold > 0 && buffer->size() >= m_dropCacheThreshold) {
+                posix_fadvise(file->handle(), 0, 0, POSIX_FADV_DONTNEED); // We hold our own copy now
+            }
+        }
+#endif
+        file->close();
+
+        QMutexLocker locker(&m_mutex);
+        if (!m_inFlight.remove(path)) {
+            delete buffer;
+            continue;
+        }
+        const qint64 cost = qMax<qint64>(1, buffer->size());
+        if (!m_buffers.insert(path, buffer, cost)) { // QCache deletes the buffer on failure
+            qDebug() << "Readahead buffer too small for" << path;
+        }
+    }
+
+    // 4. The buffer evicts least recently used files first: touch the batch in
+    //    reverse priority order so eviction follows priority, not disk order
+    QMutexLocker locker(&m_mutex);
+    for (auto it = paths.crbegin(); it != paths.crend(); ++it) {
+        m_buffers.object(*it);
+    }
+}
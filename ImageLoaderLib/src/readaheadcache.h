@@ -0,0 +1,123 @@
+/**
+ * @file readaheadcache.h
+ * @brief Declaration of the ReadaheadCache class, an I/O-only prefetch stage for encoded image bytes.
+ *
+ * This file defines the ReadaheadCache class. Given the paths of the images the
+ * user is likely to look at next, it hints the kernel to start reading all of
+ * them at once and then pulls their encoded bytes into a small, byte-bounded
+ * RAM buffer. A later decode of one of those files then only costs CPU.
+ */
+#ifndef IMAGELOADERLIB_READAHEADCACHE_H
+#define IMAGELOADERLIB_READAHEADCACHE_H
+
+#include <QByteArray>  // For the encoded bytes
+#include <QCache>      // For the byte-bounded LRU buffer
+#include <QMutex>      // For thread-safe access
+#include <QSet>        // For the reads in progress
+#include <QString>     // For file paths
+#include <QStringList> // For batches of paths
+#include <QThreadPool> // For the I/O thread
+
+/**
+ * @brief Keeps the encoded bytes of soon-to-be-viewed files in memory.
+ *
+ * Encoded files are typically ten times smaller than their decoded pixels,
+ * so this buffer can keep many more images "ready" than the decoded
+ * ImageCache. Reads run on a dedicated I/O thread; a new prefetch request
+ * supersedes the batches that have not started yet.
+ *
+ * All methods are thread-safe.
+ */
+class ReadaheadCache {
+public:
+    /**
+     * @brief Constructs an empty buffer with the given capacity.
+     * @param capacityBytes The maximum number of encoded bytes kept in memory.
+     */
+    explicit ReadaheadCache(qint64 capacityBytes);
+
+    /**
+     * @brief Stops the I/O thread, dropping batches that have not started.
+     */
+    ~ReadaheadCache();
+
+    /**
+     * @brief Schedules the given files to be read into the buffer, in order.
+     *
+     * Files already buffered are skipped, as are files larger than a
+     * quarter of the capacity. The batch replaces any batch from an earlier
+     * call that has not been read yet, and the rest of the batch being read:
+     * the navigation has moved on. Never touches the file system itself, so
+     * it is cheap to call from the GUI thread.
+     *
+     * @param paths The files to prefetch, most urgent first.
+     */
+    void prefetch(const QStringList& paths);
+
+    /**
+     * @brief Returns the buffered bytes of a file.
+     * @param path The path of the file.
+     * @return The encoded bytes, or a null QByteArray if the file is not buffered.
+     */
+    QByteArray bytes(const QString& path) const;
+
+    /**
+     * @brief Drops the buffered bytes of a file that changed or disappeared.
+     * @param path The path of the file.
+     */
+    void invalidate(const QString& path);
+
+    /**
+     * @brief Changes the capacity, evicting the least recently used files if needed.
+     * @param capacityBytes The maximum number of encoded bytes kept in memory.
+     */
+    void setCapacity(qint64 capacityBytes);
+
+    /**
+     * @brief Returns the capacity.
+     * @return The maximum number of encoded bytes kept in memory.
+     */
+    qint64 capacity() const;
+
+    /**
+     * @brief Sets the size from which files are dropped from the page cache once buffered.
+     *
+     * The buffer keeps its own copy of the bytes, so for large files the
+     * kernel's copy is pure waste. Only has an effect on Linux.
+     *
+     * @param bytes The threshold in bytes; 0 disables dropping.
+     */
+    void setDropCacheThreshold(qint64 bytes);
+
+private:
+    /**
+     * @brief Body of the I/O thread: reads pending batches until there are none left.
+     */
+    void runWorker();
+
+    /**
+     * @brief Reads one batch of files on the I/O thread.
+     *
+     * All files of the batch are first opened and located on disk (FIEMAP
+     * physical offset, or inode number as a fallback). The most urgent file
+     * is read first; the rest are reordered into a single elevator sweep
+     * from there, so that a cold archive on a spinning disk is read almost
+     * sequentially. Everything is advised as WILLNEED in that order, so the
+     * kernel can queue the reads together, and only then read one by one.
+     * The batch is abandoned as soon as a newer one is pending.
+     *
+     * @param paths The files of the batch.
+     */
+    void readBatch(const QStringList& paths);
+
+    mutable QMutex m_mutex;                ///< Guards the members below.
+    QCache<QString, QByteArray> m_buffers; ///< Encoded bytes by path; cost is the size in bytes.
+    QStringList m_pending;                 ///< Next batch to read; replaced by every prefetch().
+    QSet<QString> m_inFlight;              ///< Files of the batch being read.
+    bool m_workerRunning;                  ///< True while the I/O thread has work queued.
+    bool m_stopping;                       ///< Set by the destructor to abandon pending reads.
+    qint64 m_dropCacheThreshold;           ///< Files this large are evicted from the page cache; 0 = never.
+    QThreadPool m_ioPool;                  ///< Runs the I/O thread.
+};
+
+#endif // IMAGELOADERLIB_READAHEADCACHE_H
@@ -0,0 +1,153 @@
+/**
+ * @file spngdecoder.cpp
+ * @brief Implementation of the SpngDecoder class.
+ */
+#include "spngdecoder.h"
+#include <QScopedPointer> // For the decoder context
+#include <QDebug>         // For debugging output
+#include <spng.h>         // For libspng
+#include <algorithm>      // For std::equal
+#include <limits>         // For the largest length libspng accepts
+
+namespace {
+/**
+ * @brief Frees a libspng context; the cleanup handler of QScopedPointer.
+ */
+struct SpngContextDeleter {
+    static inline void cleanup(spng_ctx* context) {
+        spng_ctx_free(context);
+    }
+};
+
+/**
+ * @brief A libspng context freed at the end of its scope.
+ */
+using SpngContext = QScopedPointer<spng_ctx, SpngContextDeleter>;
+
+/**
+ * @brief Binds the encoded bytes to a context and works out the output format.
+ *
+ * @param context A fresh context.
+ * @param input The encoded image.
+ * @param header Receives the dimensions and output format.
+ * @param spngFormat Receives the matching libspng output format.
+ * @return False for malformed headers and inputs larger than size_t can address.
+ */
+bool readPngHeader(spng_ctx* context, const ImageDecoder::Input& input, ImageDecoder::Header* header, int* spngFormat) {
+    if (quint64(input.size) > std::numeric_limits<size_t>::max()) {
+        return false; // libspng takes a size_t length: refuse rather than truncate
+    }
+    if (!context || spng_set_png_buffer(context, input.data, size_t(input.size)) != 0) {
+        return false;
+    }
+    spng_ihdr ihdr;
+    if (spng_get_ihdr(context, &ihdr) != 0) {
+        return false;
+    }
+    spng_trns trns;
+    const bool hasTrns = spng_get_trns(context, &trns) == 0;
+    const bool hasAlpha = hasTrns
+                          || ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE_ALPHA
+                          || ihdr.color_type == SPNG_COLOR_TYPE_TRUECOLOR_ALPHA;
+
+    header->size = QSize(int(ihdr.width), int(ihdr.height));
+    if (ihdr.color_type == SPNG_COLOR_TYPE_GRAYSCALE && ihdr.bit_depth == 8 && !hasTrns) {
+        *spngFormat = SPNG_FMT_G8;
+        header->pixelFormat = QImage::Format_Grayscale8;
+    } else {
+        *spngFormat = SPNG_FMT_RGBA8; // Also expands palettes and low bit depths, and narrows 16-bit samples
+        header->pixelFormat = hasAlpha ? QImage::Format_RGBA8888 : QImage::Format_RGBX8888;
+    }
+    return header->size.isValid();
+}
+}
+
+/**
+ * @brief Returns "libspng".
+ * @return The backend name.
+ */
+QByteArray SpngDecoder::name() const {
+    return QByteArrayLiteral("libspng");
+}
+
+/**
+ * @brief Tells whether the bytes start with the PNG signature.
+ *
+ * @param data The encoded bytes.
+ * @param size The number of encoded bytes.
+ * @return True for PNG.
+ */
+bool SpngDecoder::canDecode(const uchar* data, qint64 size) const {
+    static const uchar signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+    return size >= 8 && std::equal(signature, signature + 8, data);
+}
+
+/**
+ * @brief Parses the PNG header.
+ *
+ * @param input The encoded image.
+ * @param header Receives the dimensions and output format.
+ * @return False for malformed headers.
+ */
+bool SpngDecoder::readHeader(const Input& input, Header* header) const {
+    SpngContext context(spng_ctx_new(0));
+    int spngFormat = 0;
+    return readPngHeader(context.data(), input, header, &spngFormat);
+}
+
+/**
+ * @brief Returns false: PNG always decodes at full resolution.
+ *
+ * @param input The encoded image.
+ * @return False.
+ */
+bool SpngDecoder::supportsScaledDecode(const Input& input) const {
+    Q_UNUSED(input);
+    return false;
+}
+
+/**
+ * @brief Decodes the pixels.
+ *
+ * @param input The encoded image.
+ * @param size The full size.
+ * @param image In: an optional buffer to decode into. Out: the pixels.
+ * @return True on success; on a truncated file, the rows decoded so far are kept.
+ */
+bool SpngDecoder::decode(const Input& input, const QSize& size, QImage* image) const {
+    SpngContext context(spng_ctx_new(0));
+    Header header;
+    int spngFormat = 0;
+    if (!readPngHeader(context.data(), input, &header, &spngFormat) || size != header.size) {
+        return false;
+    }
+    if (image->size() != size || image->format() != header.pixelFormat) {
+        *image = QImage(size, header.pixelFormat);
+        if (image->isNull()) {
+            return false;
+        }
+    }
+
+    int error = spng_decode_image(context.data(), nullptr, 0, spngFormat, SPNG_DECODE_TRNS | SPNG_DECODE_PROGRESSIVE);
+    if (error != 0) {
+        qDebug() << "libspng error:" << spng_strerror(error);
+        return false;
+    }
+    const size_t rowBytes = size_t(size.width()) * (spngFormat == SPNG_FMT_G8 ? 1 : 4);
+    uchar* const bits = image->bits();
+    const qsizetype bytesPerLine = image->bytesPerLine();
+    spng_row_info row;
+    do {
+        error = spng_get_row_info(context.data(), &row);
+        if (error != 0) {
+            break;
+        }
+        error = spng_decode_row(context.data(), bits + qsizetype(row.row_num) * bytesPerLine, rowBytes);
+    } while (error == 0);
+
+    if (error != SPNG_EOI) {
+        qDebug() << "libspng error:" << spng_strerror(error);
+        return false;
+    }
+    return true;
+}
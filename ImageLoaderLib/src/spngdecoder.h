@@ -0,0 +1,66 @@
+/**
+ * @file spngdecoder.h
+ * @brief Declaration of the SpngDecoder class, which decodes PNG through libspng.
+ */
+#ifndef IMAGELOADERLIB_SPNGDECODER_H
+#define IMAGELOADERLIB_SPNGDECODER_H
+
+#include "imagedecoder.h"
+
+/**
+ * @brief Decodes PNG with libspng, whose inflate and unfiltering are faster than libpng's.
+ *
+ * Rows are decoded progressively straight into the destination image:
+ * 8-bit and lower greyscale without transparency to Format_Grayscale8,
+ * everything else to Format_RGBA8888 (or Format_RGBX8888 when opaque),
+ * which the decode stage then normalizes like any other decoder output.
+ * Interlaced images are deinterlaced by libspng into the same rows.
+ *
+ * PNG has no reduced-resolution decode.
+ */
+class SpngDecoder : public ImageDecoder {
+public:
+    /**
+     * @brief Returns "libspng".
+     * @return The backend name.
+     */
+    QByteArray name() const override;
+
+    /**
+     * @brief Tells whether the bytes start with the PNG signature.
+     *
+     * @param data The encoded bytes.
+     * @param size The number of encoded bytes.
+     * @return True for PNG.
+     */
+    bool canDecode(const uchar* data, qint64 size) const override;
+
+    /**
+     * @brief Parses the PNG header.
+     *
+     * @param input The encoded image.
+     * @param header Receives the dimensions and output format.
+     * @return False for malformed headers.
+     */
+    bool readHeader(const Input& input, Header* header) const override;
+
+    /**
+     * @brief Returns false: PNG always decodes at full resolution.
+     *
+     * @param input The encoded image.
+     * @return False.
+     */
+    bool supportsScaledDecode(const Input& input) const override;
+
+    /**
+     * @brief Decodes the pixels.
+     *
+     * @param input The encoded image.
+     * @param size The full size.
+     * @param image In: an optional buffer to decode into. Out: the pixels.
+     * @return True on success; on a truncated file, the rows decoded so far are kept.
+     */
+    bool decode(const Input& input, const QSize& size, QImage* image) const override;
+};
+
+#endif // IMAGELOADERLIB_SPNGDECODER_H
@@ -0,0 +1,201 @@
+/**
+ * @file svgrasterizer.cpp
+ * @brief Implementation of the SvgRasterizer class.
+ */
+#include "svgrasterizer.h"
+#include "pixelbufferpool.h" // For the rasters
+#include <QSvgRenderer>      // For parsing and drawing SVG
+#include <QFileInfo>         // For file extensions and sizes
+#include <QPainter>          // For drawing into the raster
+#include <QThreadPool>       // For the render worker
+#include <QDebug>            // For debugging output
+
+namespace {
+/**
+ * @brief Capacity of the document cache, in KiB of SVG source (16 MiB).
+ */
+constexpr int DOCUMENT_CACHE_CAPACITY_KIB = 16 * 1024;
+}
+
+/**
+ * @brief A parsed document and the lock serializing its use.
+ *
+ * QSvgRenderer is not reentrant: two threads must not draw the same
+ * renderer at once, but different documents render in parallel.
+ */
+struct SvgRasterizer::Document {
+    QMutex mutex;          ///< Held while drawing.
+    QSvgRenderer renderer; ///< The parsed document.
+};
+
+/**
+ * @brief Constructs a rasterizer with an empty document cache.
+ * @param parent Pointer to the parent QObject.
+ */
+SvgRasterizer::SvgRasterizer(QObject* parent)
+    : QObject(parent),
+    m_pool(new QThreadPool(this)),
+    m_documents(DOCUMENT_CACHE_CAPACITY_KIB),
+    m_generation(0)
+{
+    m_pool->setMaxThreadCount(1); // Only the latest request matters: one worker is enough
+}
+
+/**
+ * @brief Waits for the render in progress and destroys the rasterizer.
+ */
+SvgRasterizer::~SvgRasterizer() {
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+/**
+ * @brief Tells whether a file is an SVG document, by its extension.
+ *
+ * @param path The file.
+ * @return True for .svg and .svgz files.
+ */
+bool SvgRasterizer::isSvgFile(const QString& path) {
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    return suffix == QLatin1String("svg") || suffix == QLatin1String("svgz");
+}
+
+/**
+ * @brief Tells whether a probed or sniffed format names an SVG document.
+ *
+ * Routing goes by content: a file named .svg may hold anything, and an SVG
+ * may have any name.
+ *
+ * @param format The format name, as reported by FormatSniffer or QImageReader.
+ * @return True for "svg" and "svgz".
+ */
+bool SvgRasterizer::isSvgFormat(const QByteArray& format) {
+    return format == "svg" || format == "svgz";
+}
+
+/**
+ * @brief Returns the size of a document's raster fitting a box.
+ *
+ * Unlike raster images, documents are enlarged to fill the box: they have
+ * no native resolution to preserve.
+ *
+ * @param path The SVG file.
+ * @param box The bounding box.
+ * @return The box shrunk to the document's aspect ratio, or an invalid size if it cannot be parsed.
+ */
+QSize SvgRasterizer::fittedSize(const QString& path, const QSize& box) {
+    const QSharedPointer<Document> doc = document(path);
+    if (!doc || box.isEmpty()) {
+        return QSize();
+    }
+    QSizeF intrinsic;
+    {
+        QMutexLocker locker(&doc->mutex);
+        intrinsic = doc->renderer.viewBoxF().size();
+        if (intrinsic.isEmpty()) {
+            intrinsic = doc->renderer.defaultSize();
+        }
+    }
+    if (intrinsic.isEmpty()) {
+        return box; // No intrinsic aspect ratio: fill the box
+    }
+    return intrinsic.scaled(box, Qt::KeepAspectRatio).toSize().expandedTo(QSize(1, 1));
+}
+
+/**
+ * @brief Rasterizes a document at an exact size. Thread-safe.
+ *
+ * @param path The SVG file.
+ * @param size The size of the raster.
+ * @return The raster in Format_ARGB32_Premultiplied, or a null image if the file cannot be parsed.
+ */
+QImage SvgRasterizer::render(const QString& path, const QSize& size) {
+    const QSharedPointer<Document> doc = document(path);
+    if (!doc || size.isEmpty()) {
+        return QImage();
+    }
+    PixelBufferPool* pool = PixelBufferPool::instance();
+    QImage image = pool ? pool->createImage(size, QImage::Format_ARGB32_Premultiplied)
+                        : QImage(size, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull()) {
+        return image;
+    }
+    image.fill(Qt::transparent); // Pooled memory is not cleared
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+    {
+        QMutexLocker locker(&doc->mutex);
+        doc->renderer.render(&painter, QRectF(image.rect()));
+    }
+    return image;
+}
+
+/**
+ * @brief Rasterizes a document on the worker, superseding the previous request.
+ *
+ * A request still queued is dropped; one already drawing finishes, but
+ * its raster is discarded. Parsing, when the document is not cached yet,
+ * also happens on the worker.
+ *
+ * @param path The SVG file.
+ * @param box The bounding box of the raster, which keeps the document's aspect ratio.
+ */
+void SvgRasterizer::requestRender(const QString& path, const QSize& box) {
+    const int generation = m_generation.fetchAndAddRelaxed(1) + 1;
+    m_pool->clear();
+    m_pool->start([this, path, box, generation]() {
+        const QImage image = render(path, fittedSize(path, box));
+        if (m_generation.loadRelaxed() != generation) {
+            return; // Superseded while drawing
+        }
+        QMetaObject::invokeMethod(this, [this, path, image, generation]() {
+            if (m_generation.loadRelaxed() == generation) {
+                emit rendered(path, image);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+/**
+ * @brief Drops the parsed document of a file, so that its next render reads it again.
+ *
+ * @param path The SVG file.
+ */
+void SvgRasterizer::forget(const QString& path) {
+    QMutexLocker locker(&m_mutex);
+    m_documents.remove(path);
+}
+
+/**
+ * @brief Returns the parsed document of a file, parsing it if needed. Thread-safe.
+ *
+ * Parsing happens outside the cache lock, so a large document does not
+ * hold up renders of the others; if two threads parse the same file at
+ * once, the first one inserted wins.
+ *
+ * @param path The SVG file.
+ * @return The document, or null if the file cannot be parsed.
+ */
+QSharedPointer<SvgRasterizer::Document> SvgRasterizer::document(const QString& path) {
+    {
+        QMutexLocker locker(&m_mutex);
+        if (const QSharedPointer<Document>* cached = m_documents.object(path)) {
+            return *cached;
+        }
+    }
+
+    auto parsed = QSharedPointer<Document>::create();
+    if (!parsed->renderer.load(path) || !parsed->renderer.isValid()) {
+        qDebug() << "Could not parse SVG file" << path;
+        return QSharedPointer<Document>();
+    }
+    parsed->renderer.setAspectRatioMode(Qt::KeepAspectRatio);
+
+    QMutexLocker locker(&m_mutex);
+    if (const QSharedPointer<Document>* cached = m_documents.object(path)) {
+        return *cached;
+    }
+    const int cost = int(qBound<qint64>(1, QFileInfo(path).size() / 1024, DOCUMENT_CACHE_CAPACITY_KIB));
+    m_documents.insert(path, new QSharedPointer<Document>(parsed), cost);
+    return parsed;
+}
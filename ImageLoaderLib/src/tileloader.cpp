@@ -0,0 +1,530 @@
+/**
+ * @file tileloader.cpp
+ * @brief Implementation of the TileLoader class.
+ */
+#include "tileloader.h"
+#include "memorybudget.h"   // For predicting the memory of tile decodes
+#include "pixelkernels.h"   // For orienting decoded tiles
+#include "tilepyramid.h"    // For the tile pyramids in the disk cache
+#include "rawpreviewextractor.h" // For zooming into the previews of RAW files
+#include <QBuffer>          // For decoding RAW previews from memory
+#include <QImageReader>     // For region decoding
+#include <QThreadPool>      // For the tile workers
+#include <QThread>          // For QThread::idealThreadCount()
+#include <QRectF>           // For mapping tiles between levels
+#include <QDebug>           // For debugging output
+#include <algorithm>        // For std::sort
+#include <cmath>            // For std::log2
+
+namespace {
+/**
+ * @brief Width and height of a tile, in pixels.
+ */
+constexpr int TILE_SIZE = 256;
+
+/**
+ * @brief Default capacity of the tile cache (128 MiB, i.e. 512 full RGB32 tiles).
+ */
+constexpr qint64 DEFAULT_TILE_CACHE_CAPACITY = 128ll * 1024 * 1024;
+
+/**
+ * @brief Deepest level considered; level 30 of any image is a single pixel.
+ */
+constexpr int MAX_LEVEL = 30;
+
+/**
+ * @brief Returns the size of an image once `orientation` is applied (or undone).
+ */
+QSize orientedSize(const QSize& size, QImageIOHandler::Transformations orientation) {
+    return orientation.testFlag(QImageIOHandler::TransformationRotate90) ? size.transposed() : size;
+}
+
+/**
+ * @brief Maps a rectangle of the oriented image back to the image as decoded.
+ *
+ * The inverse of mirroring and flipping, then rotating clockwise (Qt's order).
+ *
+ * @param rect The rectangle in the oriented image.
+ * @param decodedSize The size of the image as decoded.
+ * @param orientation The EXIF orientation.
+ * @return The same pixels in decoded coordinates.
+ */
+QRect decodedRect(const QRect& rect, const QSize& decodedSize, QImageIOHandler::Transformations orientation) {
+    const bool mirror = orientation.testFlag(QImageIOHandler::TransformationMirror);
+    const bool flip = orientation.testFlag(QImageIOHandler::TransformationFlip);
+    const int w = decodedSize.width();
+    const int h = decodedSize.height();
+    const int x0 = rect.left();
+    const int y0 = rect.top();
+    const int x1 = rect.left() + rect.width();
+    const int y1 = rect.top() + rect.height();
+
+    if (orientation.testFlag(QImageIOHandler::TransformationRotate90)) {
+        // Oriented x runs along decoded y (backwards unless flipped), oriented y along decoded x
+        const int ux0 = mirror ? w - y1 : y0;
+        const int uy0 = flip ? x0 : h - x1;
+        return QRect(ux0, uy0, rect.height(), rect.width());
+    }
+    return QRect(mirror ? w - x1 : x0, flip ? h - y1 : y0, rect.width(), rect.height());
+}
+}
+
+/**
+ * @brief Constructs a tile loader for the images of an ImageLoader.
+ *
+ * @param loader The loader providing the files and their metadata.
+ * @param parent Pointer to the parent QObject.
+ */
+TileLoader::TileLoader(ImageLoader* loader, QObject* parent)
+    : QObject(parent),
+    m_loader(loader),
+    m_pool(new QThreadPool(this)),
+    m_pyramids(new TilePyramid(loader)),
+    m_running(0),
+    m_generation(0),
+    m_wholeLevelIndex(-1),
+    m_wholeReservedBytes(0)
+{
+    // Tiles are small: a couple of workers keep up with panning without starving the gallery pipeline
+    m_pool->setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    setCacheCapacity(DEFAULT_TILE_CACHE_CAPACITY);
+
+    // Any change of the index may give an ID a different file
+    connect(m_loader, &ImageLoader::imageInserted, this, &TileLoader::clear);
+    connect(m_loader, &ImageLoader::imageRemoved, this, &TileLoader::clear);
+    connect(m_loader, &ImageLoader::imageModified, this, &TileLoader::clear);
+    connect(m_loader, &ImageLoader::metadataProbed, this, &TileLoader::onMetadataProbed);
+}
+
+/**
+ * @brief Destroys the tile loader, waiting for the tiles being decoded.
+ */
+TileLoader::~TileLoader() {
+    m_pool->clear();
+    m_pool->waitForDone();
+    releaseWholeLevel();
+}
+
+/**
+ * @brief Returns the width and height of a tile, in pixels.
+ * @return The tile size.
+ */
+int TileLoader::tileSize() {
+    return TILE_SIZE;
+}
+
+/**
+ * @brief Returns the size of a pyramid level.
+ *
+ * @param fullSize The size of level 0.
+ * @param level The level.
+ * @return The size of the level, at least 1x1.
+ */
+QSize TileLoader::levelSize(const QSize& fullSize, int level) {
+    level = qBound(0, level, MAX_LEVEL);
+    const qint64 divisor = qint64(1) << level;
+    return QSize(int(qMax<qint64>(1, (fullSize.width() + divisor - 1) / divisor)),
+                 int(qMax<qint64>(1, (fullSize.height() + divisor - 1) / divisor)));
+}
+
+/**
+ * @brief Returns the level to draw from at a given zoom.
+ *
+ * @param scale Device pixels per full-resolution pixel.
+ * @return The level.
+ */
+int TileLoader::levelForScale(qreal scale) {
+    if (scale >= 1.0 || scale <= 0.0) {
+        return 0;
+    }
+    return qBound(0, int(std::floor(std::log2(1.0 / scale))), MAX_LEVEL);
+}
+
+/**
+ * @brief Returns the full-resolution size of an image, with its orientation applied.
+ *
+ * @param id The image ID.
+ * @return The size, or an invalid size if the image has no readable file or has not been probed yet.
+ */
+QSize TileLoader::imageSize(int id) {
+    const TileSource& tileSource = source(id);
+    return tileSource.path.isEmpty() ? QSize() : tileSource.orientedSize();
+}
+
+/**
+ * @brief Returns the number of levels of an image: down to the level that fits in one tile.
+ *
+ * @param id The image ID.
+ * @return The number of levels, or 0 if the image has no readable file.
+ */
+int TileLoader::levelCount(int id) {
+    const QSize fullSize = imageSize(id);
+    if (!fullSize.isValid()) {
+        return 0;
+    }
+    int count = 1;
+    QSize size = fullSize;
+    while ((size.width() > TILE_SIZE || size.height() > TILE_SIZE) && count <= MAX_LEVEL) {
+        size = levelSize(fullSize, count);
+        ++count;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns a tile if it is in the cache.
+ *
+ * @param key The tile.
+ * @return The tile, or a null image if it has not been decoded (yet).
+ */
+QImage TileLoader::tile(const TileKey& key) const {
+    const QImage* cached = m_cache.object(key);
+    return cached ? *cached : QImage();
+}
+
+/**
+ * @brief Asks for the tiles covering a region of a level.
+ *
+ * Tiles already cached or being decoded are skipped; the others replace
+ * whatever was still waiting from the previous request, ordered so that
+ * the tile nearest to the centre of the region is decoded first.
+ *
+ * @param id The image ID.
+ * @param level The level.
+ * @param region The region, in pixels of the level.
+ */
+void TileLoader::requestTiles(int id, int level, const QRect& region) {
+    const QSize fullSize = imageSize(id);
+    if (!fullSize.isValid()) {
+        return;
+    }
+    const QRect bounded = region.intersected(QRect(QPoint(0, 0), levelSize(fullSize, level)));
+    if (bounded.isEmpty()) {
+        m_wanted.clear();
+        startWantedTiles(); // Nothing to start, but a whole level kept for the old tiles may be dropped
+        return;
+    }
+    if (fullSize.width() > TILE_SIZE || fullSize.height() > TILE_SIZE) {
+        m_pyramids->build(source(id)); // Zoomed into: later visits read the tiles from disk
+    }
+
+    const QPointF centre = QRectF(bounded).center();
+    QVector<QPair<qreal, TileKey>> wanted;
+    for (int ty = bounded.top() / TILE_SIZE; ty <= bounded.bottom() / TILE_SIZE; ++ty) {
+        for (int tx = bounded.left() / TILE_SIZE; tx <= bounded.right() / TILE_SIZE; ++tx) {
+            const TileKey key{ id, level, tx, ty };
+            if (m_cache.contains(key) || m_decoding.contains(key)) {
+                continue;
+            }
+            const QPointF tileCentre((tx + 0.5) * TILE_SIZE, (ty + 0.5) * TILE_SIZE);
+            const QPointF offset = tileCentre - centre;
+            wanted.append(qMakePair(QPointF::dotProduct(offset, offset), key));
+        }
+    }
+    // Farthest first: the queue is consumed from the back
+    std::sort(wanted.begin(), wanted.end(), [](const QPair<qreal, TileKey>& a, const QPair<qreal, TileKey>& b) {
+        return a.first > b.first;
+    });
+
+    m_wanted.clear();
+    m_wanted.reserve(wanted.size());
+    for (const auto& entry : std::as_const(wanted)) {
+        m_wanted.append(entry.second);
+    }
+    startWantedTiles();
+}
+
+/**
+ * @brief Sets how many bytes of decoded tiles the cache may hold.
+ * @param bytes The capacity in bytes.
+ */
+void TileLoader::setCacheCapacity(qint64 bytes) {
+    m_cache.setMaxCost(qMax<qint64>(1, bytes / 1024)); // Costs are in KiB so that large caches fit in the int cost
+}
+
+/**
+ * @brief Sets how many bytes of tile pyramids the disk cache may hold.
+ *
+ * The least recently used pyramids are deleted after the next build.
+ *
+ * @param bytes The capacity in bytes.
+ */
+void TileLoader::setPyramidCacheCapacity(qint64 bytes) {
+    m_pyramids->setCapacity(bytes);
+}
+
+/**
+ * @brief Drops every cached tile and every tile waiting to be decoded.
+ *
+ * Tiles being decoded finish, but are discarded. Images waiting for their
+ * header probe still get `imageSizeKnown`.
+ */
+void TileLoader::clear() {
+    m_cache.clear();
+    m_sources.clear();
+    m_wanted.clear();
+    m_decoding.clear();
+    ++m_generation;
+    if (m_running == 0) {
+        releaseWholeLevel();
+    }
+}
+
+/**
+ * @brief Returns the decode parameters of an image, from its probed metadata.
+ *
+ * The header is never read here, on the GUI thread: an image not probed
+ * yet gets empty parameters until the probe pool has read it, and
+ * `imageSizeKnown` is emitted then.
+ *
+ * @param id The image ID.
+ * @return The parameters; the path is empty if the image has no readable file or has not been probed yet.
+ */
+const TileSource& TileLoader::source(int id) {
+    auto it = m_sources.constFind(id);
+    if (it != m_sources.cend()) {
+        return *it;
+    }
+
+    TileSource tileSource;
+    tileSource.path = m_loader->imagePath(id);
+    if (!tileSource.path.isEmpty()) {
+        const ImageData metadata = m_loader->imageMetadata(id);
+        if (!metadata.probed) {
+            m_awaitingProbe.insert(id);
+            tileSource.path.clear();
+        } else if (metadata.size.isValid()) {
+            tileSource.format = metadata.format;
+            tileSource.decodedSize = metadata.size;
+            tileSource.orientation = QImageIOHandler::Transformations(QFlag(metadata.transformation));
+            tileSource.pyramid = m_pyramids->directoryFor(tileSource.path);
+        } else {
+            tileSource.path.clear();
+        }
+    }
+    return *m_sources.insert(id, tileSource);
+}
+
+/**
+ * @brief Forgets the parameters of images that were waiting for their header probe.
+ *
+ * @param ids The probed images.
+ */
+void TileLoader::onMetadataProbed(const QVector<int>& ids) {
+    for (int id : ids) {
+        if (m_awaitingProbe.remove(id)) {
+            m_sources.remove(id);
+            emit imageSizeKnown(id);
+        }
+    }
+}
+
+/**
+ * @brief Starts decoding wanted tiles while workers are free.
+ */
+void TileLoader::startWantedTiles() {
+    while (m_running < m_pool->maxThreadCount() && !m_wanted.isEmpty()) {
+        const TileKey key = m_wanted.takeLast();
+        const TileSource tileSource = source(key.id);
+        const int generation = m_generation;
+        m_decoding.append(key);
+        ++m_running;
+        m_pool->start([this, tileSource, key, generation]() {
+            const QImage decoded = decodeTile(tileSource, key);
+            QMetaObject::invokeMethod(this, [this, key, decoded, generation]() {
+                onTileDecoded(key, decoded, generation);
+            }, Qt::QueuedConnection);
+        });
+    }
+    if (m_running == 0 && m_wanted.isEmpty()) {
+        releaseWholeLevel(); // Idle: the next request may be for another image or level
+    }
+}
+
+/**
+ * @brief Reads one tile from the image's pyramid, or decodes it; runs on a worker thread.
+ *
+ * Decodes reserve their predicted footprint in the loader's decode budget
+ * first, waiting for it if the gallery's decodes hold it.
+ *
+ * @param source The decode parameters of the image.
+ * @param key The tile.
+ * @return The tile, or a null image on failure.
+ */
+QImage TileLoader::decodeTile(const TileSource& source, const TileKey& key) {
+    const QImage stored = TilePyramid::readTile(source, key);
+    if (!stored.isNull()) {
+        return stored;
+    }
+
+    const QSize fullSize = source.orientedSize();
+    const QSize levelImageSize = levelSize(fullSize, key.level);
+    const QRect tileRect = QRect(key.tx * TILE_SIZE, key.ty * TILE_SIZE, TILE_SIZE, TILE_SIZE)
+                               .intersected(QRect(QPoint(0, 0), levelImageSize));
+    if (tileRect.isEmpty()) {
+        return QImage();
+    }
+    if (!decodesRegions(source)) {
+        return cutTile(source, key, tileRect);
+    }
+
+    // The tile in full-resolution coordinates of the oriented image
+    const qreal sx = qreal(fullSize.width()) / levelImageSize.width();
+    const qreal sy = qreal(fullSize.height()) / levelImageSize.height();
+    const QRect fullRect = QRectF(tileRect.x() * sx, tileRect.y() * sy, tileRect.width() * sx, tileRect.height() * sy)
+                               .toAlignedRect().intersected(QRect(QPoint(0, 0), fullSize));
+
+    // The JPEG reader reduces the clip by up to 8 while decoding, then scales it to the tile and it is oriented
+    const int reduction = qBound(1, fullRect.width() / qMax(1, tileRect.width()), 8);
+    const QSize clipSize((fullRect.width() + reduction - 1) / reduction, (fullRect.height() + reduction - 1) / reduction);
+    const qint64 bytes = MemoryBudget::estimateImageBytes(clipSize, QImage::Format_ARGB32_Premultiplied)
+                         + 2 * MemoryBudget::estimateImageBytes(tileRect.size(), QImage::Format_ARGB32_Premultiplied);
+    const qint64 reserved = m_loader->acquireDecodeMemory(bytes);
+    if (reserved < 0) {
+        return QImage(); // The loader is stopping its decodes
+    }
+    const QImage tile = decodeRegion(source, fullRect, tileRect.size());
+    m_loader->releaseDecodeMemory(reserved);
+    return tile;
+}
+
+/**
+ * @brief Cuts a tile from a whole level of an image, decoding the level if it is not the one kept.
+ *
+ * Without clip rectangles, every region of an image costs a decode of the
+ * whole image. Such images are decoded once per level instead: one worker
+ * decodes the level while the others wait for it, and the tiles are then
+ * copied out of it. The level is kept, with its memory reservation, until
+ * a tile of another level or image is wanted or the loader falls idle.
+ *
+ * @param source The decode parameters of the image.
+ * @param key The tile.
+ * @param tileRect The tile, in pixels of its level.
+ * @return The tile, or a null image on failure.
+ */
+QImage TileLoader::cutTile(const TileSource& source, const TileKey& key, const QRect& tileRect) {
+    QMutexLocker locker(&m_wholeMutex);
+    if (m_wholeLevel.isNull() || m_wholePyramid != source.pyramid || m_wholeLevelIndex != key.level) {
+        m_wholeLevel = QImage();
+        m_wholePyramid.clear();
+        if (m_wholeReservedBytes > 0) {
+            m_loader->releaseDecodeMemory(m_wholeReservedBytes);
+            m_wholeReservedBytes = 0;
+        }
+
+        // The reader decodes at full resolution, scales to the level, and the level is oriented
+        const QSize levelImageSize = levelSize(source.orientedSize(), key.level);
+        const qint64 levelBytes = MemoryBudget::estimateImageBytes(levelImageSize, QImage::Format_ARGB32_Premultiplied);
+        const qint64 bytes = MemoryBudget::estimateImageBytes(source.decodedSize, QImage::Format_ARGB32_Premultiplied)
+                             + 2 * levelBytes;
+        const qint64 reserved = m_loader->acquireDecodeMemory(bytes);
+        if (reserved < 0) {
+            return QImage(); // The loader is stopping its decodes
+        }
+        const QImage level = decodeRegion(source, QRect(QPoint(0, 0), source.orientedSize()), levelImageSize);
+        const qint64 kept = level.isNull() ? 0 : qMin(reserved, levelBytes);
+        m_loader->releaseDecodeMemory(reserved - kept); // Only the level itself stays
+        if (level.isNull()) {
+            return QImage();
+        }
+        m_wholeLevel = level;
+        m_wholePyramid = source.pyramid;
+        m_wholeLevelIndex = key.level;
+        m_wholeReservedBytes = kept;
+    }
+    return m_wholeLevel.copy(tileRect);
+}
+
+/**
+ * @brief Drops the whole level kept by cutTile() and returns its memory reservation.
+ *
+ * Called when no worker is running, so the lock is never held for long.
+ */
+void TileLoader::releaseWholeLevel() {
+    QMutexLocker locker(&m_wholeMutex);
+    m_wholeLevel = QImage();
+    m_wholePyramid.clear();
+    m_wholeLevelIndex = -1;
+    if (m_wholeReservedBytes > 0) {
+        m_loader->releaseDecodeMemory(m_wholeReservedBytes);
+        m_wholeReservedBytes = 0;
+    }
+}
+
+/**
+ * @brief Tells whether an image can be decoded a region at a time.
+ *
+ * Opens the file to ask its reader, so it is meant for worker threads.
+ *
+ * @param source The image.
+ * @return True if its reader supports clip rectangles (JPEG); false if every region costs a whole decode.
+ */
+bool TileLoader::decodesRegions(const TileSource& source) {
+    return QImageReader(source.path, source.format).supportsOption(QImageIOHandler::ClipRect);
+}
+
+/**
+ * @brief Decodes a region of an image from its file.
+ *
+ * The region is mapped back to the image as decoded and becomes the
+ * reader's clip rectangle; the scaled size then reduces it to `size`.
+ * Decoders that support both (JPEG) only decode the rows of the clip and
+ * use DCT scaling; the others decode the whole image and let QImageReader
+ * crop and scale it. RAW files are zoomed into through their embedded
+ * preview, which is what their metadata describes.
+ *
+ * @param source The image.
+ * @param region The region, in full-resolution pixels of the oriented image.
+ * @param size The size to decode the region to, oriented.
+ * @return The region in Format_RGB32 or Format_ARGB32_Premultiplied, or a null image on failure.
+ */
+QImage TileLoader::decodeRegion(const TileSource& source, const QRect& region, const QSize& size) {
+    QBuffer rawPreview; // Outlives the reader
+    QImageReader reader;
+    if (RawPreviewExtractor::isRawFile(source.path)) {
+        rawPreview.setData(RawPreviewExtractor::read(source.path));
+        rawPreview.open(QIODevice::ReadOnly);
+        reader.setDevice(&rawPreview);
+    } else {
+        reader.setFileName(source.path);
+    }
+    reader.setFormat(source.format);
+    reader.setAutoTransform(false); // Orientation is applied below, on the region only
+    reader.setClipRect(decodedRect(region, source.decodedSize, source.orientation));
+    reader.setScaledSize(orientedSize(size, source.orientation));
+    QImage decoded = reader.read();
+    if (decoded.isNull()) {
+        qDebug() << "Failed to decode region" << region << "of" << source.path << ":" << reader.errorString();
+        return QImage();
+    }
+
+    const QImage::Format format = decoded.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    if (decoded.format() != format) {
+        decoded = decoded.convertToFormat(format);
+    }
+    if (source.orientation == QImageIOHandler::TransformationNone) {
+        return decoded;
+    }
+    QImage oriented(orientedSize(decoded.size(), source.orientation), format);
+    PixelKernels::downscale(decoded, oriented, PixelKernels::PointFilter, source.orientation); // 1:1, oriented copy
+    return oriented;
+}
+
+/**
+ * @brief Caches a decoded tile and starts the next one; runs on the loader's thread.
+ *
+ * @param key The tile.
+ * @param tile The decoded tile.
+ * @param generation The value of `m_generation` when the tile was started.
+ */
+void TileLoader::onTileDecoded(const TileKey& key, const QImage& tile, int generation) {
+    --m_running;
+    if (generation == m_generation) {
+        m_decoding.removeOne(key);
+        if (!tile.isNull()) {
+            m_cache.insert(key, new QImage(tile), int(qMax<qint64>(1, tile.sizeInBytes() / 1024)));
+            emit tileLoaded(key);
+        }
+    }
+    startWantedTiles();
+}
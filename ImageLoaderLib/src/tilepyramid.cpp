@@ -0,0 +1,474 @@
+/**
+ * @file tilepyramid.cpp
+ * @brief Implementation of the TilePyramid class.
+ */
+#include "tilepyramid.h"
+#include "memorybudget.h"         // For predicting the memory of band decodes
+#include "pixelkernels.h"         // For halving tiles
+#include <QCryptographicHash>     // For naming pyramid directories
+#include <QDateTime>              // For file modification times
+#include <QDir>                   // For creating pyramid directories
+#include <QDirIterator>           // For measuring pyramids
+#include <QFile>                  // For looking up tiles
+#include <QFileInfo>              // For file size and modification time
+#include <QImageWriter>           // For encoding tiles
+#include <QPainter>               // For assembling the tiles of a quad
+#include <QSaveFile>              // For atomic tile writes
+#include <QStandardPaths>         // For the cache location
+#include <QThread>                // For QThread::idealThreadCount()
+#include <QDebug>                 // For debugging output
+#include <algorithm>              // For std::sort
+
+namespace {
+/**
+ * @brief JPEG quality of the stored tiles.
+ */
+constexpr int TILE_JPEG_QUALITY = 90;
+
+/**
+ * @brief Default capacity of the pyramid cache on disk (2 GiB).
+ */
+constexpr qint64 DEFAULT_PYRAMID_CACHE_CAPACITY = 2ll * 1024 * 1024 * 1024;
+
+/**
+ * @brief Returns the DZI number of the full-resolution level of an image.
+ *
+ * DZI level 0 is one pixel and each level doubles the previous one, so the
+ * full resolution is level ceil(log2(max(width, height))).
+ *
+ * @param fullSize The full-resolution size.
+ * @return The DZI level.
+ */
+int maxDziLevel(const QSize& fullSize) {
+    const int longest = qMax(fullSize.width(), fullSize.height());
+    int level = 0;
+    while (level < 31 && (1 << level) < longest) {
+        ++level;
+    }
+    return level;
+}
+
+/**
+ * @brief Returns the directory holding the tiles of one level.
+ */
+QString levelDirectory(const QString& pyramid, int dziLevel) {
+    return QStringLiteral("%1/image_files/%2").arg(pyramid).arg(dziLevel);
+}
+
+/**
+ * @brief Returns the path of a tile file.
+ */
+QString tilePath(const QString& pyramid, int dziLevel, int tx, int ty, const char* extension) {
+    return QStringLiteral("%1/%2_%3.%4").arg(levelDirectory(pyramid, dziLevel)).arg(tx).arg(ty).arg(QLatin1String(extension));
+}
+
+/**
+ * @brief Loads a stored tile.
+ *
+ * @return The tile in Format_RGB32 or Format_ARGB32_Premultiplied, or a null image if it is not on disk.
+ */
+QImage loadTile(const QString& pyramid, int dziLevel, int tx, int ty) {
+    for (const char* extension : { "jpg", "png" }) {
+        const QString path = tilePath(pyramid, dziLevel, tx, ty, extension);
+        if (!QFile::exists(path)) {
+            continue;
+        }
+        QImage tile(path);
+        if (tile.isNull()) {
+            return tile;
+        }
+        const QImage::Format format = tile.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+        return tile.format() == format ? tile : tile.convertToFormat(format);
+    }
+    return QImage();
+}
+
+/**
+ * @brief Stores a tile: JPEG if it is opaque, PNG otherwise.
+ *
+ * @return False if the tile could not be written.
+ */
+bool writeTile(const QImage& tile, const QString& pyramid, int dziLevel, int tx, int ty) {
+    const bool alpha = tile.hasAlphaChannel();
+    QSaveFile file(tilePath(pyramid, dziLevel, tx, ty, alpha ? "png" : "jpg"));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QImageWriter writer(&file, alpha ? "png" : "jpeg");
+    if (!alpha) {
+        writer.setQuality(TILE_JPEG_QUALITY);
+    }
+    if (!writer.write(tile)) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit(); // Readers never see a half-written tile
+}
+}
+
+/**
+ * @brief Constructs the pyramid store in the application's cache directory.
+ *
+ * @param loader The loader whose decode budget the builds reserve memory in.
+ */
+TilePyramid::TilePyramid(ImageLoader* loader)
+    : m_loader(loader),
+    m_capacity(DEFAULT_PYRAMID_CACHE_CAPACITY),
+    m_cancelled(0)
+{
+    QString cache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (cache.isEmpty()) {
+        cache = QDir::tempPath();
+    }
+    m_root = cache + QStringLiteral("/pyramids");
+
+    // Builds are background work: they must not compete with what is on screen
+    m_builder.setMaxThreadCount(1);
+    m_builder.setThreadPriority(QThread::LowPriority);
+    m_workers.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_workers.setThreadPriority(QThread::LowPriority);
+}
+
+/**
+ * @brief Stops the build in progress and drops those not started.
+ *
+ * The pyramid being built stays incomplete; its tiles remain usable and
+ * it is built again the next time it is requested.
+ */
+TilePyramid::~TilePyramid() {
+    m_cancelled.storeRelaxed(1);
+    m_builder.clear();
+    m_builder.waitForDone();
+    m_workers.waitForDone();
+}
+
+/**
+ * @brief Returns the directory of the pyramid of a file.
+ *
+ * The name hashes the path with the size and modification time of the
+ * file, so a modified file never reads the tiles of its previous version.
+ *
+ * @param path The image file.
+ * @return The pyramid directory; it may not exist yet.
+ */
+QString TilePyramid::directoryFor(const QString& path) const {
+    const QFileInfo info(path);
+    const QString identity = QStringLiteral("%1|%2|%3")
+                                 .arg(info.absoluteFilePath())
+                                 .arg(info.size())
+                                 .arg(info.lastModified().toMSecsSinceEpoch());
+    const QByteArray hash = QCryptographicHash::hash(identity.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return m_root + QLatin1Char('/') + QString::fromLatin1(hash);
+}
+
+/**
+ * @brief Sets how many bytes of pyramids the disk cache may hold.
+ *
+ * Takes effect after the next build.
+ *
+ * @param bytes The capacity in bytes.
+ */
+void TilePyramid::setCapacity(qint64 bytes) {
+    QMutexLocker locker(&m_mutex);
+    m_capacity = qMax<qint64>(0, bytes);
+}
+
+/**
+ * @brief Schedules the build of a pyramid, unless it was already requested.
+ *
+ * @param source The image; its `pyramid` must be set.
+ */
+void TilePyramid::build(const TileSource& source) {
+    if (source.pyramid.isEmpty()) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_requested.contains(source.pyramid)) {
+            return;
+        }
+        m_requested.insert(source.pyramid);
+    }
+    m_builder.start([this, source]() { buildNow(source); });
+}
+
+/**
+ * @brief Reads a tile from the pyramid of an image.
+ *
+ * @param source The image.
+ * @param key The tile, with TileLoader's level numbering (0 is the full resolution).
+ * @return The tile in Format_RGB32 or Format_ARGB32_Premultiplied, or a null image if it is not on disk.
+ */
+QImage TilePyramid::readTile(const TileSource& source, const TileKey& key) {
+    if (source.pyramid.isEmpty()) {
+        return QImage();
+    }
+    const int dziLevel = maxDziLevel(source.orientedSize()) - key.level;
+    if (dziLevel < 0) {
+        return QImage();
+    }
+    return loadTile(source.pyramid, dziLevel, key.tx, key.ty);
+}
+
+/**
+ * @brief Builds a pyramid; runs on the builder thread.
+ *
+ * The full-resolution level is decoded from the original; every coarser
+ * level is then made by halving the tiles of the level above, so the
+ * original is decoded only once. The descriptor is written last.
+ *
+ * @param source The image.
+ */
+void TilePyramid::buildNow(const TileSource& source) {
+    const QString descriptor = source.pyramid + QStringLiteral("/image.dzi");
+    if (m_cancelled.loadRelaxed()) {
+        return;
+    }
+    if (QFile::exists(descriptor)) {
+        // Built in an earlier session: mark it used, for the pruning
+        QFile file(descriptor);
+        if (file.open(QIODevice::ReadWrite)) {
+            file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return;
+    }
+
+    const QSize fullSize = source.orientedSize();
+    const int maxLevel = maxDziLevel(fullSize);
+    qDebug() << "Building tile pyramid for" << source.path << "in" << source.pyramid;
+
+    bool built = buildFullLevel(source, maxLevel);
+    for (int level = maxLevel - 1; built && level >= 0; --level) {
+        built = buildReducedLevel(source, level, maxLevel);
+    }
+    if (!built) {
+        qDebug() << "Tile pyramid for" << source.path << "left incomplete";
+        prune(source.pyramid);
+        return;
+    }
+
+    const bool png = QFile::exists(tilePath(source.pyramid, maxLevel, 0, 0, "png"));
+    QSaveFile file(descriptor);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QStringLiteral("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                  "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" "
+                                  "TileSize=\"%1\" Overlap=\"0\" Format=\"%2\">\n"
+                                  "  <Size Width=\"%3\" Height=\"%4\"/>\n"
+                                  "</Image>\n")
+                       .arg(TileLoader::tileSize())
+                       .arg(png ? QStringLiteral("png") : QStringLiteral("jpg"))
+                       .arg(fullSize.width())
+                       .arg(fullSize.height())
+                       .toUtf8());
+        file.commit();
+    }
+    prune(source.pyramid);
+}
+
+/**
+ * @brief Writes the tiles of the full-resolution level, one band of tiles at a time.
+ *
+ * Bands follow the rows of the image as decoded, so that each is a single
+ * run of rows for the decoder: rows of tiles, or columns of tiles when the
+ * orientation rotates the image. Every band decode reads the file from the
+ * top again, so bands are as tall as half the decode budget allows, and
+ * an image that fits is decoded in one pass. Decoders without clip
+ * rectangles always decode the whole image, which is then done once.
+ *
+ * @param source The image.
+ * @param dziLevel The DZI number of the full-resolution level.
+ * @return False if decoding failed or the build was cancelled.
+ */
+bool TilePyramid::buildFullLevel(const TileSource& source, int dziLevel) {
+    const int tileSize = TileLoader::tileSize();
+    const QSize fullSize = source.orientedSize();
+    if (!QDir().mkpath(levelDirectory(source.pyramid, dziLevel))) {
+        return false;
+    }
+
+    const bool columns = source.orientation.testFlag(QImageIOHandler::TransformationRotate90);
+    const int bandLength = columns ? fullSize.height() : fullSize.width();
+    const int tileLines = ((columns ? fullSize.width() : fullSize.height()) + tileSize - 1) / tileSize;
+    const bool banded = TileLoader::decodesRegions(source);
+    int linesPerBand = tileLines;
+    if (banded) {
+        // A band is decoded, then oriented into a second buffer
+        const qint64 lineBytes = 2 * MemoryBudget::estimateImageBytes(QSize(bandLength, tileSize), QImage::Format_ARGB32_Premultiplied);
+        linesPerBand = int(qBound<qint64>(1, m_loader->decodeMemoryBudget() / 2 / qMax<qint64>(1, lineBytes), tileLines));
+    }
+
+    QAtomicInt failures(0);
+    for (int first = 0; first < tileLines; first += linesPerBand) {
+        if (m_cancelled.loadRelaxed()) {
+            return false;
+        }
+        const int lines = qMin(linesPerBand, tileLines - first);
+        const QRect bandRect = (columns ? QRect(first * tileSize, 0, lines * tileSize, fullSize.height())
+                                        : QRect(0, first * tileSize, fullSize.width(), lines * tileSize))
+                                   .intersected(QRect(QPoint(0, 0), fullSize));
+        const QSize decodedBand = banded ? bandRect.size() : source.decodedSize;
+        const qint64 reserved = m_loader->acquireDecodeMemory(
+            MemoryBudget::estimateImageBytes(decodedBand, QImage::Format_ARGB32_Premultiplied)
+            + MemoryBudget::estimateImageBytes(bandRect.size(), QImage::Format_ARGB32_Premultiplied));
+        if (reserved < 0) {
+            return false; // The loader is stopping its decodes
+        }
+        const QImage band = TileLoader::decodeRegion(source, bandRect, bandRect.size());
+        if (band.isNull()) {
+            m_loader->releaseDecodeMemory(reserved);
+            return false;
+        }
+
+        // Encoding dominates: the tiles of the band are written in parallel
+        for (int ty = bandRect.top() / tileSize; ty * tileSize <= bandRect.bottom(); ++ty) {
+            for (int tx = bandRect.left() / tileSize; tx * tileSize <= bandRect.right(); ++tx) {
+                m_workers.start([&source, &failures, band, bandRect, dziLevel, tileSize, tx, ty]() {
+                    const QRect tileRect = QRect(tx * tileSize, ty * tileSize, tileSize, tileSize).intersected(bandRect);
+                    const QImage tile = band.copy(tileRect.translated(-bandRect.topLeft()));
+                    if (!writeTile(tile, source.pyramid, dziLevel, tx, ty)) {
+                        failures.ref();
+                    }
+                });
+            }
+        }
+        m_workers.waitForDone(); // One band in memory at a time
+        m_loader->releaseDecodeMemory(reserved);
+        if (failures.loadRelaxed()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the tiles of a level by halving the tiles of the level above.
+ *
+ * Each tile covers a quad of up to 2x2 tiles of the level above, which are
+ * read back from disk, assembled and reduced with the box filter.
+ *
+ * @param source The image.
+ * @param dziLevel The DZI number of the level to write.
+ * @param maxDziLevel The DZI number of the full-resolution level.
+ * @return False if a tile could not be written or the build was cancelled.
+ */
+bool TilePyramid::buildReducedLevel(const TileSource& source, int dziLevel, int maxDziLevel) {
+    const int tileSize = TileLoader::tileSize();
+    const QSize levelSize = TileLoader::levelSize(source.orientedSize(), maxDziLevel - dziLevel);
+    const QSize parentSize = TileLoader::levelSize(source.orientedSize(), maxDziLevel - dziLevel - 1);
+    if (!QDir().mkpath(levelDirectory(source.pyramid, dziLevel))) {
+        return false;
+    }
+
+    QAtomicInt failures(0);
+    const QString& pyramid = source.pyramid;
+    for (int ty = 0; ty * tileSize < levelSize.height(); ++ty) {
+        for (int tx = 0; tx * tileSize < levelSize.width(); ++tx) {
+            m_workers.start([this, &pyramid, &failures, levelSize, parentSize, dziLevel, tileSize, tx, ty]() {
+                if (m_cancelled.loadRelaxed() || failures.loadRelaxed()) {
+                    return;
+                }
+                // The quad of parent tiles this tile covers
+                QImage parents[2][2];
+                bool alpha = false;
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        const int px = 2 * tx + dx;
+                        const int py = 2 * ty + dy;
+                        if (px * tileSize >= parentSize.width() || py * tileSize >= parentSize.height()) {
+                            continue;
+                        }
+                        parents[dy][dx] = loadTile(pyramid, dziLevel + 1, px, py);
+                        if (parents[dy][dx].isNull()) {
+                            failures.ref();
+                            return;
+                        }
+                        alpha = alpha || parents[dy][dx].hasAlphaChannel();
+                    }
+                }
+
+                const QImage::Format format = alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+                const QSize quadSize(qMin(2 * tileSize, parentSize.width() - 2 * tx * tileSize),
+                                     qMin(2 * tileSize, parentSize.height() - 2 * ty * tileSize));
+                QImage quad(quadSize, format);
+                QPainter painter(&quad);
+                painter.setCompositionMode(QPainter::CompositionMode_Source);
+                for (int dy = 0; dy < 2; ++dy) {
+                    for (int dx = 0; dx < 2; ++dx) {
+                        if (!parents[dy][dx].isNull()) {
+                            painter.drawImage(QPoint(dx * tileSize, dy * tileSize), parents[dy][dx]);
+                        }
+                    }
+                }
+                painter.end();
+
+                const QSize tileDims(qMin(tileSize, levelSize.width() - tx * tileSize),
+                                     qMin(tileSize, levelSize.height() - ty * tileSize));
+                QImage tile(tileDims, format);
+                PixelKernels::downscale(quad, tile, PixelKernels::BoxFilter);
+                if (!writeTile(tile, pyramid, dziLevel, tx, ty)) {
+                    failures.ref();
+                }
+            });
+        }
+    }
+    m_workers.waitForDone();
+    return !m_cancelled.loadRelaxed() && !failures.loadRelaxed();
+}
+
+/**
+ * @brief Deletes the least recently used pyramids until the cache fits its capacity; runs on the builder thread.
+ *
+ * A pyramid was last used when its descriptor was written or touched by a
+ * later request; incomplete pyramids count from their directory's last
+ * change. Deleted pyramids may be built again in this session.
+ *
+ * @param keep The pyramid just built, which is never deleted.
+ */
+void TilePyramid::prune(const QString& keep) {
+    qint64 capacity;
+    {
+        QMutexLocker locker(&m_mutex);
+        capacity = m_capacity;
+    }
+
+    struct Entry {
+        QString path;      ///< The pyramid directory.
+        QDateTime used;    ///< When the pyramid was last used.
+        qint64 bytes = 0;  ///< Size of its files.
+    };
+    QVector<Entry> entries;
+    qint64 total = 0;
+    const QFileInfoList directories = QDir(m_root).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QFileInfo& directory : directories) {
+        Entry entry;
+        entry.path = m_root + QLatin1Char('/') + directory.fileName();
+        const QFileInfo descriptor(entry.path + QStringLiteral("/image.dzi"));
+        entry.used = descriptor.exists() ? descriptor.lastModified() : directory.lastModified();
+        QDirIterator it(entry.path, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            it.next();
+            entry.bytes += it.fileInfo().size();
+        }
+        total += entry.bytes;
+        entries.append(entry);
+    }
+    if (total <= capacity) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.used < b.used;
+    });
+    for (const Entry& entry : std::as_const(entries)) {
+        if (total <= capacity) {
+            break;
+        }
+        if (entry.path == keep || !QDir(entry.path).removeRecursively()) {
+            continue;
+        }
+        total -= entry.bytes;
+        QMutexLocker locker(&m_mutex);
+        m_requested.remove(entry.path);
+    }
+    qDebug() << "Tile pyramid cache pruned to" << total << "bytes";
+}
@@ -0,0 +1,133 @@
+/**
+ * @file tilepyramid.h
+ * @brief Declaration of the TilePyramid class, which stores Deep Zoom tile pyramids in the disk cache.
+ *
+ * This file defines the TilePyramid class. For an image that is zoomed into,
+ * it builds in the background every tile of every level, in the Deep Zoom
+ * (DZI) layout, under the application's cache directory. Once a tile is on
+ * disk, TileLoader reads it instead of decoding a region of the original:
+ * zoomed viewing of a pyramid costs one small file read per tile, with
+ * memory bounded by the tile size whatever the size or format of the image.
+ */
+#ifndef IMAGELOADERLIB_TILEPYRAMID_H
+#define IMAGELOADERLIB_TILEPYRAMID_H
+
+#include "tileloader.h"  // For TileSource and TileKey
+
+#include <QAtomicInt>    // For cancellation
+#include <QMutex>        // For the set of requested pyramids
+#include <QSet>          // For the set of requested pyramids
+#include <QString>       // For cache paths
+#include <QThreadPool>   // For the builder and tile threads
+
+/**
+ * @brief Builds and reads Deep Zoom tile pyramids in the disk cache.
+ *
+ * A pyramid lives in a directory named after the file's path, size and
+ * modification time, so editing a file gives it a new pyramid. Inside it
+ * follows the DZI layout: `image.dzi` describes the image and
+ * `image_files/<level>/<column>_<row>.<ext>` holds the tiles, DZI level 0
+ * being a single pixel and the last level the full resolution. Tiles have
+ * no overlap; they are JPEG, or PNG for images with an alpha channel.
+ *
+ * Builds run one at a time on a builder thread, which spreads the tiles of
+ * each level over a pool of workers. Every tile file is written atomically,
+ * so readers can use a pyramid while it is being built; `image.dzi` is
+ * written last and marks the pyramid complete. The original is decoded in
+ * as few passes as the ImageLoader's decode budget allows, with the memory
+ * reserved in that budget.
+ *
+ * The cache is bounded: after each build, the least recently used
+ * pyramids are deleted until the cache fits its capacity.
+ *
+ * All methods are thread-safe.
+ */
+class TilePyramid {
+public:
+    /**
+     * @brief Constructs the pyramid store in the application's cache directory.
+     *
+     * @param loader The loader whose decode budget the builds reserve memory in.
+     */
+    explicit TilePyramid(ImageLoader* loader);
+
+    /**
+     * @brief Stops the build in progress and drops those not started.
+     */
+    ~TilePyramid();
+
+    /**
+     * @brief Returns the directory of the pyramid of a file.
+     *
+     * @param path The image file.
+     * @return The pyramid directory; it may not exist yet.
+     */
+    QString directoryFor(const QString& path) const;
+
+    /**
+     * @brief Sets how many bytes of pyramids the disk cache may hold.
+     * @param bytes The capacity in bytes.
+     */
+    void setCapacity(qint64 bytes);
+
+    /**
+     * @brief Schedules the build of a pyramid, unless it was already requested.
+     *
+     * @param source The image; its `pyramid` must be set.
+     */
+    void build(const TileSource& source);
+
+    /**
+     * @brief Reads a tile from the pyramid of an image.
+     *
+     * @param source The image.
+     * @param key The tile, with TileLoader's level numbering (0 is the full resolution).
+     * @return The tile in Format_RGB32 or Format_ARGB32_Premultiplied, or a null image if it is not on disk.
+     */
+    static QImage readTile(const TileSource& source, const TileKey& key);
+
+private:
+    /**
+     * @brief Builds a pyramid; runs on the builder thread.
+     *
+     * @param source The image.
+     */
+    void buildNow(const TileSource& source);
+
+    /**
+     * @brief Writes the tiles of the full-resolution level, one band of tiles at a time.
+     *
+     * @param source The image.
+     * @param dziLevel The DZI number of the full-resolution level.
+     * @return False if decoding failed or the build was cancelled.
+     */
+    bool buildFullLevel(const TileSource& source, int dziLevel);
+
+    /**
+     * @brief Writes the tiles of a level by halving the tiles of the level above.
+     *
+     * @param source The image.
+     * @param dziLevel The DZI number of the level to write.
+     * @param maxDziLevel The DZI number of the full-resolution level.
+     * @return False if a tile could not be written or the build was cancelled.
+     */
+    bool buildReducedLevel(const TileSource& source, int dziLevel, int maxDziLevel);
+
+    /**
+     * @brief Deletes the least recently used pyramids until the cache fits its capacity; runs on the builder thread.
+     *
+     * @param keep The pyramid just built, which is never deleted.
+     */
+    void prune(const QString& keep);
+
+    ImageLoader* m_loader;       ///< Provides the decode budget.
+    QString m_root;              ///< Directory holding one sub-directory per pyramid.
+    QThreadPool m_builder;       ///< Runs one build at a time.
+    QThreadPool m_workers;       ///< Encodes and reduces the tiles of a build.
+    mutable QMutex m_mutex;      ///< Guards `m_requested` and `m_capacity`.
+    QSet<QString> m_requested;   ///< Pyramid directories built or queued during this session.
+    qint64 m_capacity;           ///< Bytes of pyramids the cache may hold.
+    QAtomicInt m_cancelled;      ///< Set by the destructor to stop the build in progress.
+};
+
+#endif // IMAGELOADERLIB_TILEPYRAMID_H
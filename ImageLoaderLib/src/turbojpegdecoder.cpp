@@ -0,0 +1,172 @@
+/**
+ * @file turbojpegdecoder.cpp
+ * @brief Implementation of the TurboJpegDecoder class.
+ */
+#include "turbojpegdecoder.h"
+#include <QDebug>        // For debugging output
+#include <QtEndian>      // For Q_BYTE_ORDER
+#include <turbojpeg.h>   // For the TurboJPEG API
+#include <limits>        // For the largest length TurboJPEG accepts
+
+namespace {
+/**
+ * @brief A TurboJPEG decompressor owned by one thread.
+ */
+struct ThreadHandle {
+    tjhandle handle = tjInitDecompress(); ///< The decompressor; null if it could not be created.
+
+    /**
+     * @brief Destroys the decompressor when the thread exits.
+     */
+    ~ThreadHandle() {
+        if (handle) {
+            tjDestroy(handle);
+        }
+    }
+};
+
+/**
+ * @brief Returns the calling thread's decompressor, creating it on first use.
+ * @return The handle, or null if TurboJPEG could not allocate one.
+ */
+tjhandle threadHandle() {
+    thread_local ThreadHandle handle;
+    return handle.handle;
+}
+
+/**
+ * @brief TurboJPEG pixel format whose bytes are laid out like Format_RGB32 (0xffRRGGBB words).
+ */
+constexpr int RGB32_PIXEL_FORMAT = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? TJPF_BGRA : TJPF_ARGB;
+
+/**
+ * @brief Parses the JPEG header.
+ *
+ * @param handle The calling thread's decompressor.
+ * @param input The encoded image.
+ * @param header Receives the dimensions and output format.
+ * @return False for malformed headers, for CMYK/YCCK files and for inputs larger than an unsigned long.
+ */
+bool readJpegHeader(tjhandle handle, const ImageDecoder::Input& input, ImageDecoder::Header* header) {
+    if (quint64(input.size) > std::numeric_limits<unsigned long>::max()) {
+        return false; // TurboJPEG takes an unsigned long length, 32 bits on Windows: refuse rather than truncate
+    }
+    int width = 0;
+    int height = 0;
+    int subsampling = 0;
+    int colorspace = 0;
+    if (!handle || tjDecompressHeader3(handle, input.data, static_cast<unsigned long>(input.size),
+                                       &width, &height, &subsampling, &colorspace) != 0) {
+        return false;
+    }
+    if (colorspace == TJCS_CMYK || colorspace == TJCS_YCCK) {
+        return false; // TurboJPEG cannot convert these to RGB; Qt's plugin can
+    }
+    header->size = QSize(width, height);
+    header->pixelFormat = (colorspace == TJCS_GRAY) ? QImage::Format_Grayscale8 : QImage::Format_RGB32;
+    return true;
+}
+}
+
+/**
+ * @brief Returns "libjpeg-turbo".
+ * @return The backend name.
+ */
+QByteArray TurboJpegDecoder::name() const {
+    return QByteArrayLiteral("libjpeg-turbo");
+}
+
+/**
+ * @brief Tells whether the bytes start with a JPEG SOI marker.
+ *
+ * @param data The encoded bytes.
+ * @param size The number of encoded bytes.
+ * @return True for JPEG.
+ */
+bool TurboJpegDecoder::canDecode(const uchar* data, qint64 size) const {
+    return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+/**
+ * @brief Parses the JPEG header.
+ *
+ * @param input The encoded image.
+ * @param header Receives the dimensions and output format.
+ * @return False for malformed headers and for CMYK/YCCK files.
+ */
+bool TurboJpegDecoder::readHeader(const Input& input, Header* header) const {
+    return readJpegHeader(threadHandle(), input, header);
+}
+
+/**
+ * @brief Returns true: JPEG scales in the DCT domain.
+ *
+ * @param input The encoded image.
+ * @return True.
+ */
+bool TurboJpegDecoder::supportsScaledDecode(const Input& input) const {
+    Q_UNUSED(input);
+    return true;
+}
+
+/**
+ * @brief Returns the smallest DCT-scaled size covering the request.
+ *
+ * @param fullSize The full-resolution dimensions.
+ * @param requested The wanted dimensions.
+ * @return The scaled dimensions, at least `requested` unless that exceeds the full size.
+ */
+QSize TurboJpegDecoder::scaledDecodeSize(const QSize& fullSize, const QSize& requested) const {
+    int count = 0;
+    const tjscalingfactor* factors = tjGetScalingFactors(&count);
+    QSize best = fullSize;
+    for (int i = 0; factors && i < count; ++i) {
+        const tjscalingfactor factor = factors[i];
+        if (factor.num > factor.denom) {
+            continue; // Never enlarge
+        }
+        const QSize scaled(TJSCALED(fullSize.width(), factor), TJSCALED(fullSize.height(), factor));
+        if (scaled.width() >= requested.width() && scaled.height() >= requested.height()
+            && qint64(scaled.width()) * scaled.height() < qint64(best.width()) * best.height()) {
+            best = scaled;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Decodes the pixels.
+ *
+ * TurboJPEG picks the scaling factor from the destination dimensions, so
+ * passing a size from scaledDecodeSize() selects that factor exactly.
+ *
+ * @param input The encoded image.
+ * @param size The full size, or a size returned by scaledDecodeSize().
+ * @param image In: an optional buffer to decode into. Out: the pixels.
+ * @return True on success; truncated files decode with a warning and count as success.
+ */
+bool TurboJpegDecoder::decode(const Input& input, const QSize& size, QImage* image) const {
+    const tjhandle handle = threadHandle();
+    Header header;
+    if (!readJpegHeader(handle, input, &header) || size.isEmpty()) {
+        return false;
+    }
+    if (image->size() != size || image->format() != header.pixelFormat) {
+        *image = QImage(size, header.pixelFormat);
+        if (image->isNull()) {
+            return false;
+        }
+    }
+
+    const int pixelFormat = (header.pixelFormat == QImage::Format_Grayscale8) ? TJPF_GRAY : RGB32_PIXEL_FORMAT;
+    if (tjDecompress2(handle, input.data, static_cast<unsigned long>(input.size), image->bits(),
+                      size.width(), int(image->bytesPerLine()), size.height(), pixelFormat, 0) != 0) {
+        if (tjGetErrorCode(handle) == TJERR_WARNING) {
+            qDebug() << "libjpeg-turbo warning:" << tjGetErrorStr2(handle); // Truncated or slightly corrupt: keep what was decoded
+            return true;
+        }
+        qDebug() << "libjpeg-turbo error:" << tjGetErrorStr2(handle);
+        return false;
+    }
+    return true;
+}
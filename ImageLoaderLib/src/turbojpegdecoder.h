@@ -0,0 +1,74 @@
+/**
+ * @file turbojpegdecoder.h
+ * @brief Declaration of the TurboJpegDecoder class, which decodes JPEG through libjpeg-turbo.
+ */
+#ifndef IMAGELOADERLIB_TURBOJPEGDECODER_H
+#define IMAGELOADERLIB_TURBOJPEGDECODER_H
+
+#include "imagedecoder.h"
+
+/**
+ * @brief Decodes JPEG with the TurboJPEG API: SIMD IDCT and colour conversion, DCT scaling.
+ *
+ * Colour images are decoded straight to Format_RGB32 and greyscale ones to
+ * Format_Grayscale8, so no conversion pass follows. Reduced resolutions use
+ * the scaling factors libjpeg-turbo supports (multiples of 1/8), which skip
+ * most of the IDCT work. CMYK and YCCK files are left to Qt.
+ *
+ * TurboJPEG handles are not thread-safe; each worker thread keeps its own.
+ */
+class TurboJpegDecoder : public ImageDecoder {
+public:
+    /**
+     * @brief Returns "libjpeg-turbo".
+     * @return The backend name.
+     */
+    QByteArray name() const override;
+
+    /**
+     * @brief Tells whether the bytes start with a JPEG SOI marker.
+     *
+     * @param data The encoded bytes.
+     * @param size The number of encoded bytes.
+     * @return True for JPEG.
+     */
+    bool canDecode(const uchar* data, qint64 size) const override;
+
+    /**
+     * @brief Parses the JPEG header.
+     *
+     * @param input The encoded image.
+     * @param header Receives the dimensions and output format.
+     * @return False for malformed headers and for CMYK/YCCK files.
+     */
+    bool readHeader(const Input& input, Header* header) const override;
+
+    /**
+     * @brief Returns true: JPEG scales in the DCT domain.
+     *
+     * @param input The encoded image.
+     * @return True.
+     */
+    bool supportsScaledDecode(const Input& input) const override;
+
+    /**
+     * @brief Returns the smallest DCT-scaled size covering the request.
+     *
+     * @param fullSize The full-resolution dimensions.
+     * @param requested The wanted dimensions.
+     * @return The scaled dimensions, at least `requested` unless that exceeds the full size.
+     */
+    QSize scaledDecodeSize(const QSize& fullSize, const QSize& requested) const override;
+
+    /**
+     * @brief Decodes the pixels.
+     *
+     * @param input The encoded image.
+     * @param size The full size, or a size returned by scaledDecodeSize().
+     * @param image In: an optional buffer to decode into. Out: the pixels.
+     * @return True on success; truncated files decode with a warning and count as success.
+     */
+    bool decode(const Input& input, const QSize& size, QImage* image) const override;
+};
+
+#endif // IMAGELOADERLIB_TURBOJPEGDECODER_H
@@ -0,0 +1,138 @@
+/**
+ * @file webpdecoder.cpp
+ * @brief Implementation of the WebpDecoder class.
+ */
+#include "webpdecoder.h"
+#include <QDebug>         // For debugging output
+#include <QtEndian>       // For Q_BYTE_ORDER
+#include <webp/decode.h>  // For libwebp
+#include <cstring>        // For std::memcmp
+#include <limits>         // For the largest length libwebp accepts
+
+namespace {
+/**
+ * @brief libwebp colour mode laid out like Format_ARGB32_Premultiplied.
+ */
+constexpr WEBP_CSP_MODE PREMULTIPLIED_MODE = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? MODE_bgrA : MODE_Argb;
+
+/**
+ * @brief libwebp colour mode laid out like Format_RGB32 (alpha written as 0xFF).
+ */
+constexpr WEBP_CSP_MODE OPAQUE_MODE = (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) ? MODE_BGRA : MODE_ARGB;
+
+/**
+ * @brief Reads the bitstream features.
+ *
+ * @param input The encoded image.
+ * @param features Receives the features.
+ * @param header Receives the dimensions and output format.
+ * @return False for malformed headers, animations and inputs larger than size_t can address.
+ */
+bool readWebpHeader(const ImageDecoder::Input& input, WebPBitstreamFeatures* features, ImageDecoder::Header* header) {
+    if (quint64(input.size) > std::numeric_limits<size_t>::max()) {
+        return false; // libwebp takes a size_t length: refuse rather than truncate
+    }
+    if (WebPGetFeatures(input.data, size_t(input.size), features) != VP8_STATUS_OK || features->has_animation) {
+        return false;
+    }
+    header->size = QSize(features->width, features->height);
+    header->pixelFormat = features->has_alpha ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    return header->size.isValid();
+}
+}
+
+/**
+ * @brief Returns "libwebp".
+ * @return The backend name.
+ */
+QByteArray WebpDecoder::name() const {
+    return QByteArrayLiteral("libwebp");
+}
+
+/**
+ * @brief Tells whether the bytes start with a RIFF/WEBP header.
+ *
+ * @param data The encoded bytes.
+ * @param size The number of encoded bytes.
+ * @return True for WebP.
+ */
+bool WebpDecoder::canDecode(const uchar* data, qint64 size) const {
+    return size >= 12 && std::memcmp(data, "RIFF", 4) == 0 && std::memcmp(data + 8, "WEBP", 4) == 0;
+}
+
+/**
+ * @brief Parses the WebP header.
+ *
+ * @param input The encoded image.
+ * @param header Receives the dimensions and output format.
+ * @return False for malformed headers and animations.
+ */
+bool WebpDecoder::readHeader(const Input& input, Header* header) const {
+    WebPBitstreamFeatures features;
+    return readWebpHeader(input, &features, header);
+}
+
+/**
+ * @brief Returns true: libwebp scales the output rows while decoding.
+ *
+ * Only the output buffer shrinks; the bitstream is still decoded in full.
+ *
+ * @param input The encoded image.
+ * @return True.
+ */
+bool WebpDecoder::supportsScaledDecode(const Input& input) const {
+    Q_UNUSED(input);
+    return true;
+}
+
+/**
+ * @brief Returns false: libwebp decodes every pixel whatever the output size.
+ *
+ * @param input The encoded image.
+ * @return False.
+ */
+bool WebpDecoder::cheapScaledDecode(const Input& input) const {
+    Q_UNUSED(input);
+    return false;
+}
+
+/**
+ * @brief Decodes the pixels.
+ *
+ * @param input The encoded image.
+ * @param size The size to decode at.
+ * @param image In: an optional buffer to decode into. Out: the pixels.
+ * @return True on success.
+ */
+bool WebpDecoder::decode(const Input& input, const QSize& size, QImage* image) const {
+    WebPDecoderConfig config;
+    Header header;
+    if (size.isEmpty() || !WebPInitDecoderConfig(&config) || !readWebpHeader(input, &config.input, &header)) {
+        return false;
+    }
+    if (image->size() != size || image->format() != header.pixelFormat) {
+        *image = QImage(size, header.pixelFormat);
+        if (image->isNull()) {
+            return false;
+        }
+    }
+
+    if (size != header.size) {
+        config.options.use_scaling = 1;
+        config.options.scaled_width = size.width();
+        config.options.scaled_height = size.height();
+    }
+    config.output.colorspace = config.input.has_alpha ? PREMULTIPLIED_MODE : OPAQUE_MODE;
+    config.output.is_external_memory = 1; // Decode into the caller's (pooled) buffer
+    config.output.u.RGBA.rgba = image->bits();
+    config.output.u.RGBA.stride = int(image->bytesPerLine());
+    config.output.u.RGBA.size = size_t(image->sizeInBytes());
+
+    const VP8StatusCode status = WebPDecode(input.data, size_t(input.size), &config);
+    WebPFreeDecBuffer(&config.output); // Nothing to free for external memory, but keeps libwebp's bookkeeping balanced
+    if (status != VP8_STATUS_OK) {
+        qDebug() << "libwebp error: status" << int(status);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+/**
+ * @file webpdecoder.h
+ * @brief Declaration of the WebpDecoder class, which decodes still WebP images through libwebp.
+ */
+#ifndef IMAGELOADERLIB_WEBPDECODER_H
+#define IMAGELOADERLIB_WEBPDECODER_H
+
+#include "imagedecoder.h"
+
+/**
+ * @brief Decodes still WebP images with libwebp's advanced decoding API.
+ *
+ * Pixels are written straight in Qt's 32-bit layouts: premultiplied for
+ * images with alpha, opaque Format_RGB32 otherwise, so no conversion pass
+ * follows. libwebp scales while decoding to any size, at a fraction of the
+ * cost of a full decode followed by a downscale. Animated files are left to
+ * Qt, which decodes their first frame.
+ */
+class WebpDecoder : public ImageDecoder {
+public:
+    /**
+     * @brief Returns "libwebp".
+     * @return The backend name.
+     */
+    QByteArray name() const override;
+
+    /**
+     * @brief Tells whether the bytes start with a RIFF/WEBP header.
+     *
+     * @param data The encoded bytes.
+     * @param size The number of encoded bytes.
+     * @return True for WebP.
+     */
+    bool canDecode(const uchar* data, qint64 size) const override;
+
+    /**
+     * @brief Parses the WebP header.
+     *
+     * @param input The encoded image.
+     * @param header Receives the dimensions and output format.
+     * @return False for malformed headers and animations.
+     */
+    bool readHeader(const Input& input, Header* header) const override;
+
+    /**
+     * @brief Returns true: libwebp scales the output rows while decoding.
+     *
+     * @param input The encoded image.
+     * @return True.
+     */
+    bool supportsScaledDecode(const Input& input) const override;
+
+    /**
+     * @brief Returns false: libwebp decodes every pixel whatever the output size.
+     *
+     * @param input The encoded image.
+     * @return False.
+     */
+    bool cheapScaledDecode(const Input& input) const override;
+
+    /**
+     * @brief Decodes the pixels.
+     *
+     * @param input The encoded image.
+     * @param size The size to decode at.
+     * @param image In: an optional buffer to decode into. Out: the pixels.
+     * @return True on success.
+     */
+    bool decode(const Input& input, const QSize& size, QImage* image) const override;
+};
+
+#endif // IMAGELOADERLIB_WEBPDECODER_H
@@ -0,0 +1,134 @@
+/**
+ * @file tst_formatsniffer.cpp
+ * @brief Unit tests of the signature checks of FormatSniffer.
+ *
+ * Each case is the head of a file as the sniffer sees it: signatures cut
+ * short, BMP headers with valid and invalid DIB sizes, and text files whose
+ * first element is or is not an SVG root.
+ */
+#include "formatsniffer.h"
+
+#include <QTest>    // For the test framework
+#include <QtEndian> // For the BMP header fields
+
+namespace {
+/**
+ * @brief UTF-8 byte order mark.
+ */
+const QByteArray BOM = QByteArrayLiteral("\xEF\xBB\xBF");
+
+/**
+ * @brief Returns the head of a BMP file: the file header and the DIB header size.
+ *
+ * @param dibSize The size field of the info header, at offset 14.
+ * @return 18 bytes.
+ */
+QByteArray bmpHead(quint32 dibSize) {
+    QByteArray head = QByteArrayLiteral("BM") + QByteArray(12, '\0') + QByteArray(4, '\0');
+    qToLittleEndian(dibSize, head.data() + 14);
+    return head;
+}
+}
+
+/**
+ * @brief Tests of FormatSniffer::sniff().
+ */
+class TestFormatSniffer : public QObject {
+    Q_OBJECT
+
+private slots:
+    /**
+     * @brief Nothing to look at names no format.
+     */
+    void sniffNothing();
+
+    /**
+     * @brief Provides the file heads and the format each must be named.
+     */
+    void sniff_data();
+
+    /**
+     * @brief Sniffs one file head.
+     */
+    void sniff();
+};
+
+void TestFormatSniffer::sniffNothing() {
+    QVERIFY(FormatSniffer::sniff(nullptr, 16).isEmpty());
+    QVERIFY(FormatSniffer::sniff(reinterpret_cast<const uchar*>("\xFF\xD8\xFF"), 0).isEmpty());
+    QVERIFY(FormatSniffer::sniff(QByteArray()).isEmpty());
+}
+
+void TestFormatSniffer::sniff_data() {
+    QTest::addColumn<QByteArray>("head");
+    QTest::addColumn<QByteArray>("format");
+
+    const QByteArray png = QByteArrayLiteral("\x89PNG\r\n\x1A\n");
+    const QByteArray webp = QByteArrayLiteral("RIFF") + QByteArray(4, '\x24') + QByteArrayLiteral("WEBP");
+
+    // Binary signatures, complete and one byte short
+    QTest::newRow("jpeg") << QByteArrayLiteral("\xFF\xD8\xFF") << QByteArray("jpeg");
+    QTest::newRow("jpeg short") << QByteArrayLiteral("\xFF\xD8") << QByteArray();
+    QTest::newRow("png") << png << QByteArray("png");
+    QTest::newRow("png short") << png.left(7) << QByteArray();
+    QTest::newRow("gif87a") << QByteArrayLiteral("GIF87a") << QByteArray("gif");
+    QTest::newRow("gif89a") << QByteArrayLiteral("GIF89a") << QByteArray("gif");
+    QTest::newRow("gif short") << QByteArrayLiteral("GIF89") << QByteArray();
+    QTest::newRow("webp") << webp << QByteArray("webp");
+    QTest::newRow("webp short") << webp.left(11) << QByteArray();
+    QTest::newRow("riff not webp") << QByteArrayLiteral("RIFF$$$$WAVE") << QByteArray();
+
+    // BMP: "BM" only counts with a known DIB header size after it
+    QTest::newRow("bmp core header") << bmpHead(12) << QByteArray("bmp");
+    QTest::newRow("bmp info header") << bmpHead(40) << QByteArray("bmp");
+    QTest::newRow("bmp v5 header") << bmpHead(124) << QByteArray("bmp");
+    QTest::newRow("bmp unknown header size") << bmpHead(41) << QByteArray();
+    QTest::newRow("bmp big-endian header size") << bmpHead(qToBigEndian<quint32>(40)) << QByteArray();
+    QTest::newRow("bmp short") << bmpHead(40).left(17) << QByteArray();
+    QTest::newRow("bmp magic alone") << QByteArrayLiteral("BM") << QByteArray();
+    QTest::newRow("text starting with BM") << QByteArrayLiteral("BMX racing results for the season\n") << QByteArray();
+
+    // SVG: the first element must be the root, whatever comes before it
+    const QByteArray svg = QByteArrayLiteral("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"10\" height=\"10\"/>\n");
+    const QByteArray declaration = QByteArrayLiteral("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    QTest::newRow("svg") << svg << QByteArray("svg");
+    QTest::newRow("svg bare root") << QByteArrayLiteral("<svg>") << QByteArray("svg");
+    QTest::newRow("svg bom") << BOM + svg << QByteArray("svg");
+    QTest::newRow("svg bom and whitespace") << BOM + QByteArrayLiteral(" \t\r\n  ") + svg << QByteArray("svg");
+    QTest::newRow("svg bom, whitespace and declaration")
+        << BOM + QByteArrayLiteral("\r\n") + declaration + svg << QByteArray("svg");
+    QTest::newRow("svg with comments and stylesheet")
+        << declaration + QByteArrayLiteral("<!-- Generator: editor, <svg> export -->\n<?xml-stylesheet href=\"a.css\"?>\n") + svg
+        << QByteArray("svg");
+    QTest::newRow("svg with doctype")
+        << declaration + QByteArrayLiteral("<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" "
+                                          "\"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n") + svg
+        << QByteArray("svg");
+    QTest::newRow("svg with doctype internal subset")
+        << declaration + QByteArrayLiteral("<!DOCTYPE svg [\n<!ENTITY ns \"http://www.w3.org/2000/svg\">\n]>\n") + svg
+        << QByteArray("svg");
+    QTest::newRow("svg after a long comment")
+        << declaration + "<!--" + QByteArray(FormatSniffer::HEAD_SIZE / 2, '-') + "-->\n" + svg << QByteArray("svg");
+    QTest::newRow("svg root beyond the head")
+        << declaration + "<!--" + QByteArray(FormatSniffer::HEAD_SIZE, 'x') + "-->\n" + svg << QByteArray();
+    QTest::newRow("html with inline svg") << QByteArrayLiteral("<!DOCTYPE html>\n<html><body><svg></svg></body></html>")
+                                          << QByteArray();
+    QTest::newRow("text mentioning svg") << QByteArrayLiteral("Notes about <svg> files\n") << QByteArray();
+    QTest::newRow("other root starting with svg") << QByteArrayLiteral("<svgfont/>") << QByteArray();
+    QTest::newRow("svg root cut short") << declaration + QByteArrayLiteral("<svg") << QByteArray();
+    QTest::newRow("declaration only") << declaration << QByteArray();
+    QTest::newRow("unterminated comment") << QByteArrayLiteral("<!-- <svg>") << QByteArray();
+    QTest::newRow("unterminated doctype subset") << QByteArrayLiteral("<!DOCTYPE svg [ <svg>") << QByteArray();
+    QTest::newRow("bom alone") << BOM << QByteArray();
+    QTest::newRow("whitespace alone") << QByteArrayLiteral(" \n\t") << QByteArray();
+}
+
+void TestFormatSniffer::sniff() {
+    QFETCH(QByteArray, head);
+    QFETCH(QByteArray, format);
+
+    QCOMPARE(FormatSniffer::sniff(head), format);
+}
+
+QTEST_GUILESS_MAIN(TestFormatSniffer)
+#include "tst_formatsniffer.moc"
@@ -0,0 +1,92 @@
+/**
+ * @file tst_pixelkernels.cpp
+ * @brief Unit tests of the PixelKernels downscaling filters.
+ */
+#include "pixelkernels.h"
+
+#include <QTest> // For the test framework
+
+/**
+ * @brief Tests of PixelKernels::downscale().
+ */
+class TestPixelKernels : public QObject {
+    Q_OBJECT
+
+private slots:
+    /**
+     * @brief Lists uniform sources reduced by factors up to and beyond the range of 32-bit sums.
+     */
+    void boxFilterExtremeRatios_data();
+
+    /**
+     * @brief Checks that a uniform source stays uniform, however many pixels each result pixel covers.
+     */
+    void boxFilterExtremeRatios();
+
+    /**
+     * @brief Checks the box filter's average on a small known pattern.
+     */
+    void boxFilterAverages();
+};
+
+void TestPixelKernels::boxFilterExtremeRatios_data() {
+    QTest::addColumn<QSize>("sourceSize");
+    QTest::addColumn<QSize>("targetSize");
+    QTest::addColumn<int>("orientation");
+    QTest::addColumn<QRgb>("colour");
+
+    const int upright = int(QImageIOHandler::TransformationNone);
+    QTest::newRow("small") << QSize(64, 64) << QSize(1, 1) << upright << qRgb(255, 255, 255);
+    // 4200 x 4200 = 17.64 M pixels into one: 255 times that overflows 32 bits
+    QTest::newRow("square into one pixel") << QSize(4200, 4200) << QSize(1, 1) << upright << qRgb(255, 255, 255);
+    QTest::newRow("square into one pixel, grey") << QSize(4200, 4200) << QSize(1, 1) << upright << qRgb(200, 100, 50);
+    // 17 M rows into one: even the per-column sums of a band overflow 32 bits
+    QTest::newRow("column into one pixel") << QSize(1, 17 * 1000 * 1000) << QSize(1, 1) << upright << qRgb(255, 255, 255);
+    // Rotated: the single band of 17 M decoded rows spans the target's width, not its height of 2
+    QTest::newRow("column into one row, rotated") << QSize(2, 17 * 1000 * 1000) << QSize(1, 2)
+                                                  << int(QImageIOHandler::TransformationRotate90) << qRgb(255, 255, 255);
+    QTest::newRow("column into one row, rotated 270") << QSize(2, 17 * 1000 * 1000) << QSize(1, 2)
+                                                      << int(QImageIOHandler::TransformationRotate270) << qRgb(255, 255, 255);
+}
+
+void TestPixelKernels::boxFilterExtremeRatios() {
+    QFETCH(QSize, sourceSize);
+    QFETCH(QSize, targetSize);
+    QFETCH(int, orientation);
+    QFETCH(QRgb, colour);
+
+    QImage source(sourceSize, QImage::Format_RGB32);
+    if (source.isNull()) {
+        QSKIP("Not enough memory for the source image");
+    }
+    source.fill(colour);
+    QImage target(targetSize, QImage::Format_RGB32);
+    PixelKernels::downscale(source, target, PixelKernels::BoxFilter, QImageIOHandler::Transformations(orientation));
+
+    for (int y = 0; y < target.height(); ++y) {
+        for (int x = 0; x < target.width(); ++x) {
+            QCOMPARE(target.pixel(x, y), colour);
+        }
+    }
+}
+
+void TestPixelKernels::boxFilterAverages() {
+    // Each 2 x 2 block averages to its own grey level
+    QImage source(4, 2, QImage::Format_RGB32);
+    source.setPixel(0, 0, qRgb(0, 0, 0));
+    source.setPixel(1, 0, qRgb(100, 100, 100));
+    source.setPixel(0, 1, qRgb(100, 100, 100));
+    source.setPixel(1, 1, qRgb(200, 200, 200));
+    source.setPixel(2, 0, qRgb(255, 255, 255));
+    source.setPixel(3, 0, qRgb(255, 255, 255));
+    source.setPixel(2, 1, qRgb(255, 255, 255));
+    source.setPixel(3, 1, qRgb(251, 251, 251));
+    QImage target(2, 1, QImage::Format_RGB32);
+    PixelKernels::downscale(source, target, PixelKernels::BoxFilter);
+
+    QCOMPARE(target.pixel(0, 0), qRgb(100, 100, 100));
+    QCOMPARE(target.pixel(1, 0), qRgb(254, 254, 254));
+}
+
+QTEST_GUILESS_MAIN(TestPixelKernels)
+#include "tst_pixelkernels.moc"
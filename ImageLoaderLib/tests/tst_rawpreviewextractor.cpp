@@ -0,0 +1,340 @@
+/**
+ * @file tst_rawpreviewextractor.cpp
+ * @brief Unit tests of the TIFF directory walk of RawPreviewExtractor.
+ *
+ * The RAW files are synthetic TIFF containers built in memory, each with
+ * the directory structure a case needs and tiny JPEG streams holding just
+ * the markers the extractor reads.
+ */
+#include "rawpreviewextractor.h"
+
+#include <QBuffer> // For handing the synthetic files to the extractor
+#include <QTest>   // For the test framework
+
+namespace {
+/**
+ * @brief TIFF tags used by the synthetic files.
+ */
+enum : quint16 {
+    TagImageWidth = 0x0100,
+    TagCompression = 0x0103,
+    TagStripOffsets = 0x0111,
+    TagOrientation = 0x0112,
+    TagStripByteCounts = 0x0117,
+    TagSubIfds = 0x014A,
+    TagJpegOffset = 0x0201,
+    TagJpegLength = 0x0202
+};
+
+/**
+ * @brief TIFF field types used by the synthetic files.
+ */
+enum : quint16 {
+    TypeShort = 3,
+    TypeLong = 4
+};
+
+/**
+ * @brief Largest number of IFDs the extractor visits; mirrors MAX_IFDS.
+ */
+constexpr int MAX_IFDS = 32;
+
+/**
+ * @brief Largest number of entries the extractor accepts in one IFD; mirrors MAX_IFD_ENTRIES.
+ */
+constexpr int MAX_IFD_ENTRIES = 1024;
+
+/**
+ * @brief One entry of a synthetic IFD.
+ */
+struct IfdEntry {
+    quint16 tag;    ///< The tag.
+    quint16 type;   ///< TypeShort or TypeLong.
+    quint32 count;  ///< Number of values.
+    quint32 value;  ///< The value, or the offset of the values.
+};
+
+/**
+ * @brief Returns the number of bytes of an IFD with `entries` entries.
+ */
+constexpr int ifdSize(int entries) {
+    return 2 + 12 * entries + 4;
+}
+
+/**
+ * @brief Builds a TIFF file of either byte order, field by field.
+ */
+class TiffBuilder {
+public:
+    /**
+     * @brief Starts an empty file.
+     * @param bigEndian True for "MM" files.
+     */
+    explicit TiffBuilder(bool bigEndian = false)
+        : m_bigEndian(bigEndian)
+    {
+    }
+
+    /**
+     * @brief Appends the 8-byte header.
+     */
+    TiffBuilder& header(quint32 firstIfd, quint16 magic = 42) {
+        m_data.append(m_bigEndian ? "MM" : "II", 2);
+        u16(magic);
+        return u32(firstIfd);
+    }
+
+    /**
+     * @brief Appends an IFD at the end of the file.
+     */
+    TiffBuilder& ifd(const QVector<IfdEntry>& entries, quint32 next) {
+        u16(quint16(entries.size()));
+        for (const IfdEntry& entry : entries) {
+            u16(entry.tag);
+            u16(entry.type);
+            u32(entry.count);
+            if (entry.type == TypeShort && entry.count == 1) {
+                u16(quint16(entry.value)); // Inline SHORT: the first half of the field
+                u16(0);
+            } else {
+                u32(entry.value);
+            }
+        }
+        return u32(next);
+    }
+
+    /**
+     * @brief Appends a 16-bit integer in the file's byte order.
+     */
+    TiffBuilder& u16(quint16 value) {
+        const char high = char(value >> 8);
+        const char low = char(value & 0xFF);
+        m_data.append(m_bigEndian ? high : low);
+        m_data.append(m_bigEndian ? low : high);
+        return *this;
+    }
+
+    /**
+     * @brief Appends a 32-bit integer in the file's byte order.
+     */
+    TiffBuilder& u32(quint32 value) {
+        return m_bigEndian ? u16(quint16(value >> 16)).u16(quint16(value))
+                           : u16(quint16(value)).u16(quint16(value >> 16));
+    }
+
+    /**
+     * @brief Appends raw bytes.
+     */
+    TiffBuilder& bytes(const QByteArray& data) {
+        m_data.append(data);
+        return *this;
+    }
+
+    /**
+     * @brief Returns the current size of the file, i.e. the offset of what is appended next.
+     */
+    quint32 size() const {
+        return quint32(m_data.size());
+    }
+
+    /**
+     * @brief Returns the file.
+     */
+    QByteArray data() const {
+        return m_data;
+    }
+
+private:
+    QByteArray m_data; ///< The file so far.
+    bool m_bigEndian;  ///< True for "MM" files.
+};
+
+/**
+ * @brief Builds a JPEG stream holding only SOI, an APP0 segment, the frame header and EOI.
+ *
+ * @param width The frame width.
+ * @param height The frame height.
+ * @param sof The frame marker: 0xC0 baseline, 0xC2 progressive, 0xC3 lossless.
+ * @return The stream.
+ */
+QByteArray jpegStream(int width, int height, uchar sof = 0xC0) {
+    QByteArray jpeg;
+    const auto put = [&jpeg](std::initializer_list<int> values) {
+        for (int value : values) {
+            jpeg.append(char(value));
+        }
+    };
+    put({ 0xFF, 0xD8 });
+    put({ 0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00 });
+    put({ 0xFF, sof, 0x00, 8 + 3 * 3, 8, height >> 8, height & 0xFF, width >> 8, width & 0xFF, 3 });
+    put({ 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1 });
+    put({ 0xFF, 0xD9 });
+    return jpeg;
+}
+
+/**
+ * @brief Builds a file whose IFD0 references one JPEG interchange stream.
+ *
+ * @param bigEndian The byte order.
+ * @param jpeg The stream.
+ * @param offsetShift Added to the stored offset, to point it elsewhere.
+ * @param lengthShift Added to the stored length.
+ * @return The file; the stream starts right after IFD0.
+ */
+QByteArray singlePreviewFile(bool bigEndian, const QByteArray& jpeg, qint64 offsetShift = 0, qint64 lengthShift = 0) {
+    const quint32 jpegAt = 8 + ifdSize(3);
+    TiffBuilder tiff(bigEndian);
+    tiff.header(8)
+        .ifd({ { TagOrientation, TypeShort, 1, 6 },
+               { TagJpegOffset, TypeLong, 1, quint32(jpegAt + offsetShift) },
+               { TagJpegLength, TypeLong, 1, quint32(jpeg.size() + lengthShift) } }, 0)
+        .bytes(jpeg);
+    return tiff.data();
+}
+}
+
+/**
+ * @brief Tests of RawPreviewExtractor::locate().
+ */
+class TestRawPreviewExtractor : public QObject {
+    Q_OBJECT
+
+private slots:
+    /**
+     * @brief Lists well-formed and corrupt TIFF layouts with the preview expected in each.
+     */
+    void locate_data();
+
+    /**
+     * @brief Checks the preview found in each layout, or that none is, without reading out of bounds.
+     */
+    void locate();
+};
+
+void TestRawPreviewExtractor::locate_data() {
+    QTest::addColumn<QByteArray>("file");
+    QTest::addColumn<QSize>("size");     // Invalid if no preview may be found
+    QTest::addColumn<qint64>("offset");  // Where the preview must start; -1 to skip the check
+
+    const QByteArray small = jpegStream(160, 120);
+    const QByteArray large = jpegStream(640, 480);
+    const qint64 afterIfd0 = 8 + ifdSize(3);
+
+    QTest::newRow("little endian") << singlePreviewFile(false, small) << QSize(160, 120) << afterIfd0;
+    QTest::newRow("big endian") << singlePreviewFile(true, small) << QSize(160, 120) << afterIfd0;
+    QTest::newRow("progressive") << singlePreviewFile(false, jpegStream(160, 120, 0xC2)) << QSize(160, 120) << afterIfd0;
+    QTest::newRow("lossless rejected") << singlePreviewFile(false, jpegStream(160, 120, 0xC3)) << QSize() << qint64(-1);
+    QTest::newRow("no SOI") << singlePreviewFile(false, small.mid(2)) << QSize() << qint64(-1);
+
+    // The largest candidate wins, wherever it is: here a JPEG strip in a SubIFD
+    {
+        const quint32 subIfdAt = 8 + ifdSize(3);
+        const quint32 smallAt = subIfdAt + ifdSize(4);
+        const quint32 largeAt = smallAt + quint32(small.size());
+        TiffBuilder tiff;
+        tiff.header(8)
+            .ifd({ { TagSubIfds, TypeLong, 1, subIfdAt },
+                   { TagJpegOffset, TypeLong, 1, smallAt },
+                   { TagJpegLength, TypeLong, 1, quint32(small.size()) } }, 0)
+            .ifd({ { TagImageWidth, TypeLong, 1, 640 },
+                   { TagCompression, TypeShort, 1, 7 },
+                   { TagStripOffsets, TypeLong, 1, largeAt },
+                   { TagStripByteCounts, TypeLong, 1, quint32(large.size()) } }, 0)
+            .bytes(small)
+            .bytes(large);
+        QTest::newRow("largest in SubIFD") << tiff.data() << QSize(640, 480) << qint64(largeAt);
+    }
+
+    // Bounds of the header and of the directory entries
+    QTest::newRow("not a TIFF") << QByteArray("\x89PNG\r\n\x1A\n\0\0\0\0", 12) << QSize() << qint64(-1);
+    QTest::newRow("wrong magic") << TiffBuilder().header(8, 43).ifd({}, 0).data() << QSize() << qint64(-1);
+    QTest::newRow("header only") << TiffBuilder().header(8).data() << QSize() << qint64(-1);
+    QTest::newRow("IFD0 past the end") << TiffBuilder().header(4096).bytes(small).data() << QSize() << qint64(-1);
+    {
+        TiffBuilder tiff;
+        tiff.header(8).u16(quint16(MAX_IFD_ENTRIES + 1)).bytes(QByteArray(12 * (MAX_IFD_ENTRIES + 1) + 4, '\0'));
+        QTest::newRow("too many entries") << tiff.data() << QSize() << qint64(-1);
+    }
+    {
+        const QByteArray file = singlePreviewFile(false, small);
+        QTest::newRow("entries truncated") << file.left(8 + 2 + 12 * 2) << QSize() << qint64(-1);
+    }
+
+    // Bounds of the candidates
+    QTest::newRow("offset past the end") << singlePreviewFile(false, small, 4096) << QSize() << qint64(-1);
+    QTest::newRow("length past the end") << singlePreviewFile(false, small, 0, 1) << QSize() << qint64(-1);
+    QTest::newRow("offset near 4 GiB") << singlePreviewFile(false, small, -afterIfd0 - 1) << QSize() << qint64(-1);
+    QTest::newRow("stream truncated") << singlePreviewFile(false, small).left(int(afterIfd0) + 8) << QSize() << qint64(-1);
+    QTest::newRow("frame beyond length") << singlePreviewFile(false, small, 0, -int(small.size()) + 8) << QSize() << qint64(-1);
+
+    // Cycles, which a corrupt file may contain anywhere
+    {
+        TiffBuilder tiff;
+        tiff.header(8)
+            .ifd({ { TagJpegOffset, TypeLong, 1, quint32(afterIfd0) - 12 },
+                   { TagJpegLength, TypeLong, 1, quint32(small.size()) } }, 8) // Next IFD: itself
+            .bytes(small);
+        QTest::newRow("IFD chained to itself") << tiff.data() << QSize(160, 120) << afterIfd0 - 12;
+    }
+    {
+        const quint32 ifd1At = 8 + ifdSize(3);
+        const quint32 jpegAt = ifd1At + ifdSize(1);
+        TiffBuilder tiff;
+        tiff.header(8)
+            .ifd({ { TagSubIfds, TypeLong, 1, ifd1At },
+                   { TagJpegOffset, TypeLong, 1, jpegAt },
+                   { TagJpegLength, TypeLong, 1, quint32(small.size()) } }, ifd1At)
+            .ifd({ { TagSubIfds, TypeLong, 1, 8 } }, 8) // Back to IFD0, as a child and as the next IFD
+            .bytes(small);
+        QTest::newRow("IFDs referencing each other") << tiff.data() << QSize(160, 120) << qint64(jpegAt);
+    }
+    {
+        // A chain longer than the walk: the preview in its last IFD is not reached
+        const int chain = MAX_IFDS + 4;
+        const quint32 jpegAt = 8 + chain * ifdSize(1) + ifdSize(2) - ifdSize(1);
+        TiffBuilder tiff;
+        tiff.header(8);
+        for (int i = 0; i < chain - 1; ++i) {
+            tiff.ifd({ { TagImageWidth, TypeLong, 1, 1 } }, tiff.size() + ifdSize(1));
+        }
+        tiff.ifd({ { TagJpegOffset, TypeLong, 1, jpegAt },
+                   { TagJpegLength, TypeLong, 1, quint32(small.size()) } }, 0)
+            .bytes(small);
+        QTest::newRow("chain longer than the walk") << tiff.data() << QSize() << qint64(-1);
+    }
+    {
+        // SubIFD lists that are too long or point past the end are skipped, the rest of the file is not
+        const quint32 jpegAt = 8 + ifdSize(4);
+        TiffBuilder tiff;
+        tiff.header(8)
+            .ifd({ { TagSubIfds, TypeLong, quint32(MAX_IFDS + 1), 8 },
+                   { TagSubIfds, TypeLong, 4, 0x7FFFFFF0 },
+                   { TagJpegOffset, TypeLong, 1, jpegAt },
+                   { TagJpegLength, TypeLong, 1, quint32(small.size()) } }, 0x7FFFFFF0)
+            .bytes(small);
+        QTest::newRow("SubIFD lists out of bounds") << tiff.data() << QSize(160, 120) << qint64(jpegAt);
+    }
+}
+
+void TestRawPreviewExtractor::locate() {
+    QFETCH(QByteArray, file);
+    QFETCH(QSize, size);
+    QFETCH(qint64, offset);
+
+    QBuffer buffer(&file);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    const RawPreviewExtractor::Preview preview = RawPreviewExtractor::locate(&buffer);
+
+    QCOMPARE(preview.isValid(), size.isValid());
+    if (!size.isValid()) {
+        return;
+    }
+    QCOMPARE(preview.size, size);
+    QVERIFY(preview.offset + preview.length <= file.size());
+    if (offset >= 0) {
+        QCOMPARE(preview.offset, offset);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRawPreviewExtractor)
+#include "tst_rawpreviewextractor.moc"
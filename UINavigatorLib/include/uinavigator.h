@@ -4,12 +4,17 @@
  *
  * This file defines the UINavigator class, responsible for tracking the current
  * and maximum image IDs, and providing methods to navigate between images.
- * It emits a signal when the current image ID changes.
+ * It emits a signal when the current image ID changes, and tracks how fast
+ * the user is navigating so that views can trade quality for speed.
  */
 #ifndef UINAVIGATOR_H
 #define UINAVIGATOR_H
 
 #include <QObject>
+#include <QVector>
+#include <QElapsedTimer> // For timing navigation steps
+
+class QTimer;
 
 // Macro standard per l'esportazione/importazione
 #if defined(UINAVIGATORLIB_LIBRARY)
@@ -51,6 +56,16 @@ public:
      */
     int currentImageId() const;
 
+    /**
+     * @brief Moves to an image ID directly.
+     *
+     * The ID is clamped to [0, maxImageId()]. Emits `imageIdChanged` if the
+     * current ID changes; the step is not counted towards the navigation rate.
+     *
+     * @param id The new current image ID.
+     */
+    void setCurrentImageId(int id);
+
     /**
      * @brief Sets the maximum available image ID.
      *
@@ -88,6 +103,51 @@ public:
      */
     bool previous();
 
+    /**
+     * @brief Returns the IDs the user is likely to visit next.
+     *
+     * The IDs follow the direction of the last navigation step (forward
+     * until the user first goes back) and wrap around like next() and
+     * previous() do. The current ID is not included.
+     *
+     * @param count The maximum number of IDs to return.
+     * @return Up to `count` IDs, nearest first.
+     */
+    QVector<int> upcomingIds(int count) const;
+
+    /**
+     * @brief Returns the current navigation rate.
+     *
+     * Counts the next() and previous() steps taken over the last half second.
+     *
+     * @return The rate in steps per second.
+     */
+    double navigationRate() const;
+
+    /**
+     * @brief Returns true while the user is flipping through images faster than the threshold.
+     *
+     * Intermediate images are on screen too briefly for high-quality scaling
+     * to be noticed; views and loaders use cheap filters while this is true.
+     *
+     * @return True if navigationRate() is at or above fastNavigationThreshold().
+     */
+    bool isNavigatingFast() const;
+
+    /**
+     * @brief Sets the rate from which navigation counts as fast.
+     *
+     * @param stepsPerSecond The threshold in steps per second.
+     */
+    void setFastNavigationThreshold(double stepsPerSecond);
+
+    /**
+     * @brief Returns the rate from which navigation counts as fast.
+     *
+     * @return The threshold in steps per second.
+     */
+    double fastNavigationThreshold() const;
+
 signals:
     /**
      * @brief Signal emitted when the current image ID changes.
@@ -99,6 +159,16 @@ signals:
      */
     void imageIdChanged(int newId);
 
+    /**
+     * @brief Signal emitted when navigation has paused on an image for a moment.
+     *
+     * This is the image the user settled on: the one worth the full-quality
+     * treatment after a burst of fast navigation.
+     *
+     * @param id The current image ID.
+     */
+    void navigationSettled(int id);
+
 private:
     /**
      * @brief The current image ID being displayed or navigated to.
@@ -109,6 +179,32 @@ private:
      * This is used to prevent navigation beyond the last image.
      */
     int m_maxImageId;
+    /**
+     * @brief Direction of the last navigation step: +1 for next, -1 for previous.
+     */
+    int m_lastStep;
+
+    /**
+     * @brief Records a navigation step for the rate and restarts the settle timer.
+     */
+    void recordStep();
+
+    /**
+     * @brief Monotonic clock for the step times.
+     */
+    QElapsedTimer m_clock;
+    /**
+     * @brief Times of the recent navigation steps, in ms of `m_clock`, oldest first.
+     */
+    QVector<qint64> m_stepTimes;
+    /**
+     * @brief Fires `navigationSettled` once no step has been taken for a moment.
+     */
+    QTimer* m_settleTimer;
+    /**
+     * @brief Rate in steps per second from which navigation counts as fast.
+     */
+    double m_fastThreshold;
 };
 
 #endif // UINAVIGATOR_H
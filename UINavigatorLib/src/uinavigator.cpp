@@ -9,9 +9,27 @@
  */
 #include "uinavigator.h"
 #include <QDebug>
+#include <QTimer>
 
 // Namespace ImageGallery::UI rimosso
 
+namespace {
+/**
+ * @brief Window over which the navigation rate is measured (ms).
+ */
+constexpr qint64 RATE_WINDOW_MS = 500;
+
+/**
+ * @brief Pause after the last step before navigation counts as settled (ms).
+ */
+constexpr int SETTLE_DELAY_MS = 250;
+
+/**
+ * @brief Default rate from which navigation counts as fast (steps per second).
+ */
+constexpr double DEFAULT_FAST_THRESHOLD = 4.0;
+}
+
 /**
  * @brief Constructor for UINavigator.
  *
@@ -25,8 +43,18 @@
 UINavigator::UINavigator(int initialImageId, int maxImageId, QObject* parent)
     : QObject(parent),
     m_currentImageId(initialImageId),
-    m_maxImageId(maxImageId)
+    m_maxImageId(maxImageId),
+    m_lastStep(1),
+    m_settleTimer(new QTimer(this)),
+    m_fastThreshold(DEFAULT_FAST_THRESHOLD)
 {
+    m_clock.start();
+    m_settleTimer->setSingleShot(true);
+    m_settleTimer->setInterval(SETTLE_DELAY_MS);
+    connect(m_settleTimer, &QTimer::timeout, this, [this]() {
+        emit navigationSettled(m_currentImageId);
+    });
+
     // Ensure initial ID is within valid bounds
     if (m_currentImageId < 0) {
         m_currentImageId = 0;
@@ -47,6 +75,25 @@ int UINavigator::currentImageId() const {
     return m_currentImageId;
 }
 
+/**
+ * @brief Moves to an image ID directly.
+ *
+ * Used to follow the current file when the gallery renumbers it. The ID is
+ * clamped to [0, maxImageId()]; `imageIdChanged` is emitted only if the
+ * current ID actually changes.
+ *
+ * @param id The new current image ID.
+ */
+void UINavigator::setCurrentImageId(int id) {
+    id = qBound(0, id, qMax(0, m_maxImageId));
+    if (id == m_currentImageId) {
+        return;
+    }
+    m_currentImageId = id;
+    qDebug() << "UINavigator: Current ID set to: " << m_currentImageId;
+    emit imageIdChanged(m_currentImageId);
+}
+
 /**
  * @brief Sets the maximum available image ID.
  *
@@ -94,6 +141,8 @@ int UINavigator::maxImageId() const {
 bool UINavigator::next() {
     if (m_maxImageId < 0) return false; // Nessuna immagine
     m_currentImageId = (m_currentImageId + 1) % (m_maxImageId + 1);
+    m_lastStep = 1;
+    recordStep();
     qDebug() << "UINavigator: Moved to next image. New ID: " << m_currentImageId;
     emit imageIdChanged(m_currentImageId);
     return true;
@@ -116,7 +165,81 @@ bool UINavigator::previous() {
     } else {
         m_currentImageId--;
     }
+    m_lastStep = -1;
+    recordStep();
     qDebug() << "UINavigator: Moved to previous image. New ID: " << m_currentImageId;
     emit imageIdChanged(m_currentImageId);
     return true;
 }
+
+/**
+ * @brief Returns the IDs the user is likely to visit next.
+ *
+ * @param count The maximum number of IDs to return.
+ * @return Up to `count` IDs, nearest first.
+ */
+QVector<int> UINavigator::upcomingIds(int count) const {
+    QVector<int> ids;
+    const int total = m_maxImageId + 1;
+    count = qMin(count, total - 1); // Never wrap around onto the current ID
+    ids.reserve(qMax(0, count));
+    for (int step = 1; step <= count; ++step) {
+        ids.append(((m_currentImageId + step * m_lastStep) % total + total) % total);
+    }
+    return ids;
+}
+
+/**
+ * @brief Returns the current navigation rate.
+ *
+ * @return The rate in steps per second.
+ */
+double UINavigator::navigationRate() const {
+    const qint64 windowStart = m_clock.elapsed() - RATE_WINDOW_MS;
+    int steps = 0;
+    for (qint64 time : m_stepTimes) {
+        if (time >= windowStart) {
+            ++steps;
+        }
+    }
+    return steps * 1000.0 / RATE_WINDOW_MS;
+}
+
+/**
+ * @brief Returns true while the user is flipping through images faster than the threshold.
+ *
+ * @return True if navigationRate() is at or above fastNavigationThreshold().
+ */
+bool UINavigator::isNavigatingFast() const {
+    return navigationRate() >= m_fastThreshold;
+}
+
+/**
+ * @brief Sets the rate from which navigation counts as fast.
+ *
+ * @param stepsPerSecond The threshold in steps per second.
+ */
+void UINavigator::setFastNavigationThreshold(double stepsPerSecond) {
+    m_fastThreshold = stepsPerSecond;
+}
+
+/**
+ * @brief Returns the rate from which navigation counts as fast.
+ *
+ * @return The threshold in steps per second.
+ */
+double UINavigator::fastNavigationThreshold() const {
+    return m_fastThreshold;
+}
+
+/**
+ * @brief Records a navigation step for the rate and restarts the settle timer.
+ */
+void UINavigator::recordStep() {
+    const qint64 now = m_clock.elapsed();
+    m_stepTimes.append(now);
+    while (!m_stepTimes.isEmpty() && m_stepTimes.first() < now - RATE_WINDOW_MS) {
+        m_stepTimes.removeFirst();
+    }
+    m_settleTimer->start();
+}